@@ -0,0 +1,281 @@
+/*
+ *  apex_aot.c
+ *  Translates an APEX program ahead of time into a C program
+ *
+ *  Every instruction becomes a labelled C statement, with one label per
+ *  pc. BZ and BNZ are conditional gotos on the zero flag and JUMP goes
+ *  through a switch over every pc, which compilers build into a jump
+ *  table. Built with the host compiler, the program runs at native speed
+ *  with the semantics of the functional engine and prints the final
+ *  registers and MEM[0..99] exactly as APEX_cpu_run does, so its output
+ *  diffs directly against
+ *
+ *    apex_sim <input_file> off --ff-count=<n>
+ *
+ *  Arithmetic wraps through unsigned ints, as APEX_ADD, APEX_SUB and
+ *  APEX_MUL do in the simulator, since signed overflow in the generated
+ *  code would let the compiler assume it never happens.
+ *
+ *  Author :
+ *  Akshay Shinde (ashinde3@binghamton.edu)
+ *  State University of New York, Binghamton
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cpu.h"
+
+/* Sum of two int expressions, wrapping */
+#define WRAP_ADD "(int)((unsigned)%s + (unsigned)%s)"
+
+static void
+reg_name(char* buf, int r)
+{
+  sprintf(buf, "regs[%d]", r);
+}
+
+static void
+print_source(FILE* out, const APEX_Instruction* ins)
+{
+  int flags = opcode_info[ins->opcode].flags;
+  fprintf(out, "%s", opcode_info[ins->opcode].name ? opcode_info[ins->opcode].name : "?");
+  if (flags & OPERAND_RD) {
+    fprintf(out, ",R%d", ins->rd);
+  }
+  if (flags & OPERAND_RS1) {
+    fprintf(out, ",R%d", ins->rs1);
+  }
+  if (flags & OPERAND_RS2) {
+    fprintf(out, ",R%d", ins->rs2);
+  }
+  if (flags & OPERAND_RS3) {
+    fprintf(out, ",R%d", ins->rs3);
+  }
+  if (flags & OPERAND_IMM) {
+    fprintf(out, ",#%d", ins->imm);
+  }
+}
+
+/* Emits the goto for a taken branch at index */
+static void
+print_branch_target(FILE* out, int size, int index, int imm)
+{
+  int target = index + imm / 4;
+  if (imm % 4 != 0 || target < 0 || target >= size) {
+    fprintf(out, "pc = %d; goto leave;", 4000 + index * 4 + imm);
+  }
+  else {
+    fprintf(out, "goto pc_%d;", 4000 + target * 4);
+  }
+}
+
+static void
+print_instruction(FILE* out, const APEX_Instruction* ins, int size, int index, int labelled)
+{
+  char rd[16], rs1[16], rs2[16], rs3[16], imm[16];
+  reg_name(rd, ins->rd);
+  reg_name(rs1, ins->rs1);
+  reg_name(rs2, ins->rs2);
+  reg_name(rs3, ins->rs3);
+  sprintf(imm, "%d", ins->imm);
+
+  if (labelled) {
+    fprintf(out, "pc_%d: /* ", 4000 + index * 4);
+  }
+  else {
+    fprintf(out, "  /* ");
+  }
+  print_source(out, ins);
+  fprintf(out, " */\n  ");
+
+  switch (ins->opcode) {
+    case OPCODE_MOVC:
+      fprintf(out, "%s = %d;", rd, ins->imm);
+      break;
+    case OPCODE_ADD:
+      fprintf(out, "%s = " WRAP_ADD "; zero = (%s == 0);", rd, rs1, rs2, rd);
+      break;
+    case OPCODE_ADDL:
+      fprintf(out, "%s = " WRAP_ADD "; zero = (%s == 0);", rd, rs1, imm, rd);
+      break;
+    case OPCODE_SUB:
+      fprintf(out, "%s = (int)((unsigned)%s - (unsigned)%s); zero = (%s == 0);", rd, rs1, rs2,
+              rd);
+      break;
+    case OPCODE_SUBL:
+      fprintf(out, "%s = (int)((unsigned)%s - (unsigned)%s); zero = (%s == 0);", rd, rs1, imm,
+              rd);
+      break;
+    case OPCODE_MUL:
+      fprintf(out, "%s = (int)((unsigned)%s * (unsigned)%s); zero = (%s == 0);", rd, rs1, rs2,
+              rd);
+      break;
+    case OPCODE_AND:
+      fprintf(out, "%s = %s & %s;", rd, rs1, rs2);
+      break;
+    case OPCODE_OR:
+      fprintf(out, "%s = %s | %s;", rd, rs1, rs2);
+      break;
+    case OPCODE_EXOR:
+      fprintf(out, "%s = %s ^ %s;", rd, rs1, rs2);
+      break;
+    case OPCODE_LOAD:
+      fprintf(out, "%s = mem[" WRAP_ADD "];", rd, rs1, imm);
+      break;
+    case OPCODE_LDR:
+      fprintf(out, "%s = mem[" WRAP_ADD "];", rd, rs1, rs2);
+      break;
+    case OPCODE_STORE:
+      fprintf(out, "mem[" WRAP_ADD "] = %s;", rs2, imm, rs1);
+      break;
+    case OPCODE_STR:
+      fprintf(out, "mem[" WRAP_ADD "] = %s;", rs2, rs3, rs1);
+      break;
+    case OPCODE_BZ:
+      /* A taken BZ consumes the flag, as in EX1 */
+      fprintf(out, "if (zero) { zero = 0; ");
+      print_branch_target(out, size, index, ins->imm);
+      fprintf(out, " }");
+      break;
+    case OPCODE_BNZ:
+      fprintf(out, "if (!zero) { ");
+      print_branch_target(out, size, index, ins->imm);
+      fprintf(out, " }");
+      break;
+    case OPCODE_JUMP:
+      fprintf(out, "pc = " WRAP_ADD "; goto dispatch;", rs1, imm);
+      break;
+    case OPCODE_HALT:
+      fprintf(out, "goto done;");
+      break;
+    default:
+      fprintf(out, ";");
+      break;
+  }
+  fprintf(out, "\n");
+}
+
+/*
+ * Writes the C translation of code memory. The final dump matches the one
+ * APEX_cpu_run prints after a functional fast-forward, where every
+ * register is valid.
+ */
+static void
+translate(FILE* out, const char* filename, const APEX_Instruction* code_memory, int size)
+{
+  fprintf(out,
+          "/* Translated by apex_aot from %s, do not edit */\n"
+          "#include <stdio.h>\n"
+          "\n"
+          "static int regs[32];\n"
+          "static int mem[4096];\n"
+          "\n"
+          "int\n"
+          "main(void)\n"
+          "{\n"
+          "  int zero = 0;\n"
+          "  int pc = 4000;\n"
+          "  (void)pc;\n"
+          "\n",
+          filename);
+
+  /* Labels no instruction refers to would draw warnings, leave them out.
+   * Every pc is a JUMP target once the program has a JUMP.
+   */
+  char* labelled = calloc(size, 1);
+  if (!labelled) {
+    fprintf(stderr, "APEX_Error : Out of memory\n");
+    exit(1);
+  }
+  int has_jump = 0;
+  int has_leave = 0;
+  for (int i = 0; i < size; ++i) {
+    const APEX_Instruction* ins = &code_memory[i];
+    int target = i + ins->imm / 4;
+    if (ins->opcode == OPCODE_JUMP) {
+      has_jump = 1;
+    }
+    else if (ins->opcode == OPCODE_BZ || ins->opcode == OPCODE_BNZ) {
+      if (ins->imm % 4 != 0 || target < 0 || target >= size) {
+        has_leave = 1;
+      }
+      else {
+        labelled[target] = 1;
+      }
+    }
+  }
+
+  for (int i = 0; i < size; ++i) {
+    print_instruction(out, &code_memory[i], size, i, has_jump || labelled[i]);
+  }
+  fprintf(out, "  goto done;\n\n");
+  free(labelled);
+
+  /* JUMP targets, any other pc ends the run */
+  if (has_jump) {
+    fprintf(out, "dispatch:\n  switch (pc) {\n");
+    for (int i = 0; i < size; ++i) {
+      fprintf(out, "    case %d: goto pc_%d;\n", 4000 + i * 4, 4000 + i * 4);
+    }
+    fprintf(out, "    default: goto leave;\n  }\n\n");
+  }
+  if (has_jump || has_leave) {
+    fprintf(out,
+            "leave:\n"
+            "  if (pc >= 4000 && pc < %d) {\n"
+            "    fprintf(stderr, \"APEX_AOT : Stopped at misaligned pc(%%d)\\n\", pc);\n"
+            "  }\n"
+            "\n",
+            4000 + size * 4);
+  }
+
+  fprintf(out,
+          "done:\n"
+          "  (void)zero;\n"
+          "  printf(\"(apex) >> Simulation Complete\");\n"
+          "  printf(\"\\n\");\n"
+          "  printf(\"========ARCHITECTURAL REGISTER VALUES========\\n\");\n"
+          "  for (int j = 0; j <= 15; j++) {\n"
+          "    printf(\" | Reg[%%d] | Value = %%d | Status = %%s | \\n\", j, regs[j], \"Valid\");\n"
+          "  }\n"
+          "  printf(\"======DATA MEMORY======\\n\");\n"
+          "  for (int k = 0; k <= 99; k++) {\n"
+          "    printf(\" | MEM[%%d] | Value=%%d | \\n\", k, mem[k]);\n"
+          "  }\n"
+          "  return 0;\n"
+          "}\n");
+}
+
+int
+main(int argc, char const* argv[])
+{
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "APEX_Help : Usage %s <input_file> [output.c]\n", argv[0]);
+    exit(1);
+  }
+
+  int size;
+  APEX_Instruction* code_memory = create_code_memory(argv[1], &size);
+  if (!code_memory) {
+    fprintf(stderr, "APEX_Error : Unable to load %s\n", argv[1]);
+    exit(1);
+  }
+
+  FILE* out = stdout;
+  if (argc == 3) {
+    out = fopen(argv[2], "w");
+    if (!out) {
+      fprintf(stderr, "APEX_Error : Unable to create %s\n", argv[2]);
+      exit(1);
+    }
+  }
+
+  translate(out, argv[1], code_memory, size);
+  if (out != stdout && fclose(out) != 0) {
+    fprintf(stderr, "APEX_Error : Unable to write %s\n", argv[2]);
+    exit(1);
+  }
+
+  free(code_memory);
+  return 0;
+}
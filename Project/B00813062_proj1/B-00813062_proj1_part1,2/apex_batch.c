@@ -0,0 +1,252 @@
+/*
+ *  apex_batch.c
+ *  Runs a manifest of simulations in parallel
+ *
+ *  Every line of the manifest is one job: an input file and, optionally,
+ *  a configuration spec as taken by apex_sim --config, or without an '='
+ *  the name of a config file as taken by --config-file. Blank lines and
+ *  lines starting with '#' are skipped:
+ *
+ *    T1.asm
+ *    T1.asm mul_latency=4
+ *    T1.asm deep.cfg
+ *
+ *  Jobs run on a work-stealing thread pool, each on its own APEX_CPU with
+ *  tracing off. As each one finishes it appends a JSON object to the
+ *  summary, one line per job:
+ *
+ *    {"job":1,"input":"T1.asm","config":"mul_latency=4","status":"complete",
+ *     "cycles":46,"instructions":18,"ipc":0.391,"cpi":2.556,
+ *     "seconds":0.000012,"regs":[...]}
+ *
+ *  Lines appear in the order jobs finish, "job" is the manifest order.
+ *  The status is "complete", "max_cycles" if --max-cycles stopped the run,
+ *  or "error" if the input could not be loaded or a checkpoint input was
+ *  given a different pipeline shape.
+ *
+ *  Author :
+ *  Akshay Shinde (ashinde3@binghamton.edu)
+ *  State University of New York, Binghamton
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cpu.h"
+
+typedef struct APEX_Batch_Job
+{
+  char* input;
+  char* spec;         // Configuration spec, "" for the defaults
+  APEX_Config config;
+} APEX_Batch_Job;
+
+typedef struct APEX_Batch
+{
+  APEX_Batch_Job* jobs;
+  int num_jobs;
+  int max_cycles;
+  FILE* summary;
+  pthread_mutex_t summary_lock;
+  int failed;
+} APEX_Batch;
+
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+print_json_string(FILE* out, const char* text)
+{
+  fputc('"', out);
+  for (; *text; ++text) {
+    if (*text == '"' || *text == '\\') {
+      fputc('\\', out);
+    }
+    if ((unsigned char)*text < 0x20) {
+      fprintf(out, "\\u%04x", *text);
+    }
+    else {
+      fputc(*text, out);
+    }
+  }
+  fputc('"', out);
+}
+
+static void
+run_job(void* arg, int index)
+{
+  APEX_Batch* batch = arg;
+  APEX_Batch_Job* job = &batch->jobs[index];
+
+  double start = now();
+  const char* status = "error";
+  APEX_CPU* cpu = APEX_cpu_init(job->input, TRACE_OFF);
+  if (cpu && APEX_cpu_set_config(cpu, &job->config) != 0) {
+    APEX_cpu_stop(cpu);
+    cpu = NULL;
+  }
+  if (cpu) {
+    status = APEX_cpu_run_until(cpu, batch->max_cycles, -1) ? "complete" : "max_cycles";
+  }
+  double seconds = now() - start;
+
+  /* The whole line goes out under the lock, lines never interleave */
+  pthread_mutex_lock(&batch->summary_lock);
+  FILE* out = batch->summary;
+  fprintf(out, "{\"job\":%d,\"input\":", index + 1);
+  print_json_string(out, job->input);
+  fprintf(out, ",\"config\":");
+  print_json_string(out, job->spec);
+  fprintf(out, ",\"status\":\"%s\"", status);
+  if (cpu) {
+    fprintf(out,
+            ",\"cycles\":%d,\"instructions\":%ld,\"ipc\":%.3f,\"cpi\":%.3f,\"seconds\":%.6f,"
+            "\"regs\":[",
+            cpu->clock, cpu->ins_committed,
+            cpu->clock > 0 ? (double)cpu->ins_committed / cpu->clock : 0.0,
+            cpu->ins_committed > 0 ? (double)cpu->clock / cpu->ins_committed : 0.0, seconds);
+    for (int r = 0; r <= 15; ++r) {
+      fprintf(out, r ? ",%d" : "%d", cpu->regs[r]);
+    }
+    fprintf(out, "]");
+  }
+  else {
+    batch->failed++;
+  }
+  fprintf(out, "}\n");
+  fflush(out);
+  pthread_mutex_unlock(&batch->summary_lock);
+
+  if (cpu) {
+    APEX_cpu_stop(cpu);
+  }
+}
+
+/* Reads the manifest into batch->jobs, exits on a malformed line */
+static void
+read_manifest(APEX_Batch* batch, const char* path)
+{
+  FILE* fp = fopen(path, "r");
+  if (!fp) {
+    fprintf(stderr, "APEX_Error : Unable to open manifest %s\n", path);
+    exit(1);
+  }
+
+  int max_jobs = 0;
+  char line[1024];
+  for (int line_number = 1; fgets(line, sizeof(line), fp); ++line_number) {
+    char* input = strtok(line, " \t\r\n");
+    if (!input || input[0] == '#') {
+      continue;
+    }
+    char* spec = strtok(NULL, " \t\r\n");
+    if (strtok(NULL, " \t\r\n")) {
+      fprintf(stderr, "APEX_Error : %s:%d : Expected <input_file> [config]\n", path,
+              line_number);
+      exit(1);
+    }
+
+    if (batch->num_jobs == max_jobs) {
+      max_jobs = max_jobs ? max_jobs * 2 : 64;
+      batch->jobs = realloc(batch->jobs, max_jobs * sizeof(*batch->jobs));
+      if (!batch->jobs) {
+        fprintf(stderr, "APEX_Error : Out of memory\n");
+        exit(1);
+      }
+    }
+    APEX_Batch_Job* job = &batch->jobs[batch->num_jobs++];
+    job->input = strdup(input);
+    job->spec = strdup(spec ? spec : "");
+    APEX_config_default(&job->config);
+    int invalid = !job->input || !job->spec;
+    if (!invalid && strchr(job->spec, '=')) {
+      invalid = APEX_config_parse(&job->config, job->spec) != 0;
+    }
+    else if (!invalid && job->spec[0]) {
+      invalid = APEX_config_load(&job->config, job->spec) != 0;
+    }
+    if (invalid) {
+      fprintf(stderr, "APEX_Error : %s:%d : Invalid configuration %s\n", path, line_number,
+              job->spec ? job->spec : "");
+      exit(1);
+    }
+  }
+  fclose(fp);
+}
+
+int
+main(int argc, char const* argv[])
+{
+  if (argc < 2) {
+    fprintf(stderr,
+            "APEX_Help : Usage %s <manifest> [--threads=<n>] [--summary=<file>]\n"
+            "                  [--max-cycles=<n>]\n"
+            "  --threads    : worker threads, one per online core by default\n"
+            "  --summary    : append the JSON lines summary to file, not stdout\n"
+            "  --max-cycles : stop any job still running at this cycle\n",
+            argv[0]);
+    exit(1);
+  }
+
+  APEX_Batch batch;
+  memset(&batch, 0, sizeof(batch));
+  batch.max_cycles = -1;
+  batch.summary = stdout;
+  pthread_mutex_init(&batch.summary_lock, NULL);
+  int num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+  for (int i = 2; i < argc; ++i) {
+    if (strncmp(argv[i], "--threads=", 10) == 0) {
+      num_threads = atoi(argv[i] + 10);
+    }
+    else if (strncmp(argv[i], "--summary=", 10) == 0) {
+      batch.summary = fopen(argv[i] + 10, "a");
+      if (!batch.summary) {
+        fprintf(stderr, "APEX_Error : Unable to open summary %s\n", argv[i] + 10);
+        exit(1);
+      }
+    }
+    else if (strncmp(argv[i], "--max-cycles=", 13) == 0) {
+      batch.max_cycles = atoi(argv[i] + 13);
+    }
+    else {
+      fprintf(stderr, "APEX_Error : Unknown option %s\n", argv[i]);
+      exit(1);
+    }
+  }
+
+  read_manifest(&batch, argv[1]);
+  if (num_threads < 1) {
+    num_threads = 1;
+  }
+
+  double start = now();
+  if (APEX_pool_run(batch.num_jobs, num_threads, run_job, &batch) != 0) {
+    fprintf(stderr, "APEX_Error : Unable to start %d threads\n", num_threads);
+    exit(1);
+  }
+  double seconds = now() - start;
+
+  fprintf(stderr, "APEX_BATCH : Ran %d jobs on %d threads in %.3f s, %d failed\n",
+          batch.num_jobs, num_threads < batch.num_jobs ? num_threads : batch.num_jobs, seconds,
+          batch.failed);
+
+  if (batch.summary != stdout && fclose(batch.summary) != 0) {
+    fprintf(stderr, "APEX_Error : Unable to write summary\n");
+    exit(1);
+  }
+  for (int i = 0; i < batch.num_jobs; ++i) {
+    free(batch.jobs[i].input);
+    free(batch.jobs[i].spec);
+  }
+  free(batch.jobs);
+  return batch.failed ? 1 : 0;
+}
@@ -0,0 +1,87 @@
+/*
+ *  bench_engines.c
+ *  Compares the functional engine with the pipeline model
+ *
+ *  Runs each input program repeatedly through APEX_cpu_fast_forward and
+ *  through APEX_cpu_run with tracing off, and prints the instruction
+ *  rate of both. Only the runs themselves are timed, not loading.
+ *
+ *  Author :
+ *  Akshay Shinde (ashinde3@binghamton.edu)
+ *  State University of New York, Binghamton
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cpu.h"
+
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int
+main(int argc, char const* argv[])
+{
+  if (argc < 3) {
+    fprintf(stderr, "APEX_Help : Usage %s <repeat> <input_file>...\n", argv[0]);
+    exit(1);
+  }
+
+  long repeat = atol(argv[1]);
+  printf("%-16s %10s %14s %14s %14s %8s\n", "program", "insns/run", "functional/s",
+         "pipeline/s", "cycles/s", "speedup");
+
+  for (int f = 2; f < argc; ++f) {
+    APEX_CPU* cpu = APEX_cpu_init(argv[f], TRACE_OFF);
+    if (!cpu) {
+      fprintf(stderr, "APEX_Error : Unable to initialize CPU for %s\n", argv[f]);
+      exit(1);
+    }
+
+    /* Data memory carries over between runs, the counts are what ran */
+    long instructions = 0;
+    double start = now();
+    for (long r = 0; r < repeat; ++r) {
+      cpu->pc = 4000;
+      cpu->zeroFlag = 0;
+      memset(cpu->regs, 0, sizeof(cpu->regs));
+      instructions += APEX_cpu_fast_forward(cpu, -1, -1);
+    }
+    double functional = now() - start;
+    APEX_cpu_stop(cpu);
+
+    /* The pipeline prints its final state, keep that out of the table */
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    if (!freopen("/dev/null", "w", stdout)) {
+      exit(1);
+    }
+
+    long cycles = 0;
+    double pipeline = 0;
+    for (long r = 0; r < repeat; ++r) {
+      cpu = APEX_cpu_init(argv[f], TRACE_OFF);
+      start = now();
+      APEX_cpu_run(cpu);
+      pipeline += now() - start;
+      cycles += cpu->clock;
+      APEX_cpu_stop(cpu);
+    }
+
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+
+    printf("%-16s %10ld %14.0f %14.0f %14.0f %7.1fx\n", argv[f], instructions / repeat,
+           instructions / functional, instructions / pipeline, cycles / pipeline,
+           pipeline / functional);
+  }
+  return 0;
+}
@@ -0,0 +1,217 @@
+/*
+ *  checkpoint.c
+ *  Contains functions to save the complete state of APEX cpu as a
+ *  checkpoint (.apexc) and to restore it
+ *
+ *  An .apexc file is a header, the APEX_CPU image at a page boundary and
+ *  the code memory records, in host byte order:
+ *
+ *    magic "APXC" | version | front end | state size | record size |
+ *    count | state offset | code offset
+ *
+ *  A restored APEX_CPU lives in a private mapping of the file, so pages of
+ *  data memory or code memory are only read in when the run touches them.
+ *  Bump APEX_CHECKPOINT_VERSION whenever APEX_CPU, CPU_Stage or the
+ *  opcode numbering changes; the state size catches most layout changes.
+ *
+ *  Author :
+ *  Akshay Shinde (ashinde3@binghamton.edu)
+ *  State University of New York, Binghamton
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cpu.h"
+
+#define APEX_CHECKPOINT_MAGIC "APXC"
+#define APEX_CHECKPOINT_VERSION 9
+#define APEX_CHECKPOINT_FRONTEND_INORDER 1
+#define APEX_CHECKPOINT_STATE_OFFSET 4096
+
+typedef struct APEX_Checkpoint_Header
+{
+  char magic[4];
+  uint16_t version;
+  uint16_t frontend;
+  uint32_t state_size;
+  uint32_t record_size;
+  uint32_t count;
+  uint32_t state_offset;
+  uint64_t code_offset;
+} APEX_Checkpoint_Header;
+
+static uint64_t
+code_offset(void)
+{
+  uint64_t offset = APEX_CHECKPOINT_STATE_OFFSET + sizeof(APEX_CPU);
+  return (offset + 7) & ~(uint64_t)7;
+}
+
+static int
+write_padding(FILE* fp, long offset)
+{
+  static const char zeros[APEX_CHECKPOINT_STATE_OFFSET];
+  long pos = ftell(fp);
+  return pos >= 0 && pos <= offset && fwrite(zeros, 1, offset - pos, fp) == (size_t)(offset - pos);
+}
+
+/*
+ * Saves the complete state of cpu to path: latches, register file,
+ * scoreboard, data memory, clock, pc and code memory. Host pointers are
+ * not saved, a restored cpu starts without a trace file or translated
+ * code. The checkpoint is written under a temporary name and renamed into
+ * place. Returns 0 on success.
+ */
+int
+APEX_cpu_save_checkpoint(APEX_CPU* cpu, const char* path)
+{
+  APEX_Checkpoint_Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, APEX_CHECKPOINT_MAGIC, 4);
+  header.version = APEX_CHECKPOINT_VERSION;
+  header.frontend = APEX_CHECKPOINT_FRONTEND_INORDER;
+  header.state_size = sizeof(APEX_CPU);
+  header.record_size = sizeof(APEX_Instruction);
+  header.count = cpu->code_memory_size;
+  header.state_offset = APEX_CHECKPOINT_STATE_OFFSET;
+  header.code_offset = code_offset();
+
+  APEX_CPU* state = malloc(sizeof(*state));
+  char* tmp_path = malloc(strlen(path) + 32);
+  if (!state || !tmp_path) {
+    free(state);
+    free(tmp_path);
+    return -1;
+  }
+  memcpy(state, cpu, sizeof(*state));
+  state->trace_writer = NULL;
+  state->tracing = 0;
+  state->code_memory = NULL;
+  state->code_memory_mapped = 0;
+  state->checkpoint_mapped = 0;
+  state->threaded_code = NULL;
+  state->jit = NULL;
+  sprintf(tmp_path, "%s.%ld.tmp", path, (long)getpid());
+
+  int ok = 0;
+  FILE* fp = fopen(tmp_path, "wb");
+  if (fp) {
+    ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+         write_padding(fp, header.state_offset) &&
+         fwrite(state, sizeof(*state), 1, fp) == 1 &&
+         write_padding(fp, header.code_offset) &&
+         fwrite(cpu->code_memory, sizeof(APEX_Instruction), header.count, fp) == header.count;
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp_path, path) != 0) {
+      unlink(tmp_path);
+      ok = 0;
+    }
+  }
+
+  free(state);
+  free(tmp_path);
+  return ok ? 0 : -1;
+}
+
+/* Whether a saved latch names only registers its opcode may index */
+static int
+valid_latch(const CPU_Stage* stage)
+{
+  APEX_Instruction ins = {
+    .opcode = stage->opcode,
+    .rd = stage->rd,
+    .rs1 = stage->rs1,
+    .rs2 = stage->rs2,
+    .rs3 = stage->rs3,
+  };
+  return valid_instruction(&ins);
+}
+
+/*
+ * Restores a cpu saved by APEX_cpu_save_checkpoint, tracing at
+ * trace_level. Returns NULL if path is not a checkpoint this build can
+ * restore. Release the cpu with APEX_cpu_stop as usual.
+ */
+APEX_CPU*
+APEX_cpu_restore_checkpoint(const char* path, int trace_level)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(APEX_Checkpoint_Header)) {
+    close(fd);
+    return NULL;
+  }
+
+  /* Private and writable: the run dirties its own copy of each page */
+  char* base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    return NULL;
+  }
+
+  const APEX_Checkpoint_Header* header = (const APEX_Checkpoint_Header*)base;
+  int valid = memcmp(header->magic, APEX_CHECKPOINT_MAGIC, 4) == 0 &&
+              header->version == APEX_CHECKPOINT_VERSION &&
+              header->frontend == APEX_CHECKPOINT_FRONTEND_INORDER &&
+              header->state_size == sizeof(APEX_CPU) &&
+              header->record_size == sizeof(APEX_Instruction) &&
+              header->count > 0 &&
+              header->state_offset == APEX_CHECKPOINT_STATE_OFFSET &&
+              header->code_offset == code_offset() &&
+              header->code_offset + (uint64_t)header->count * sizeof(APEX_Instruction) ==
+                (uint64_t)st.st_size;
+
+  APEX_CPU* cpu = (APEX_CPU*)(base + APEX_CHECKPOINT_STATE_OFFSET);
+  APEX_Instruction* code_memory = valid ? (APEX_Instruction*)(base + header->code_offset) : NULL;
+
+  /* Stages index their handler tables by opcode, regs by the register
+   * fields of code and latches alike and the latches by the pipeline
+   * shape, forwarding the latches by producer tag and the branch
+   * statistics run up to their count, never trust one blindly
+   */
+  valid = valid && cpu->code_memory_size == (int)header->count;
+  for (uint32_t i = 0; valid && i < header->count; ++i) {
+    valid = valid_instruction(&code_memory[i]);
+  }
+  valid = valid && APEX_config_check(&cpu->config) == 0;
+  for (int i = 0; valid && i < APEX_MAX_STAGES; ++i) {
+    valid = valid_latch(&cpu->stage[i]);
+  }
+  for (int r = 0; valid && r < APEX_NUM_REGS; ++r) {
+    valid = cpu->regs_producer[r] < APEX_MAX_STAGES;
+  }
+  valid = valid && cpu->zero_producer >= -1 && cpu->zero_producer < APEX_MAX_STAGES;
+  valid = valid && cpu->predictor.num_branches >= 0 &&
+          cpu->predictor.num_branches <= APEX_MAX_BRANCH_STATS;
+
+  if (!valid) {
+    munmap(base, st.st_size);
+    return NULL;
+  }
+
+  cpu->code_memory = code_memory;
+  cpu->code_memory_mapped = 0;
+  cpu->checkpoint_mapped = st.st_size;
+  cpu->threaded_code = NULL;
+  cpu->jit = NULL;
+  cpu->trace_writer = NULL;
+  cpu->trace_level = trace_level;
+  cpu->tracing = (trace_level > TRACE_OFF);
+  return cpu;
+}
+
+/* Unmaps a restored cpu, code memory included */
+void
+free_checkpoint(APEX_CPU* cpu)
+{
+  munmap((char*)cpu - APEX_CHECKPOINT_STATE_OFFSET, cpu->checkpoint_mapped);
+}
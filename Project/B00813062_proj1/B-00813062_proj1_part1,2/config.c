@@ -0,0 +1,229 @@
+/*
+ *  config.c
+ *  Contains functions to set the pipeline parameters of APEX cpu
+ *
+ *  A configuration spec is a comma separated list of key=value pairs,
+ *  for example "ex_stages=3,latency.MUL=4". Keys not named keep their
+ *  value. The keys are
+ *
+ *    ex_stages        execute stages, 1 to APEX_MAX_EX_STAGES
+ *    mem_stages       memory stages, 1 to APEX_MAX_MEM_STAGES
+ *    latency.<OP>     cycles opcode OP spends in EX1, 1 to 255
+ *    mul_latency      same as latency.MUL
+ *    forwarding       1 to bypass results and the zero flag into DRF, 0 to
+ *                     wait for results to be written back and stall
+ *                     branches behind arithmetic ops
+ *    early_redirect   1 to resolve BZ and BNZ and squash F and DRF at the
+ *                     end of EX1, 0 to resolve them in the last memory stage
+ *    predictor        none, bimodal, gshare or tournament
+ *    btb_entries      branch target buffer entries, 1 to APEX_MAX_BTB_ENTRIES
+ *    predictor_entries
+ *                     counters per direction table, 1 to
+ *                     APEX_MAX_PREDICTOR_ENTRIES
+ *    history_bits     global history gshare uses, 1 to APEX_MAX_HISTORY_BITS
+ *
+ *  A config file holds one key=value pair, or a spec, per line. Blank
+ *  lines, spaces and anything after a '#' are ignored.
+ *
+ *  Author :
+ *  Akshay Shinde (ashinde3@binghamton.edu)
+ *  State University of New York, Binghamton
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+#define LATENCY_PREFIX "latency."
+#define MAX_LATENCY 255
+
+static const char* const predictor_names[NUM_PREDICTORS] = {
+  [PREDICTOR_NONE]       = "none",
+  [PREDICTOR_BIMODAL]    = "bimodal",
+  [PREDICTOR_GSHARE]     = "gshare",
+  [PREDICTOR_TOURNAMENT] = "tournament",
+};
+
+/* A parameter that can be named in a spec, with its valid range */
+typedef struct APEX_Config_Key
+{
+  const char* name;
+  size_t offset;    // Offset of the int field in APEX_Config
+  int min;
+  int max;
+  const char* const* names;   // Names of the values min.., NULL if numeric
+} APEX_Config_Key;
+
+static const APEX_Config_Key config_keys[] = {
+  { "ex_stages",         offsetof(APEX_Config, ex_stages),           1, APEX_MAX_EX_STAGES },
+  { "mem_stages",        offsetof(APEX_Config, mem_stages),          1, APEX_MAX_MEM_STAGES },
+  { "mul_latency",       offsetof(APEX_Config, latency[OPCODE_MUL]), 1, MAX_LATENCY },
+  { "forwarding",        offsetof(APEX_Config, forwarding),          0, 1 },
+  { "early_redirect",    offsetof(APEX_Config, early_redirect),      0, 1 },
+  { "predictor",         offsetof(APEX_Config, predictor),           0, NUM_PREDICTORS - 1,
+    predictor_names },
+  { "btb_entries",       offsetof(APEX_Config, btb_entries),         1, APEX_MAX_BTB_ENTRIES },
+  { "predictor_entries", offsetof(APEX_Config, predictor_entries),   1, APEX_MAX_PREDICTOR_ENTRIES },
+  { "history_bits",      offsetof(APEX_Config, history_bits),        1, APEX_MAX_HISTORY_BITS },
+};
+
+#define NUM_CONFIG_KEYS (int)(sizeof(config_keys) / sizeof(config_keys[0]))
+
+/* The pipeline as specified: two execute and two memory stages, MUL
+ * spends two cycles in EX1 and everything else one, no forwarding, taken
+ * branches redirect from the last memory stage and nothing is predicted.
+ * The predictor sizes apply once one is selected.
+ */
+void
+APEX_config_default(APEX_Config* config)
+{
+  memset(config, 0, sizeof(*config));
+  config->ex_stages = 2;
+  config->mem_stages = 2;
+  for (int op = 0; op < NUM_OPCODES; ++op) {
+    config->latency[op] = 1;
+  }
+  config->latency[OPCODE_MUL] = 2;
+  config->predictor = PREDICTOR_NONE;
+  config->btb_entries = 64;
+  config->predictor_entries = 256;
+  config->history_bits = 8;
+}
+
+/* Looks up the key named by the len characters at name into key */
+static int
+find_key(const char* name, size_t len, APEX_Config_Key* key)
+{
+  for (int i = 0; i < NUM_CONFIG_KEYS; ++i) {
+    if (strlen(config_keys[i].name) == len && strncmp(config_keys[i].name, name, len) == 0) {
+      *key = config_keys[i];
+      return 0;
+    }
+  }
+
+  size_t prefix = strlen(LATENCY_PREFIX);
+  if (len <= prefix || strncmp(name, LATENCY_PREFIX, prefix) != 0) {
+    return -1;
+  }
+  for (int op = OPCODE_MOVC; op < NUM_OPCODES; ++op) {
+    if (strlen(opcode_info[op].name) == len - prefix &&
+        strncmp(opcode_info[op].name, name + prefix, len - prefix) == 0) {
+      key->name = opcode_info[op].name;
+      key->offset = offsetof(APEX_Config, latency) + op * sizeof(int);
+      key->min = 1;
+      key->max = MAX_LATENCY;
+      key->names = NULL;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+/* Parses the value of key that runs from text to end, returns 0 if it is
+ * a number in range, or one of the key's value names
+ */
+static int
+parse_value(const APEX_Config_Key* key, const char* text, const char* end, long* value)
+{
+  if (key->names) {
+    for (int i = key->min; i <= key->max; ++i) {
+      if (strlen(key->names[i]) == (size_t)(end - text) &&
+          strncmp(key->names[i], text, end - text) == 0) {
+        *value = i;
+        return 0;
+      }
+    }
+    return -1;
+  }
+
+  char* value_end;
+  *value = strtol(text, &value_end, 10);
+  if (value_end != end || value_end == text || *value < key->min || *value > key->max) {
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Applies the key=value pairs of spec to config. Returns 0 on success, or
+ * -1 on an unknown key or a value out of range, leaving config partly
+ * updated.
+ */
+int
+APEX_config_parse(APEX_Config* config, const char* spec)
+{
+  while (*spec) {
+    const char* end = strchr(spec, ',');
+    size_t len = end ? (size_t)(end - spec) : strlen(spec);
+    const char* equals = memchr(spec, '=', len);
+    if (!equals) {
+      return -1;
+    }
+
+    APEX_Config_Key key;
+    if (find_key(spec, equals - spec, &key) != 0) {
+      return -1;
+    }
+
+    long value;
+    if (parse_value(&key, equals + 1, spec + len, &value) != 0) {
+      return -1;
+    }
+    *(int*)((char*)config + key.offset) = (int)value;
+
+    spec += end ? len + 1 : len;
+  }
+  return 0;
+}
+
+/*
+ * Applies the config file at path to config. Returns 0 on success, -1 if
+ * the file cannot be read, or the number of the first line that does not
+ * parse, leaving config partly updated.
+ */
+int
+APEX_config_load(APEX_Config* config, const char* path)
+{
+  FILE* fp = fopen(path, "r");
+  if (!fp) {
+    return -1;
+  }
+
+  char line[1024];
+  for (int line_number = 1; fgets(line, sizeof(line), fp); ++line_number) {
+    /* Drop the comment and every space, what is left is a spec */
+    char* out = line;
+    for (char* in = line; *in && *in != '#'; ++in) {
+      if (*in != ' ' && *in != '\t' && *in != '\r' && *in != '\n') {
+        *out++ = *in;
+      }
+    }
+    *out = '\0';
+
+    if (APEX_config_parse(config, line) != 0) {
+      fclose(fp);
+      return line_number;
+    }
+  }
+  fclose(fp);
+  return 0;
+}
+
+/* Returns 0 if every parameter of config is within its range */
+int
+APEX_config_check(const APEX_Config* config)
+{
+  for (int i = 0; i < NUM_CONFIG_KEYS; ++i) {
+    int value = *(const int*)((const char*)config + config_keys[i].offset);
+    if (value < config_keys[i].min || value > config_keys[i].max) {
+      return -1;
+    }
+  }
+  for (int op = 0; op < NUM_OPCODES; ++op) {
+    if (config->latency[op] < 1 || config->latency[op] > MAX_LATENCY) {
+      return -1;
+    }
+  }
+  return 0;
+}
@@ -12,8 +12,38 @@
 
 #include "cpu.h"
 
-/* Set this flag to 1 to enable debug messages */
+/* Set this flag to 0 to compile all trace messages out */
+#ifndef ENABLE_DEBUG_MESSAGES
 #define ENABLE_DEBUG_MESSAGES 1
+#endif
+
+/* True when cpu traces at level or above */
+#define TRACE(cpu, level) \
+  (ENABLE_DEBUG_MESSAGES && __builtin_expect((cpu)->trace_level >= (level), 0))
+
+/* True when cpu produces any trace, text or binary. With all tracing off
+ * this is a single load and a branch that is never taken
+ */
+#define TRACING(cpu) (ENABLE_DEBUG_MESSAGES && __builtin_expect((cpu)->tracing, 0))
+
+/* Stage ids past EX1 depend on the pipeline shape */
+static inline int
+last_execute_stage(const APEX_Config* config)
+{
+  return EX1 + config->ex_stages - 1;
+}
+
+static inline int
+last_memory_stage(const APEX_Config* config)
+{
+  return EX1 + config->ex_stages + config->mem_stages - 1;
+}
+
+static inline int
+writeback_stage(const APEX_Config* config)
+{
+  return EX1 + config->ex_stages + config->mem_stages;
+}
 
 /*
  * This function creates and initializes APEX cpu.
@@ -22,26 +52,40 @@
  * 				implementation
  */
 APEX_CPU*
-APEX_cpu_init(const char* filename)
+APEX_cpu_init(const char* filename, int trace_level)
 {
   if (!filename) {
     return NULL;
   }
 
-  APEX_CPU* cpu = malloc(sizeof(*cpu));
+  /* A checkpoint resumes the run it was saved from */
+  size_t len = strlen(filename);
+  if (len >= strlen(".apexc") && strcmp(filename + len - strlen(".apexc"), ".apexc") == 0) {
+    return APEX_cpu_restore_checkpoint(filename, trace_level);
+  }
+
+  APEX_CPU* cpu = calloc(1, sizeof(*cpu));
   if (!cpu) {
     return NULL;
   }
 
   /* Initialize PC, Registers and all pipeline stages */
   cpu->pc = 4000;
+  cpu->trace_level = trace_level;
+  cpu->trace_writer = NULL;
+  cpu->tracing = (trace_level > TRACE_OFF);
+  APEX_config_default(&cpu->config);
   memset(cpu->regs, 0, sizeof(int) * 32);
-  memset(cpu->regs_valid, 1, sizeof(int) * 32);
-  memset(cpu->stage, 0, sizeof(CPU_Stage) * NUM_STAGES);
+  cpu->regs_pending = 0;
+  memset(cpu->regs_producer, 0, sizeof(cpu->regs_producer));
+  cpu->zero_producer = -1;
+  memset(cpu->stage, 0, sizeof(cpu->stage));
   memset(cpu->data_memory, 0, sizeof(int) * 4000);
+  APEX_predictor_init(&cpu->predictor);
 
-  /* Parse input file and create code memory */
-  cpu->code_memory = create_code_memory(filename, &cpu->code_memory_size);
+  /* Map the precompiled object of the input file, or parse it and create one */
+  cpu->code_memory =
+    load_code_memory(filename, &cpu->code_memory_size, &cpu->code_memory_mapped);
 
   if (!cpu->code_memory) {
     free(cpu);
@@ -50,12 +94,7 @@ APEX_cpu_init(const char* filename)
 
   cpu->stage[EX1].insflush = 0;
 
-  for(int i=0; i<32; i++)
-  {
-    cpu->regs_valid[i] = 1;
-  }
-
-  if (ENABLE_DEBUG_MESSAGES) {
+  if (TRACE(cpu, TRACE_FULL)) {
     fprintf(stderr,
             "APEX_CPU : Initialized APEX CPU, loaded %d instructions\n",
             cpu->code_memory_size);
@@ -64,7 +103,7 @@ APEX_cpu_init(const char* filename)
 
     for (int i = 0; i < cpu->code_memory_size; ++i) {
       printf("%-9s %-9d %-9d %-9d %-9d %-9d\n",
-             cpu->code_memory[i].opcode,
+             opcode_info[cpu->code_memory[i].opcode].name,
              cpu->code_memory[i].rd,
              cpu->code_memory[i].rs1,
              cpu->code_memory[i].rs2,
@@ -74,13 +113,55 @@ APEX_cpu_init(const char* filename)
   }
 
   /* Make all stages busy except Fetch stage, initally to start the pipeline */
-  for (int i = 1; i < NUM_STAGES; ++i) {
+  for (int i = 1; i < APEX_MAX_STAGES; ++i) {
     cpu->stage[i].busy = 1;
   }
 
   return cpu;
 }
 
+/*
+ * Switches cpu to the parameters in config. The pipeline shape and the
+ * predictor can only change before the first cycle, while no latch holds
+ * an instruction. Returns 0 on success.
+ */
+int
+APEX_cpu_set_config(APEX_CPU* cpu, const APEX_Config* config)
+{
+  if (APEX_config_check(config) != 0) {
+    return -1;
+  }
+  if (cpu->clock > 0 && (config->ex_stages != cpu->config.ex_stages ||
+                         config->mem_stages != cpu->config.mem_stages ||
+                         config->predictor != cpu->config.predictor)) {
+    return -1;
+  }
+
+  /* Without forwarding EX1 sets zeroFlag, make it what the youngest
+   * producer past EX1 left. One still held in EX1 sets it itself.
+   */
+  if (cpu->config.forwarding && !config->forwarding && cpu->zero_producer > EX1) {
+    cpu->zeroFlag = cpu->stage[cpu->zero_producer].zero_flag;
+  }
+  cpu->config = *config;
+  return 0;
+}
+
+/*
+ * Streams a binary trace of every cycle to path, on top of any text trace.
+ * Returns 0 on success.
+ */
+int
+APEX_cpu_set_trace_file(APEX_CPU* cpu, const char* path)
+{
+  cpu->trace_writer = trace_writer_open(path, &cpu->config);
+  if (!cpu->trace_writer) {
+    return -1;
+  }
+  cpu->tracing = 1;
+  return 0;
+}
+
 /*
  * This function de-allocates APEX cpu.
  *
@@ -90,7 +171,16 @@ APEX_cpu_init(const char* filename)
 void
 APEX_cpu_stop(APEX_CPU* cpu)
 {
-  free(cpu->code_memory);
+  if (cpu->trace_writer) {
+    trace_writer_close(cpu->trace_writer);
+  }
+  free_threaded_code(cpu->threaded_code);
+  free_jit(cpu->jit);
+  if (cpu->checkpoint_mapped) {
+    free_checkpoint(cpu);
+    return;
+  }
+  free_code_memory(cpu->code_memory, cpu->code_memory_mapped);
   free(cpu);
 }
 
@@ -106,107 +196,315 @@ get_code_index(int pc)
   return (pc - 4000) / 4;
 }
 
+/*
+ * Per-opcode handlers. Every stage looks up the handler for the opcode ID
+ * predecoded by the file parser; a NULL entry means the opcode has no work
+ * to do in that stage.
+ */
+typedef void (*APEX_Stage_Handler)(APEX_CPU* cpu, CPU_Stage* stage);
+typedef void (*APEX_Print_Handler)(CPU_Stage* stage);
+
+static void
+print_rd_imm(CPU_Stage* stage)
+{
+  printf("%s,R%d,#%d ", opcode_info[stage->opcode].name, stage->rd, stage->imm);
+}
+
+static void
+print_rs1_rs2_imm(CPU_Stage* stage)
+{
+  printf("%s,R%d,R%d,#%d ", opcode_info[stage->opcode].name, stage->rs1, stage->rs2, stage->imm);
+}
+
+static void
+print_rs1_rs2_rs3(CPU_Stage* stage)
+{
+  printf("%s,R%d,R%d,R%d", opcode_info[stage->opcode].name, stage->rs1, stage->rs2, stage->rs3);
+}
+
+static void
+print_rd_rs1_imm(CPU_Stage* stage)
+{
+  printf("%s,R%d,R%d,#%d", opcode_info[stage->opcode].name, stage->rd, stage->rs1, stage->imm);
+}
+
+static void
+print_rd_rs1_rs2(CPU_Stage* stage)
+{
+  printf("%s,R%d,R%d,R%d", opcode_info[stage->opcode].name, stage->rd, stage->rs1, stage->rs2);
+}
+
+static void
+print_imm(CPU_Stage* stage)
+{
+  printf("%s,#%d", opcode_info[stage->opcode].name, stage->imm);
+}
+
+static void
+print_rs1_imm(CPU_Stage* stage)
+{
+  printf("%s,R%d,#%d", opcode_info[stage->opcode].name, stage->rs1, stage->imm);
+}
+
+static void
+print_opcode(CPU_Stage* stage)
+{
+  printf("%s", opcode_info[stage->opcode].name);
+}
+
+static const APEX_Print_Handler print_handlers[NUM_OPCODES] = {
+  [OPCODE_MOVC]  = print_rd_imm,
+  [OPCODE_STORE] = print_rs1_rs2_imm,
+  [OPCODE_STR]   = print_rs1_rs2_rs3,
+  [OPCODE_ADD]   = print_rd_rs1_rs2,
+  [OPCODE_ADDL]  = print_rd_rs1_imm,
+  [OPCODE_SUB]   = print_rd_rs1_rs2,
+  [OPCODE_SUBL]  = print_rd_rs1_imm,
+  [OPCODE_MUL]   = print_rd_rs1_rs2,
+  [OPCODE_AND]   = print_rd_rs1_rs2,
+  [OPCODE_OR]    = print_rd_rs1_rs2,
+  [OPCODE_EXOR]  = print_rd_rs1_rs2,
+  [OPCODE_LOAD]  = print_rd_rs1_imm,
+  [OPCODE_LDR]   = print_rd_rs1_rs2,
+  [OPCODE_BZ]    = print_imm,
+  [OPCODE_BNZ]   = print_imm,
+  [OPCODE_JUMP]  = print_rs1_imm,
+  [OPCODE_HALT]  = print_opcode,
+};
+
 static void
 print_instruction(CPU_Stage* stage)
 {
-  if (strcmp(stage->opcode, "STORE") == 0)
-  {
-    printf("%s,R%d,R%d,#%d ", stage->opcode, stage->rs1, stage->rs2, stage->imm);
+  APEX_Print_Handler handler = print_handlers[stage->opcode];
+  if (handler) {
+    handler(stage);
   }
+}
 
-  if(strcmp(stage->opcode, "STR") == 0)
-  {
-    printf("%s,R%d,R%d,R%d", stage->opcode, stage->rs1, stage->rs2, stage->rs3);
-  }
+/* Debug function which dumps the cpu stage
+ * content
+ *
+ * Note : You are not supposed to edit this function
+ *
+ */
+static void
+print_stage_content(const char* name, CPU_Stage* stage)
+{
+  printf("%-15s: pc(%d) ", name, stage->pc);
+  print_instruction(stage);
+  printf("\n");
+}
 
-  if(strcmp(stage->opcode, "LOAD") ==0 )
-  {
-    printf("%s,R%d,R%d,#%d", stage->opcode, stage->rd, stage->rs1, stage->imm);
+/* Text printed for each kind of stage, by its number within the kind */
+typedef struct APEX_Stage_Text
+{
+  const char* front[EX1];
+  const char* execute[APEX_MAX_EX_STAGES];
+  const char* memory[APEX_MAX_MEM_STAGES];
+  const char* writeback;
+} APEX_Stage_Text;
+
+_Static_assert(APEX_MAX_EX_STAGES == 8 && APEX_MAX_MEM_STAGES == 8,
+               "STAGE_NUMBERS names every execute and memory stage");
+
+#define STAGE_NUMBERS(kind, suffix)                                         \
+  { kind " 1" suffix, kind " 2" suffix, kind " 3" suffix, kind " 4" suffix, \
+    kind " 5" suffix, kind " 6" suffix, kind " 7" suffix, kind " 8" suffix }
+
+static const APEX_Stage_Text stage_names = {
+  .front     = { [F] = "Fetch", [DRF] = "Decode/RF" },
+  .execute   = STAGE_NUMBERS("Execute", ""),
+  .memory    = STAGE_NUMBERS("Memory", ""),
+  .writeback = "Writeback",
+};
+
+static const APEX_Stage_Text empty_stage_lines = {
+  .front     = { [F] = "Fetch         : EMPTY\n", [DRF] = "Decode        : EMPTY\n" },
+  .execute   = STAGE_NUMBERS("Execute", "        : EMPTY\n"),
+  .memory    = STAGE_NUMBERS("Memory", "         : EMPTY\n"),
+  .writeback = "Writeback      : EMPTY\n",
+};
+
+static const char*
+stage_text(const APEX_Stage_Text* text, const APEX_Config* config, int stage_id)
+{
+  if (stage_id < EX1) {
+    return text->front[stage_id];
   }
-
-  if(strcmp(stage->opcode, "LDR") ==0 )
-  {
-    printf("%s,R%d,R%d,R%d", stage->opcode, stage->rd, stage->rs1, stage->rs2);
+  if (stage_id <= last_execute_stage(config)) {
+    return text->execute[stage_id - EX1];
   }
-
-  if(strcmp(stage->opcode, "ADD") ==0 )
-  {
-    printf("%s,R%d,R%d,R%d", stage->opcode, stage->rd, stage->rs1, stage->rs2);
+  if (stage_id <= last_memory_stage(config)) {
+    return text->memory[stage_id - last_execute_stage(config) - 1];
   }
+  return text->writeback;
+}
 
-  if(strcmp(stage->opcode, "ADDL") ==0 )
-  {
-    printf("%s,R%d,R%d,#%d", stage->opcode, stage->rd, stage->rs1, stage->imm);
+/* Short label of stage_id, "EX2" or "MEM1", into label of 16 bytes */
+void
+stage_label(char* label, const APEX_Config* config, int stage_id)
+{
+  if (stage_id == F) {
+    strcpy(label, "F");
   }
-
-  if(strcmp(stage->opcode, "SUB") ==0 )
-  {
-    printf("%s,R%d,R%d,R%d", stage->opcode, stage->rd, stage->rs1, stage->rs2);
+  else if (stage_id == DRF) {
+    strcpy(label, "DRF");
   }
-
-  if(strcmp(stage->opcode, "SUBL") ==0 )
-  {
-    printf("%s,R%d,R%d,#%d", stage->opcode, stage->rd, stage->rs1, stage->imm);
+  else if (stage_id <= last_execute_stage(config)) {
+    sprintf(label, "EX%d", stage_id - EX1 + 1);
   }
-
-  if(strcmp(stage->opcode, "MUL") ==0 )
-  {
-    printf("%s,R%d,R%d,R%d", stage->opcode, stage->rd, stage->rs1, stage->rs2);
+  else if (stage_id <= last_memory_stage(config)) {
+    sprintf(label, "MEM%d", stage_id - last_execute_stage(config));
   }
-
-  if (strcmp(stage->opcode, "MOVC") == 0)
-  {
-    printf("%s,R%d,#%d ", stage->opcode, stage->rd, stage->imm);
+  else {
+    strcpy(label, "WB");
   }
+}
 
-  if(strcmp(stage->opcode, "AND") ==0 )
-  {
-    printf("%s,R%d,R%d,R%d", stage->opcode, stage->rd, stage->rs1, stage->rs2);
-  }
+void
+print_cycle_banner(int clock)
+{
+  printf("--------------------------------\n");
+  printf("Clock Cycle #: %d\n", clock);
+  printf("--------------------------------\n");
+}
 
-  if(strcmp(stage->opcode, "OR") ==0 )
-  {
-    printf("%s,R%d,R%d,R%d", stage->opcode, stage->rd, stage->rs1, stage->rs2);
+void
+print_stage(const APEX_Config* config, int stage_id, CPU_Stage* stage)
+{
+  print_stage_content(stage_text(&stage_names, config, stage_id), stage);
+}
+
+void
+print_empty_stage(const APEX_Config* config, int stage_id)
+{
+  fputs(stage_text(&empty_stage_lines, config, stage_id), stdout);
+}
+
+/* Stall reason of a latch, derived from the flags that hold it */
+static int
+stall_reason(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  if (!stage->stalled && !stage->busy) {
+    return APEX_STALL_NONE;
+  }
+  if (cpu->ex_halt) {
+    return APEX_STALL_HALT;
   }
+  if (stage->busy) {
+    return APEX_STALL_LATENCY;
+  }
+  return APEX_STALL_DEPENDENCE;
+}
 
-  if(strcmp(stage->opcode, "EXOR") ==0 )
-  {
-    printf("%s,R%d,R%d,R%d", stage->opcode, stage->rd, stage->rs1, stage->rs2);
+static void
+trace_record(APEX_CPU* cpu, int kind, int stage_id, CPU_Stage* stage)
+{
+  APEX_Trace_Record record;
+  memset(&record, 0, sizeof(record));
+  record.kind = kind;
+  record.stage = stage_id;
+  if (stage) {
+    record.pc = stage->pc;
+    record.imm = stage->imm;
+    record.opcode = stage->opcode;
+    record.stall = stall_reason(cpu, stage);
+    record.rd = stage->rd;
+    record.rs1 = stage->rs1;
+    record.rs2 = stage->rs2;
+    record.rs3 = stage->rs3;
+  }
+  else {
+    record.pc = cpu->clock;
   }
+  trace_writer_push(cpu->trace_writer, &record);
+}
 
-  if(strcmp(stage->opcode, "BZ") == 0)
-  {
-    printf("%s,#%d", stage->opcode, stage->imm);
+/* Only called while TRACING(cpu), so none of these sit on the fast path */
+static void
+trace_cycle(APEX_CPU* cpu)
+{
+  if (cpu->trace_writer) {
+    trace_record(cpu, APEX_TRACE_CYCLE, 0, NULL);
   }
+  if (cpu->trace_level >= TRACE_COMMIT) {
+    print_cycle_banner(cpu->clock);
+  }
+}
 
-  if(strcmp(stage->opcode, "BNZ") == 0)
-  {
-    printf("%s,#%d", stage->opcode, stage->imm);
+static void
+trace_stage(APEX_CPU* cpu, int stage_id, CPU_Stage* stage)
+{
+  if (cpu->trace_writer) {
+    trace_record(cpu, APEX_TRACE_STAGE, stage_id, stage);
+  }
+  if (cpu->trace_level >= TRACE_STAGE ||
+      (stage_id == writeback_stage(&cpu->config) && cpu->trace_level >= TRACE_COMMIT)) {
+    print_stage(&cpu->config, stage_id, stage);
   }
+}
 
-  if(strcmp(stage->opcode, "JUMP") == 0)
-  {
-    printf("%s,R%d,#%d", stage->opcode, stage->rs1, stage->imm);
+static void
+trace_empty(APEX_CPU* cpu, int stage_id)
+{
+  if (cpu->trace_writer) {
+    trace_record(cpu, APEX_TRACE_EMPTY, stage_id, &cpu->stage[stage_id]);
   }
+  if (cpu->trace_level >= TRACE_STAGE) {
+    print_empty_stage(&cpu->config, stage_id);
+  }
+}
 
-  if(strcmp(stage->opcode, "HALT") == 0)
-  {
-    printf("%s", stage->opcode);
+static inline int
+pc_in_code_memory(const APEX_CPU* cpu)
+{
+  int index = get_code_index(cpu->pc);
+  return index >= 0 && index < cpu->code_memory_size;
+}
+
+/* Copies the packed instruction at cpu->pc into the fetch latch, a pc
+ * outside code memory fetches an empty instruction. The run ends once
+ * what was fetched before it has drained, see pipeline_drained.
+ */
+static inline void
+fetch_instruction(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  static const APEX_Instruction empty_ins;
+  const APEX_Instruction* current_ins = &empty_ins;
+  if (pc_in_code_memory(cpu)) {
+    current_ins = &cpu->code_memory[get_code_index(cpu->pc)];
   }
+  stage->opcode = current_ins->opcode;
+  stage->rd = current_ins->rd;
+  stage->rs1 = current_ins->rs1;
+  stage->rs2 = current_ins->rs2;
+  stage->rs3 = current_ins->rs3;
+  stage->imm = current_ins->imm;
 }
 
-/* Debug function which dumps the cpu stage
- * content
- *
- * Note : You are not supposed to edit this function
- *
+/* Moves cpu->pc past the instruction just fetched into stage, to the
+ * target the predictor gives a BZ or BNZ, or to the next instruction
  */
 static void
-print_stage_content(char* name, CPU_Stage* stage)
+fetch_next_pc(APEX_CPU* cpu, CPU_Stage* stage)
 {
-  printf("%-15s: pc(%d) ", name, stage->pc);
-  print_instruction(stage);
-  printf("\n");
+  int target;
+  stage->predicted_taken = 0;
+  if (cpu->config.predictor == PREDICTOR_NONE ||
+      (stage->opcode != OPCODE_BZ && stage->opcode != OPCODE_BNZ)) {
+    cpu->pc += 4;
+    return;
+  }
+
+  stage->history = cpu->predictor.history;
+  stage->fetch_clock = cpu->clock;
+  if (APEX_predictor_predict(&cpu->predictor, &cpu->config, stage->pc, &target)) {
+    stage->predicted_taken = 1;
+    cpu->pc = target;
+  }
+  else {
+    cpu->pc += 4;
+  }
 }
 
 /*
@@ -227,36 +525,31 @@ fetch(APEX_CPU* cpu)
     /* Index into code memory using this pc and copy all instruction fields into
      * fetch latch
      */
-    APEX_Instruction* current_ins = &cpu->code_memory[get_code_index(cpu->pc)];
-    strcpy(stage->opcode, current_ins->opcode);
-    stage->rd = current_ins->rd;
-    stage->rs1 = current_ins->rs1;
-    stage->rs2 = current_ins->rs2;
-    stage->rs3 = current_ins->rs3;
-    stage->imm = current_ins->imm;
-    stage->rd = current_ins->rd;
+    fetch_instruction(cpu, stage);
 
     /* Update PC for next instruction */
     if(!cpu->stage[DRF].stalled)
     {
       /* Update PC for next instruction */
-      cpu->pc += 4;
+      fetch_next_pc(cpu, stage);
 
       /* Copy data from fetch latch to decode latch*/
       cpu->stage[DRF] = cpu->stage[F];
     }
 
 
-    if (ENABLE_DEBUG_MESSAGES)
+    if (TRACING(cpu))
     {
-      print_stage_content("Fetch", stage);
+      trace_stage(cpu, F, stage);
     }
   }
 
   else if(cpu->stage[EX1].insflush == 1)
   {
-    strcpy(cpu->stage[F].opcode, "");
-    printf("Fetch         : EMPTY\n");
+    cpu->stage[F].opcode = OPCODE_NONE;
+    if (TRACING(cpu)) {
+      trace_empty(cpu, F);
+    }
   }
 
   else if(stage->stalled==1 || stage->busy==1)    // To stall fetch when MUL enters Execute stage
@@ -267,768 +560,905 @@ fetch(APEX_CPU* cpu)
     /* Index into code memory using this pc and copy all instruction fields into
      * fetch latch
      */
-    APEX_Instruction* current_ins = &cpu->code_memory[get_code_index(cpu->pc)];
-    strcpy(stage->opcode, current_ins->opcode);
-    stage->rd = current_ins->rd;
-    stage->rs1 = current_ins->rs1;
-    stage->rs2 = current_ins->rs2;
-    stage->rs3 = current_ins->rs3;
-    stage->imm = current_ins->imm;
-    stage->rd = current_ins->rd;
-
-   if(ENABLE_DEBUG_MESSAGES)
+    fetch_instruction(cpu, stage);
+
+   if (TRACING(cpu))
     {
-      print_stage_content("Fetch", stage);
+      trace_stage(cpu, F, stage);
     }
   }
   return 0;
 }
 
-/*
- *  Decode Stage of APEX Pipeline
- *
- *  Note : You are free to edit this function according to your
- * 				 implementation
+#define REG_BIT(r) (1u << ((r) & 31))
+
+/* Whether the latch holds an instruction that will write its rd, rather
+ * than a bubble, a held copy or nothing
  */
-int
-decode(APEX_CPU* cpu)
+static int
+writes_register(const CPU_Stage* stage)
 {
-  CPU_Stage* stage = &cpu->stage[DRF];
-  if(stage->stalled)
-  {
-    stage->stalled = 0;
-  }
+  return !stage->busy && !stage->stalled && !stage->nop &&
+         (opcode_info[stage->opcode].flags & OPERAND_RD);
+}
 
-  if (!stage->busy && !stage->stalled)
-  {
+/* Whether the latch holds an instruction that will set the zero flag:
+ * an arithmetic op, or BZ, which always leaves it clear
+ */
+static int
+sets_zero_flag(const CPU_Stage* stage)
+{
+  return !stage->busy && !stage->stalled && !stage->nop &&
+         ((opcode_info[stage->opcode].flags & OPCODE_ARITH) || stage->opcode == OPCODE_BZ);
+}
 
-    // STORE
-    if (strcmp(stage->opcode, "STORE") == 0)
-    {
-      stage->arithminstr = 0;
-      if(cpu->regs_valid[stage->rs1] && cpu->regs_valid[stage->rs2])
-      {
-        cpu->stage[F].stalled=0;
-        cpu->stage[DRF].stalled=0;
-        stage->rs1_value = cpu->regs[stage->rs1];
-        stage->rs2_value = cpu->regs[stage->rs2];
-      }
-      else
-      {
-        cpu->stage[F].stalled = 1;
-        cpu->stage[DRF].stalled = 1;
-      }
-    }
+/* Marks rd pending on the instruction decoded in DRF */
+static void
+scoreboard_claim(APEX_CPU* cpu, int rd)
+{
+  cpu->regs_pending |= REG_BIT(rd);
+  cpu->regs_producer[rd] = DRF;
+}
 
-    // STR
-    if (strcmp(stage->opcode, "STR") == 0)
-    {
-      stage->arithminstr = 0;
-      if(cpu->regs_valid[stage->rs1] && cpu->regs_valid[stage->rs2] && cpu->regs_valid[stage->rs3])
-      {
-        cpu->stage[F].stalled=0;
-        cpu->stage[DRF].stalled=0;
-        stage->rs1_value = cpu->regs[stage->rs1];
-        stage->rs2_value = cpu->regs[stage->rs2];
-        stage->rs3_value = cpu->regs[stage->rs3];
-      }
+/* Moves the producer tag along with a latch just copied from stage_id to
+ * the next stage. Only the youngest writer of a register carries its tag.
+ */
+static void
+scoreboard_advance(APEX_CPU* cpu, int stage_id)
+{
+  CPU_Stage* stage = &cpu->stage[stage_id + 1];
+  if (writes_register(stage) && (cpu->regs_pending & REG_BIT(stage->rd)) &&
+      cpu->regs_producer[stage->rd] == stage_id) {
+    cpu->regs_producer[stage->rd] = stage_id + 1;
+  }
+  if (sets_zero_flag(stage) && cpu->zero_producer == stage_id) {
+    cpu->zero_producer = stage_id + 1;
+  }
+}
 
-      else
-      {
-        cpu->stage[F].stalled = 1;
-        cpu->stage[DRF].stalled = 1;
-      }
-    }
+/* Clears rd once its youngest writer has written it back */
+static void
+scoreboard_release(APEX_CPU* cpu, int stage_id, int rd)
+{
+  if (cpu->regs_producer[rd] == stage_id) {
+    cpu->regs_pending &= ~REG_BIT(rd);
+  }
+}
 
-    // LOAD
-    if (strcmp(stage->opcode, "LOAD") == 0)
-    {
-      stage->arithminstr = 0;
-      if(cpu->regs_valid[stage->rs1])
-      {
-        cpu->stage[F].stalled=0;
-        cpu->stage[DRF].stalled=0;
-        stage->rs1_value = cpu->regs[stage->rs1];
-        cpu->regs_valid[stage->rd]--;
-      }
+/* Retires the zero flag the instruction in Writeback sets, with
+ * forwarding on it only becomes architectural here
+ */
+static void
+zero_flag_release(APEX_CPU* cpu, int stage_id, CPU_Stage* stage)
+{
+  if (cpu->config.forwarding) {
+    cpu->zeroFlag = stage->zero_flag;
+  }
+  if (cpu->zero_producer == stage_id) {
+    cpu->zero_producer = -1;
+  }
+}
 
-      else
-      {
-        cpu->stage[F].stalled=1;
-        cpu->stage[DRF].stalled=1;
+/*
+ * Drops the claims of the instruction in stage_id, which is being
+ * squashed. Its register, or the zero flag, stays pending if an older
+ * writer not yet past the last memory stage is still to write it. The
+ * tag alone tells whether the latch holds the claim, a multi-cycle op
+ * held in EX1 is marked nop.
+ */
+static void
+scoreboard_squash(APEX_CPU* cpu, int stage_id)
+{
+  CPU_Stage* stage = &cpu->stage[stage_id];
+  if (cpu->zero_producer == stage_id) {
+    cpu->zero_producer = -1;
+    for (int i = last_memory_stage(&cpu->config); i > stage_id; --i) {
+      if (sets_zero_flag(&cpu->stage[i])) {
+        cpu->zero_producer = i;
       }
     }
+  }
 
-    // LDR
-    if (strcmp(stage->opcode, "LDR") == 0)
-    {
-      stage->arithminstr = 0;
-      if(cpu->regs_valid[stage->rs1] && cpu->regs_valid[stage->rs2])
-      {
-        cpu->stage[F].stalled=0;
-        cpu->stage[DRF].stalled=0;
-        stage->rs1_value = cpu->regs[stage->rs1];
-        stage->rs2_value = cpu->regs[stage->rs2];
-        cpu->regs_valid[stage->rd]--;
-      }
+  if (stage->busy || !(opcode_info[stage->opcode].flags & OPERAND_RD) ||
+      !(cpu->regs_pending & REG_BIT(stage->rd)) || cpu->regs_producer[stage->rd] != stage_id) {
+    return;
+  }
 
-      else
-      {
-        cpu->stage[F].stalled=1;
-        cpu->stage[DRF].stalled=1;
-      }
+  cpu->regs_pending &= ~REG_BIT(stage->rd);
+  for (int i = stage_id + 1; i <= last_memory_stage(&cpu->config); ++i) {
+    if (writes_register(&cpu->stage[i]) && cpu->stage[i].rd == stage->rd) {
+      cpu->regs_pending |= REG_BIT(stage->rd);
+      cpu->regs_producer[stage->rd] = i;
+      return;
     }
+  }
+}
 
-    // ADD-SUB-MUL
-    if (strcmp(stage->opcode, "ADD") == 0 || strcmp(stage->opcode, "SUB") == 0 || strcmp(stage->opcode, "MUL") == 0)
-    {
-      stage->arithminstr = 1;
-      if(cpu->regs_valid[stage->rs1] && cpu->regs_valid[stage->rs2])
-      {
-        cpu->stage[F].stalled=0;
-        cpu->stage[DRF].stalled=0;
-        stage->rs1_value = cpu->regs[stage->rs1];
-        stage->rs2_value = cpu->regs[stage->rs2];
-        cpu->regs_valid[stage->rd]--;
-      }
+/* A source operand as decode finds it, from the register file or from
+ * the latch of an instruction still in flight
+ */
+typedef struct APEX_Operand
+{
+  int value;
+  int producer;   // Stage that produced a bypassed value, -1 for the register file
+} APEX_Operand;
 
-      else
-      {
-        cpu->stage[F].stalled=1;
-        cpu->stage[DRF].stalled=1;
-      }
-    }
+/*
+ * Looks for register r, returns 0 if DRF has to wait for it. A register
+ * no instruction in flight writes is read from the register file, which
+ * Writeback has already updated this cycle. With forwarding on, a pending
+ * one comes from the latch of its youngest writer once that is past EX1:
+ * decode runs after every later stage, so each latch past EX1 holds what
+ * its stage produced this cycle. ALU results are there once EX1 has run,
+ * LOAD and LDR results only once the last memory stage has.
+ */
+static int
+find_operand(APEX_CPU* cpu, int r, APEX_Operand* operand)
+{
+  if (!(cpu->regs_pending & REG_BIT(r))) {
+    operand->value = cpu->regs[r];
+    operand->producer = -1;
+    return 1;
+  }
+  if (!cpu->config.forwarding) {
+    return 0;
+  }
 
-    // ADDL-SUBL
-    if (strcmp(stage->opcode, "ADDL") == 0 || strcmp(stage->opcode, "SUBL") == 0)
-    {
-      stage->arithminstr = 1;
-      if(cpu->regs_valid[stage->rs1])
-      {
-        cpu->stage[F].stalled=0;
-        cpu->stage[DRF].stalled=0;
-        stage->rs1_value = cpu->regs[stage->rs1];
-        cpu->regs_valid[stage->rd]--;
-      }
+  int i = cpu->regs_producer[r];
+  CPU_Stage* writer = &cpu->stage[i];
+  if (i <= EX1 ||
+      ((writer->opcode == OPCODE_LOAD || writer->opcode == OPCODE_LDR) &&
+       i != writeback_stage(&cpu->config))) {
+    return 0;
+  }
+  operand->value = writer->buffer;
+  operand->producer = i - 1;
+  return 1;
+}
 
-      else
-      {
-        cpu->stage[F].stalled=1;
-        cpu->stage[DRF].stalled=1;
-      }
-    }
-
-    /* No Register file read needed for MOVC */
-    if (strcmp(stage->opcode, "MOVC") == 0)
-    {
-      stage->arithminstr = 0;
-      cpu->regs_valid[stage->rd]--;
-    }
+/* Bits of the source registers the opcode in stage reads */
+static uint32_t
+source_mask(const CPU_Stage* stage)
+{
+  int flags = opcode_info[stage->opcode].flags;
+  return ((flags & OPERAND_RS1) ? REG_BIT(stage->rs1) : 0) |
+         ((flags & OPERAND_RS2) ? REG_BIT(stage->rs2) : 0) |
+         ((flags & OPERAND_RS3) ? REG_BIT(stage->rs3) : 0);
+}
 
-    // AND-OR-EXOR
-    if (strcmp(stage->opcode, "AND") == 0 || strcmp(stage->opcode, "OR") == 0 || strcmp(stage->opcode, "EXOR") == 0)
-    {
-      stage->arithminstr = 0;
-      if(cpu->regs_valid[stage->rs1] && cpu->regs_valid[stage->rs2])
-      {
-        cpu->stage[F].stalled=0;
-        cpu->stage[DRF].stalled=0;
-        stage->rs1_value = cpu->regs[stage->rs1];
-        stage->rs2_value = cpu->regs[stage->rs2];
-        cpu->regs_valid[stage->rd]--;
-      }
+/* Finds every source register of the opcode in DRF, returns 0 if DRF has
+ * to wait for one of them
+ */
+static int
+find_operands(APEX_CPU* cpu, CPU_Stage* stage, APEX_Operand operands[3])
+{
+  int flags = opcode_info[stage->opcode].flags;
+  if (!cpu->config.forwarding && (source_mask(stage) & cpu->regs_pending)) {
+    return 0;
+  }
+  return (!(flags & OPERAND_RS1) || find_operand(cpu, stage->rs1, &operands[0])) &&
+         (!(flags & OPERAND_RS2) || find_operand(cpu, stage->rs2, &operands[1])) &&
+         (!(flags & OPERAND_RS3) || find_operand(cpu, stage->rs3, &operands[2]));
+}
 
-      else
-      {
-        cpu->stage[F].stalled=1;
-        cpu->stage[DRF].stalled=1;
-      }
-    }
+/* Counts an operand bypassed from a latch rather than read from the
+ * register file
+ */
+static void
+count_forward(APEX_CPU* cpu, const APEX_Operand* operand)
+{
+  if (operand->producer >= 0) {
+    cpu->forwarded[operand->producer]++;
+  }
+}
 
-    // BZ-BNZ
-    if (strcmp(stage->opcode, "BZ") == 0 || strcmp(stage->opcode, "BNZ") == 0)
-    {
-      stage->arithminstr = 0;
-      if((cpu->stage[WB].arithminstr == 1) || (cpu->stage[MEM2].arithminstr == 1))
-      {
-        stage->stalled = 1;
-      }
-      else
-      {
-        stage->stalled = 0;
-      }
-    }
+/* Reads the source registers named by the opcode's operand classes,
+ * stalling F and DRF until all of them are available, and claims rd
+ */
+static void
+decode_register_read(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  int flags = opcode_info[stage->opcode].flags;
+  APEX_Operand operands[3];
 
-    // JUMPs
-    if (strcmp(stage->opcode, "JUMP") == 0)
-    {
-      stage->arithminstr = 0;
-      stage->rs1_value = cpu->regs[stage->rs1];
-    }
+  stage->arithminstr = (flags & OPCODE_ARITH) ? 1 : 0;
+  if (!find_operands(cpu, stage, operands))
+  {
+    cpu->stage[F].stalled = 1;
+    cpu->stage[DRF].stalled = 1;
+    return;
+  }
 
-    // HALT
-    if(strcmp(stage->opcode, "HALT") == 0)
-    {
-      stage->arithminstr = 0;
-      cpu->stage[F].stalled = 1;
-      cpu->stage[F].pc = 0;
-      strcpy(cpu->stage[F].opcode, "");
-      cpu->ex_halt = 1;
-    }
+  cpu->stage[F].stalled = 0;
+  cpu->stage[DRF].stalled = 0;
+  if (flags & OPERAND_RS1)
+  {
+    stage->rs1_value = operands[0].value;
+    count_forward(cpu, &operands[0]);
+  }
+  if (flags & OPERAND_RS2)
+  {
+    stage->rs2_value = operands[1].value;
+    count_forward(cpu, &operands[1]);
+  }
+  if (flags & OPERAND_RS3)
+  {
+    stage->rs3_value = operands[2].value;
+    count_forward(cpu, &operands[2]);
+  }
+  if (flags & OPERAND_RD)
+  {
+    scoreboard_claim(cpu, stage->rd);
+  }
+  if (flags & OPCODE_ARITH)
+  {
+    cpu->zero_producer = DRF;
+  }
+}
 
-    /* Copy data from decode latch to execute latch*/
-    cpu->stage[EX1] = cpu->stage[DRF];
+/* No Register file read needed for MOVC */
+static void
+decode_movc(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  stage->arithminstr = 0;
+  scoreboard_claim(cpu, stage->rd);
+}
 
-    if (ENABLE_DEBUG_MESSAGES)
+/*
+ * With forwarding on a branch takes the zero flag from the latch of its
+ * youngest older producer once that has left EX1, or from zeroFlag if
+ * none is in flight, and carries it to EX1. Otherwise it waits while an
+ * arithmetic op is in the last memory stage or Writeback and tests
+ * zeroFlag as EX1 last set it.
+ */
+static void
+decode_branch(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  stage->arithminstr = 0;
+  if (cpu->config.forwarding)
+  {
+    int i = cpu->zero_producer;
+    stage->stalled = (i == EX1);
+    if (!stage->stalled)
     {
-      print_stage_content("Decode/RF", stage);
+      stage->zero_flag = (i < 0) ? cpu->zeroFlag : cpu->stage[i].zero_flag;
     }
   }
-
-  else if(cpu->stage[EX1].insflush == 1)
+  else if((cpu->stage[writeback_stage(&cpu->config)].arithminstr == 1) ||
+          (cpu->stage[last_memory_stage(&cpu->config)].arithminstr == 1))
   {
-     strcpy(cpu->stage[F].opcode, "");
-     printf("Decode        : EMPTY\n");
+    stage->stalled = 1;
   }
-
   else
   {
-    if(ENABLE_DEBUG_MESSAGES)
-    {
-      print_stage_content("Decode/RF", stage);
-    }
+    stage->stalled = 0;
   }
 
+  if (!stage->stalled && stage->opcode == OPCODE_BZ)
+  {
+    cpu->zero_producer = DRF;
+  }
+}
 
+/* JUMP reads rs1 as it stands, unless forwarding or early redirects are
+ * on, then it waits for rs1 like any other source
+ */
+static void
+decode_jump(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  if (cpu->config.forwarding || cpu->config.early_redirect)
+  {
+    decode_register_read(cpu, stage);
+    return;
+  }
+  stage->arithminstr = 0;
+  stage->rs1_value = cpu->regs[stage->rs1];
+}
 
-
-  return 0;
+static void
+decode_halt(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  stage->arithminstr = 0;
+  cpu->stage[F].stalled = 1;
+  cpu->stage[F].pc = 0;
+  cpu->stage[F].opcode = OPCODE_NONE;
+  cpu->ex_halt = 1;
 }
 
+static const APEX_Stage_Handler decode_handlers[NUM_OPCODES] = {
+  [OPCODE_MOVC]  = decode_movc,
+  [OPCODE_STORE] = decode_register_read,
+  [OPCODE_STR]   = decode_register_read,
+  [OPCODE_ADD]   = decode_register_read,
+  [OPCODE_ADDL]  = decode_register_read,
+  [OPCODE_SUB]   = decode_register_read,
+  [OPCODE_SUBL]  = decode_register_read,
+  [OPCODE_MUL]   = decode_register_read,
+  [OPCODE_AND]   = decode_register_read,
+  [OPCODE_OR]    = decode_register_read,
+  [OPCODE_EXOR]  = decode_register_read,
+  [OPCODE_LOAD]  = decode_register_read,
+  [OPCODE_LDR]   = decode_register_read,
+  [OPCODE_BZ]    = decode_branch,
+  [OPCODE_BNZ]   = decode_branch,
+  [OPCODE_JUMP]  = decode_jump,
+  [OPCODE_HALT]  = decode_halt,
+};
+
 /*
- *  Execute Stage of APEX Pipeline
+ *  Decode Stage of APEX Pipeline
  *
  *  Note : You are free to edit this function according to your
  * 				 implementation
  */
 int
-execute1(APEX_CPU* cpu)
+decode(APEX_CPU* cpu)
 {
-  CPU_Stage* stage = &cpu->stage[EX1];
-  if (!stage->busy && (stage->stalled == 0)) {
-
-    if (strcmp(stage->opcode, "STORE") == 0)
-    {
-      stage->mem_address = stage->rs2_value + stage->imm;
-    }
+  CPU_Stage* stage = &cpu->stage[DRF];
+  if(stage->stalled)
+  {
+    stage->stalled = 0;
+  }
 
-    if (strcmp(stage->opcode, "STR") == 0)
+  if (!stage->busy && !stage->stalled)
+  {
+    APEX_Stage_Handler handler = decode_handlers[stage->opcode];
+    if (handler)
     {
-      stage->mem_address = stage->rs2_value + stage->rs3_value;
+      handler(cpu, stage);
     }
 
-    if (strcmp(stage->opcode, "LOAD") == 0)
-    {
-      stage->mem_address = stage->rs1_value + stage->imm;
-    }
+    /* Copy data from decode latch to execute latch*/
+    cpu->stage[EX1] = cpu->stage[DRF];
+    scoreboard_advance(cpu, DRF);
 
-    if (strcmp(stage->opcode, "LDR") == 0)
+    if (TRACING(cpu))
     {
-      stage->mem_address = stage->rs1_value + stage->rs2_value;
+      trace_stage(cpu, DRF, stage);
     }
+  }
 
-    if (strcmp(stage->opcode, "ADD") == 0)
-    {
-      stage->buffer = stage->rs1_value + stage->rs2_value;
-      if(stage->buffer == 0)
-          cpu->zeroFlag = 1;
-      else
-          cpu->zeroFlag = 0;
-    }
+  else if(cpu->stage[EX1].insflush == 1)
+  {
+     cpu->stage[F].opcode = OPCODE_NONE;
+     if (TRACING(cpu)) {
+       trace_empty(cpu, DRF);
+     }
+  }
 
-    if (strcmp(stage->opcode, "ADDL") == 0)
+  else
+  {
+    if (TRACING(cpu))
     {
-      stage->buffer = stage->rs1_value + stage->imm;
-      if(stage->buffer == 0)
-          cpu->zeroFlag = 1;
-      else
-          cpu->zeroFlag = 0;
+      trace_stage(cpu, DRF, stage);
     }
+  }
 
-    if (strcmp(stage->opcode, "SUB") == 0)
-    {
-      stage->buffer = stage->rs1_value - stage->rs2_value;
-      if(stage->buffer == 0)
-          cpu->zeroFlag = 1;
-      else
-          cpu->zeroFlag = 0;
-    }
+  return 0;
+}
 
-    if (strcmp(stage->opcode, "SUBL") == 0)
-    {
-      stage->buffer = stage->rs1_value - stage->imm;
-      if(stage->buffer == 0)
-          cpu->zeroFlag = 1;
-      else
-          cpu->zeroFlag = 0;
-    }
+/* The zero flag an arithmetic op leaves, in zeroFlag too without forwarding */
+static void
+set_zero_flag(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  stage->zero_flag = (stage->buffer == 0);
+  if (!cpu->config.forwarding)
+  {
+    cpu->zeroFlag = stage->zero_flag;
+  }
+}
 
-    if (strcmp(stage->opcode, "MUL") == 0)
-    {
-      if(stage->mulFlag == 0)
-      {
-        cpu->stage[F].stalled = 1;
-        cpu->stage[DRF].stalled = 1;
-        cpu->stage[F].busy = 1;
-        cpu->stage[DRF].busy = 1;
-        stage->nop = 1;
-      }
+static void
+execute1_store(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  stage->mem_address = APEX_ADD(stage->rs2_value, stage->imm);
+}
 
-      if(stage->mulFlag == 1)
-      {
-        stage->buffer = stage->rs1_value * stage->rs2_value;
-        cpu->stage[F].stalled=0;
-        cpu->stage[DRF].stalled=0;
-        cpu->stage[F].busy=0;
-        cpu->stage[DRF].busy=0;
-        stage->nop=0;
-      }
+static void
+execute1_str(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  stage->mem_address = APEX_ADD(stage->rs2_value, stage->rs3_value);
+}
 
-      stage->mulFlag = 1;
-      if(stage->buffer == 0)
-          cpu->zeroFlag = 1;
-      else
-          cpu->zeroFlag = 0;
-    }
+static void
+execute1_load(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  stage->mem_address = APEX_ADD(stage->rs1_value, stage->imm);
+}
 
-    /* No Register file read needed for MOVC */
-    if (strcmp(stage->opcode, "MOVC") == 0)
-    {
-      stage->buffer = stage->imm;
-    }
+static void
+execute1_ldr(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  stage->mem_address = APEX_ADD(stage->rs1_value, stage->rs2_value);
+}
 
-    if (strcmp(stage->opcode, "AND") == 0)
-    {
-      stage->buffer = stage->rs1_value & stage->rs2_value;
-    }
+static void
+execute1_add(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  stage->buffer = APEX_ADD(stage->rs1_value, stage->rs2_value);
+  set_zero_flag(cpu, stage);
+}
 
-    if (strcmp(stage->opcode, "OR") == 0)
-    {
-      stage->buffer = stage->rs1_value | stage->rs2_value;
-    }
+static void
+execute1_addl(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  stage->buffer = APEX_ADD(stage->rs1_value, stage->imm);
+  set_zero_flag(cpu, stage);
+}
 
-    if (strcmp(stage->opcode, "EXOR") == 0)
-    {
-      stage->buffer = stage->rs1_value ^ stage->rs2_value;
-    }
+static void
+execute1_sub(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  stage->buffer = APEX_SUB(stage->rs1_value, stage->rs2_value);
+  set_zero_flag(cpu, stage);
+}
 
-    if (strcmp(stage->opcode, "BNZ") == 0)
-    {
-      if(!cpu->zeroFlag)
-      {
-        stage->mem_address = stage->pc + stage->imm;
+static void
+execute1_subl(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  stage->buffer = APEX_SUB(stage->rs1_value, stage->imm);
+  set_zero_flag(cpu, stage);
+}
 
-      }
-      else
-      {
-        stage->insflush = 1;
-        stage->mem_address = 0;
-      }
-    }
+static void
+execute1_mul(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  stage->buffer = APEX_MUL(stage->rs1_value, stage->rs2_value);
+  set_zero_flag(cpu, stage);
+}
 
-    if (strcmp(stage->opcode, "BZ") == 0)
-    {
-      if(cpu->zeroFlag == 1)
-      {
-        stage->mem_address = stage->pc + stage->imm;
-        cpu->zeroFlag = 0;
-      }
-      else
-      {
-        stage->insflush = 1;
-        stage->mem_address = 0;
-      }
-    }
+/* No Register file read needed for MOVC */
+static void
+execute1_movc(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  stage->buffer = stage->imm;
+}
 
-    if (strcmp(stage->opcode, "JUMP") == 0)
-    {
-      cpu->pc = stage->rs1_value + stage->imm;
-    }
+static void
+execute1_and(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  stage->buffer = stage->rs1_value & stage->rs2_value;
+}
 
-    if(strcmp(stage->opcode, "HALT") == 0)
-    {
-      stage->insflush = 1;
-      cpu->stage[DRF].pc = 0;
-      strcpy(cpu->stage[DRF].opcode, "");
-      cpu->stage[DRF]. stalled = 1;
-      cpu->stage[F].stalled = 1;
-      strcpy(cpu->stage[F].opcode, "");
-      cpu->stage[F].pc = 0;
-      cpu->ex_halt=1;
-    }
+static void
+execute1_or(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  stage->buffer = stage->rs1_value | stage->rs2_value;
+}
 
+static void
+execute1_exor(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  stage->buffer = stage->rs1_value ^ stage->rs2_value;
+}
 
-    /* Copy data from Execute latch to Memory latch*/
-    cpu->stage[EX2] = cpu->stage[EX1];
+/*
+ * Squashes every instruction younger than the branch in stage_id, youngest
+ * first so that the scoreboard ends up with the writers older than it,
+ * and undoes what a wrong-path HALT or multi-cycle op did to the front
+ */
+static void
+squash_younger(APEX_CPU* cpu, int stage_id)
+{
+  for (int i = EX1; i < stage_id; ++i) {
+    CPU_Stage* younger = &cpu->stage[i];
+    scoreboard_squash(cpu, i);
+    younger->pc = 0;
+    younger->opcode = OPCODE_NONE;
+    younger->insflush = 0;
+    younger->ex_cycles = 0;
+  }
+  for (int i = F; i <= DRF; ++i) {
+    cpu->stage[i].pc = 0;
+    cpu->stage[i].opcode = OPCODE_NONE;
+    cpu->stage[i].busy = 0;
+    cpu->stage[i].stalled = 0;
+  }
+  cpu->ex_halt = 0;
+}
 
-    if (ENABLE_DEBUG_MESSAGES) {
-      print_stage_content("Execute 1", stage);
+/*
+ * Resolves the branch in stage_id, in EX1 with early redirects or else in
+ * the last memory stage. Fetch has gone on along the predicted path, or
+ * without a predictor along the fall-through one. If that was wrong, the
+ * path is squashed and Fetch restarts on the real one, with the zero flag
+ * as the branch left EX1.
+ */
+static void
+resolve_branch(APEX_CPU* cpu, CPU_Stage* stage, int stage_id)
+{
+  int taken = (stage->mem_address != 0);
+  int mispredicted = taken;
+  if (cpu->config.predictor != PREDICTOR_NONE) {
+    mispredicted =
+      APEX_predictor_resolve(&cpu->predictor, &cpu->config, stage->pc, stage->history,
+                             stage->predicted_taken, taken, stage->mem_address,
+                             cpu->clock - stage->fetch_clock - 1);
+  }
+  if (mispredicted) {
+    squash_younger(cpu, stage_id);
+    cpu->pc = taken ? stage->mem_address : stage->pc + 4;
+    if (!cpu->config.forwarding) {
+      cpu->zeroFlag = stage->zero_flag;
     }
   }
+}
+
+/* The zero flag a branch tests, as DRF found it with forwarding on */
+static int
+branch_zero_flag(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  return cpu->config.forwarding ? stage->zero_flag : cpu->zeroFlag;
+}
 
+static void
+execute1_bnz(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  int zero = branch_zero_flag(cpu, stage);
+  if(!zero)
+  {
+    stage->mem_address = stage->pc + stage->imm;
+  }
   else
   {
-    cpu->stage[EX2] = cpu->stage[EX1];
-    if(ENABLE_DEBUG_MESSAGES)
-    {
-      printf("Execute 1        : EMPTY\n");
-    }
+    stage->insflush = 1;
+    stage->mem_address = 0;
+  }
+  stage->zero_flag = zero;
+  if (cpu->config.early_redirect)
+  {
+    resolve_branch(cpu, stage, EX1);
   }
-  return 0;
 }
 
-int
-execute2(APEX_CPU* cpu)
+/* BZ leaves the zero flag clear whichever way it goes */
+static void
+execute1_bz(APEX_CPU* cpu, CPU_Stage* stage)
 {
-  CPU_Stage* stage = &cpu->stage[EX2];
-  //if (!stage->busy && !stage->stalled) {
-  if (!stage->busy && !stage->stalled) {
-    if (strcmp(stage->opcode, "STORE") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "STR") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "LOAD") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "LDR") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "ADD") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "ADDL") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "SUB") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "SUBL") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "MUL") == 0)
-    {
-    }
-
-    /* No Register file read needed for MOVC */
-    if (strcmp(stage->opcode, "MOVC") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "AND") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "OR") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "EXOR") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "BZ") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "BNZ") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "JUMP") == 0)
-    {
-    }
-
-    if(strcmp(stage->opcode, "HALT") == 0)
+  if(branch_zero_flag(cpu, stage) == 1)
+  {
+    stage->mem_address = stage->pc + stage->imm;
+    if (!cpu->config.forwarding)
     {
+      cpu->zeroFlag = 0;
     }
+  }
+  else
+  {
+    stage->insflush = 1;
+    stage->mem_address = 0;
+  }
+  stage->zero_flag = 0;
+  if (cpu->config.early_redirect)
+  {
+    resolve_branch(cpu, stage, EX1);
+  }
+}
 
+/* Without early redirects the instruction in DRF still goes on */
+static void
+execute1_jump(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  if (cpu->config.early_redirect)
+  {
+    squash_younger(cpu, EX1);
+  }
+  cpu->pc = APEX_ADD(stage->rs1_value, stage->imm);
+}
 
-    /* Copy data from Execute latch to Memory latch*/
-    cpu->stage[MEM1] = cpu->stage[EX2];
+static void
+execute1_halt(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  stage->insflush = 1;
+  cpu->stage[DRF].pc = 0;
+  cpu->stage[DRF].opcode = OPCODE_NONE;
+  cpu->stage[DRF].stalled = 1;
+  cpu->stage[F].stalled = 1;
+  cpu->stage[F].opcode = OPCODE_NONE;
+  cpu->stage[F].pc = 0;
+  cpu->ex_halt=1;
+}
 
-    if (ENABLE_DEBUG_MESSAGES) {
-      print_stage_content("Execute 2", stage);
-    }
-  }
+static const APEX_Stage_Handler execute1_handlers[NUM_OPCODES] = {
+  [OPCODE_MOVC]  = execute1_movc,
+  [OPCODE_STORE] = execute1_store,
+  [OPCODE_STR]   = execute1_str,
+  [OPCODE_ADD]   = execute1_add,
+  [OPCODE_ADDL]  = execute1_addl,
+  [OPCODE_SUB]   = execute1_sub,
+  [OPCODE_SUBL]  = execute1_subl,
+  [OPCODE_MUL]   = execute1_mul,
+  [OPCODE_AND]   = execute1_and,
+  [OPCODE_OR]    = execute1_or,
+  [OPCODE_EXOR]  = execute1_exor,
+  [OPCODE_LOAD]  = execute1_load,
+  [OPCODE_LDR]   = execute1_ldr,
+  [OPCODE_BZ]    = execute1_bz,
+  [OPCODE_BNZ]   = execute1_bnz,
+  [OPCODE_JUMP]  = execute1_jump,
+  [OPCODE_HALT]  = execute1_halt,
+};
+
+/* Holds F and DRF behind a multi-cycle op for one more cycle. An
+ * arithmetic op keeps driving the zero flag from its latch meanwhile
+ */
+static void
+execute1_hold(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  cpu->stage[F].stalled = 1;
+  cpu->stage[DRF].stalled = 1;
+  cpu->stage[F].busy = 1;
+  cpu->stage[DRF].busy = 1;
+  stage->nop = 1;
 
-  else
+  if (opcode_info[stage->opcode].flags & OPCODE_ARITH)
   {
-    cpu->stage[MEM1] = cpu->stage[EX2];
-
-    if (ENABLE_DEBUG_MESSAGES)
-    {
-      printf("Execute 2        : EMPTY\n");
-    }
+    set_zero_flag(cpu, stage);
   }
-  return 0;
+}
+
+static void
+execute1_release(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  cpu->stage[F].stalled=0;
+  cpu->stage[DRF].stalled=0;
+  cpu->stage[F].busy=0;
+  cpu->stage[DRF].busy=0;
+  stage->nop=0;
 }
 
 /*
- *  Memory Stage of APEX Pipeline
+ *  Execute Stage of APEX Pipeline
+ *
+ *  An opcode spends config.latency cycles in EX1 and does its work in the
+ *  last of them
  *
  *  Note : You are free to edit this function according to your
  * 				 implementation
  */
 int
-memory1(APEX_CPU* cpu)
+execute1(APEX_CPU* cpu)
 {
-  CPU_Stage* stage = &cpu->stage[MEM1];
-  if (!stage->busy && !stage->stalled) {
-
-    if (strcmp(stage->opcode, "STORE") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "STR") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "LOAD") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "LDR") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "ADD") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "ADDL") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "SUB") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "SUBL") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "MUL") == 0)
-    {
-    }
-
-    /* No Register file read needed for MOVC */
-    if (strcmp(stage->opcode, "MOVC") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "AND") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "OR") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "EXOR") == 0)
-    {
-    }
-
-    if (strcmp(stage->opcode, "BZ") == 0)
-    {
-    }
+  CPU_Stage* stage = &cpu->stage[EX1];
+  if (!stage->busy && (stage->stalled == 0)) {
 
-    if (strcmp(stage->opcode, "BNZ") == 0)
+    int latency = cpu->config.latency[stage->opcode];
+    if (latency > 1 && ++stage->ex_cycles < latency)
     {
+      execute1_hold(cpu, stage);
     }
-
-    if (strcmp(stage->opcode, "JUMP") == 0)
+    else
     {
-    }
+      if (latency > 1)
+      {
+        execute1_release(cpu, stage);
+      }
 
-    if(strcmp(stage->opcode, "HALT") == 0)
-    {
+      APEX_Stage_Handler handler = execute1_handlers[stage->opcode];
+      if (handler)
+      {
+        handler(cpu, stage);
+      }
     }
 
+    /* Copy data from Execute latch to the next latch*/
+    cpu->stage[EX1 + 1] = cpu->stage[EX1];
+    scoreboard_advance(cpu, EX1);
 
-    /* Copy data from decode latch to execute latch*/
-    cpu->stage[MEM2] = cpu->stage[MEM1];
-
-    if (ENABLE_DEBUG_MESSAGES) {
-      print_stage_content("Memory 1", stage);
+    if (TRACING(cpu)) {
+      trace_stage(cpu, EX1, stage);
     }
   }
 
   else
   {
-    cpu->stage[MEM2] = cpu->stage[MEM1];
-
-    if (ENABLE_DEBUG_MESSAGES)
+    cpu->stage[EX1 + 1] = cpu->stage[EX1];
+    if (TRACING(cpu))
     {
-      printf("Memory 1         : EMPTY\n");
+      trace_empty(cpu, EX1);
     }
   }
   return 0;
 }
 
+/*
+ *  Execute stages after EX1 and memory stages before the last one
+ *
+ *  No opcode does any work in them, they only pass the latch along
+ */
 int
-memory2(APEX_CPU* cpu)
+pass_stage(APEX_CPU* cpu, int stage_id)
 {
-  CPU_Stage* stage = &cpu->stage[MEM2];
-  if (!stage->busy && !stage->stalled && stage->nop == 0)
-  {
-
-    /* Store */
-    if (strcmp(stage->opcode, "STORE") == 0)
-    {
-      cpu->data_memory[stage->mem_address] = stage->rs1_value;
-    }
-
-    if (strcmp(stage->opcode, "STR") == 0)
-    {
-      cpu->data_memory[stage->mem_address] = stage->rs1_value;
-    }
-
-    if (strcmp(stage->opcode, "LOAD") == 0)
-    {
-      stage->buffer= cpu->data_memory[stage->mem_address];
-    }
+  CPU_Stage* stage = &cpu->stage[stage_id];
+  cpu->stage[stage_id + 1] = *stage;
+  scoreboard_advance(cpu, stage_id);
 
-    if (strcmp(stage->opcode, "LDR") == 0)
-    {
-      stage->buffer= cpu->data_memory[stage->mem_address];
+  if (TRACING(cpu))
+  {
+    if (!stage->busy && !stage->stalled) {
+      trace_stage(cpu, stage_id, stage);
     }
-
-    /*if (strcmp(stage->opcode, "ADD") == 0)
-    {
+    else {
+      trace_empty(cpu, stage_id);
     }
+  }
+  return 0;
+}
 
-    if (strcmp(stage->opcode, "ADDL") == 0)
-    {
-    }
+static void
+memory_store(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  cpu->data_memory[stage->mem_address] = stage->rs1_value;
+}
 
-    if (strcmp(stage->opcode, "SUB") == 0)
-    {
-    }
+static void
+memory_load(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  stage->buffer= cpu->data_memory[stage->mem_address];
+}
 
-    if (strcmp(stage->opcode, "SUBL") == 0)
-    {
-    }
+/* Winds ins_completed back over the instructions a taken branch jumps */
+static void
+branch_taken_completed(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  if(stage->imm < 0)
+  {
+    cpu->ins_completed = (cpu->ins_completed + (stage->imm/4))-1;
+  }
 
-    if (strcmp(stage->opcode, "MUL") == 0)
-    {
-    }*/
+  else
+  {
+    cpu->ins_completed = (cpu->ins_completed - (stage->imm/4));
+  }
+}
 
-    /* No Register file read needed for MOVC */
-    /*if (strcmp(stage->opcode, "MOVC") == 0)
-    {
-    }
+/* Taken branch: redirect fetch and squash the younger instructions in
+ * DRF and in the latch right behind
+ */
+static void
+memory_branch(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  if(stage->mem_address != 0)
+  {
+    CPU_Stage* behind = &cpu->stage[last_memory_stage(&cpu->config) - 1];
+    cpu->pc =stage->mem_address;
 
-    if (strcmp(stage->opcode, "AND") == 0)
-    {
-    }
+    scoreboard_squash(cpu, last_memory_stage(&cpu->config) - 1);
+    cpu->stage[DRF].pc = 0;
+    cpu->stage[DRF].opcode = OPCODE_NONE;
+    behind->opcode = OPCODE_NONE;
+    behind->pc = 0;
 
-    if (strcmp(stage->opcode, "OR") == 0)
+    branch_taken_completed(cpu, stage);
+    if(cpu->ex_halt)
     {
+      cpu->ex_halt = 0;
+      cpu->stage[F].stalled =0;
     }
+  }
+}
 
-    if (strcmp(stage->opcode, "EXOR") == 0)
-    {
-    }*/
+/* A branch EX1 has already resolved only winds ins_completed back here */
+static void
+memory_resolve_branch(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  if (cpu->config.predictor == PREDICTOR_NONE && !cpu->config.early_redirect) {
+    memory_branch(cpu, stage);
+    return;
+  }
+  if (!cpu->config.early_redirect) {
+    resolve_branch(cpu, stage, last_memory_stage(&cpu->config));
+  }
+  if (stage->mem_address != 0) {
+    branch_taken_completed(cpu, stage);
+  }
+}
 
-    if (strcmp(stage->opcode, "BZ") == 0 || strcmp(stage->opcode, "BNZ") == 0)
-    {
-      if(stage->mem_address != 0)
-      {
-        cpu->pc =stage->mem_address;
-
-      //printf("\nTesting: %d: %d\n",cpu->stage[EX].rd,cpu->regs_valid[cpu->stage[EX].rd]);
-        if((strcmp(cpu->stage[MEM1].opcode, "ADD") == 0) || (strcmp(cpu->stage[MEM1].opcode, "SUB") == 0) || (strcmp(cpu->stage[MEM1].opcode, "MUL") == 0) || (strcmp(cpu->stage[MEM1].opcode, "AND") == 0) || (strcmp(cpu->stage[MEM1].opcode, "OR") == 0) || (strcmp(cpu->stage[MEM1].opcode, "EXOR") == 0) || (strcmp(cpu->stage[MEM1].opcode, "MOVC") == 0) || (strcmp(cpu->stage[MEM1].opcode, "LOAD") == 0) || (strcmp(cpu->stage[MEM1].opcode, "LDR") == 0) || (strcmp(cpu->stage[MEM1].opcode, "ADDL") == 0) || (strcmp(cpu->stage[MEM1].opcode, "SUBL") == 0))
-        {
-          cpu->regs_valid[cpu->stage[MEM1].rd]++;
-        }
-
-          //stage->flush=1;
-        cpu->stage[DRF].pc = 0;
-         strcpy(cpu->stage[DRF].opcode, "");
-         //cpu->stage[DRF].stalled = 1;
-        //cpu->stage[EX].stalled = 1;
-         strcpy(cpu->stage[MEM1].opcode, "");
-        cpu->stage[MEM1].pc = 0;
-
-        if(stage->imm < 0)
-        {
-          cpu->ins_completed = (cpu->ins_completed + (stage->imm/4))-1;
-        }
-
-        else
-        {
-          cpu->ins_completed = (cpu->ins_completed - (stage->imm/4));
-        }
-        if(cpu->ex_halt)
-        {
-          cpu->ex_halt = 0;
-          cpu->stage[F].stalled =0;
-        }
-      }
-    }
+/* HALT in stage_id: squashes every younger instruction, as a taken branch
+ * would, leaves a bubble right behind it and holds F and DRF empty until
+ * the HALT has written back
+ */
+static void
+squash_behind_halt(APEX_CPU* cpu, int stage_id)
+{
+  squash_younger(cpu, stage_id);
+  cpu->stage[stage_id - 1].stalled = 1;
+  cpu->stage[F].stalled = 1;
+  cpu->stage[DRF].stalled = 1;
+  cpu->ex_halt = 1;
+}
 
-    /*if (strcmp(stage->opcode, "BNZ") == 0)
-    {
-    }*/
+static void
+memory_halt(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  squash_behind_halt(cpu, last_memory_stage(&cpu->config));
+}
 
-    if (strcmp(stage->opcode, "JUMP") == 0)
-    {
-    }
+static const APEX_Stage_Handler memory_handlers[NUM_OPCODES] = {
+  [OPCODE_STORE] = memory_store,
+  [OPCODE_STR]   = memory_store,
+  [OPCODE_LOAD]  = memory_load,
+  [OPCODE_LDR]   = memory_load,
+  [OPCODE_BZ]    = memory_resolve_branch,
+  [OPCODE_BNZ]   = memory_resolve_branch,
+  [OPCODE_HALT]  = memory_halt,
+};
 
-    if(strcmp(stage->opcode, "HALT") == 0)
+/*
+ *  Memory Stage of APEX Pipeline
+ *
+ *  The last memory stage accesses data memory and resolves branches
+ *
+ *  Note : You are free to edit this function according to your
+ * 				 implementation
+ */
+int
+memory(APEX_CPU* cpu)
+{
+  int stage_id = last_memory_stage(&cpu->config);
+  CPU_Stage* stage = &cpu->stage[stage_id];
+  if (!stage->busy && !stage->stalled && stage->nop == 0)
+  {
+    APEX_Stage_Handler handler = memory_handlers[stage->opcode];
+    if (handler)
     {
-      cpu->stage[MEM1].pc = 0;
-      strcpy(cpu->stage[MEM1].opcode, "");
-      cpu->stage[DRF].pc = 0;
-      strcpy(cpu->stage[DRF].opcode, "");
-      cpu->stage[MEM1].stalled = 1;
-      cpu->stage[DRF].stalled = 1;
-       strcpy(cpu->stage[F].opcode, "");
-      cpu->stage[F].stalled = 1;
-      cpu->stage[F].pc = 0;
-      cpu->ex_halt=1;
+      handler(cpu, stage);
     }
 
+    /* Copy data from memory latch to writeback latch*/
+    cpu->stage[stage_id + 1] = *stage;
+    scoreboard_advance(cpu, stage_id);
 
-    /* Copy data from decode latch to execute latch*/
-    cpu->stage[WB] = cpu->stage[MEM2];
-
-    if (ENABLE_DEBUG_MESSAGES) {
-      print_stage_content("Memory 2", stage);
+    if (TRACING(cpu)) {
+      trace_stage(cpu, stage_id, stage);
     }
   }
 
   else
   {
-    cpu->stage[WB] = cpu->stage[MEM2];
+    cpu->stage[stage_id + 1] = *stage;
 
-    if (ENABLE_DEBUG_MESSAGES)
+    if (TRACING(cpu))
     {
-      printf("Memory 2         : EMPTY\n");
+      trace_empty(cpu, stage_id);
     }
   }
   return 0;
 }
+
+/* Update register file */
+static void
+writeback_register(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  cpu->regs[stage->rd] = stage->buffer;
+  scoreboard_release(cpu, writeback_stage(&cpu->config), stage->rd);
+  cpu->stage[DRF].stalled=0;
+  cpu->stage[F].stalled=0;
+}
+
+static void
+writeback_halt(APEX_CPU* cpu, CPU_Stage* stage)
+{
+  cpu->ins_completed = cpu->code_memory_size - 1;
+  squash_behind_halt(cpu, writeback_stage(&cpu->config));
+  cpu->stage[last_execute_stage(&cpu->config)].stalled = 1;
+}
+
+static const APEX_Stage_Handler writeback_handlers[NUM_OPCODES] = {
+  [OPCODE_MOVC]  = writeback_register,
+  [OPCODE_ADD]   = writeback_register,
+  [OPCODE_ADDL]  = writeback_register,
+  [OPCODE_SUB]   = writeback_register,
+  [OPCODE_SUBL]  = writeback_register,
+  [OPCODE_MUL]   = writeback_register,
+  [OPCODE_AND]   = writeback_register,
+  [OPCODE_OR]    = writeback_register,
+  [OPCODE_EXOR]  = writeback_register,
+  [OPCODE_LOAD]  = writeback_register,
+  [OPCODE_LDR]   = writeback_register,
+  [OPCODE_HALT]  = writeback_halt,
+};
+
 /*
  *  Writeback Stage of APEX Pipeline
  *
@@ -1038,175 +1468,230 @@ memory2(APEX_CPU* cpu)
 int
 writeback(APEX_CPU* cpu)
 {
-  CPU_Stage* stage = &cpu->stage[WB];
-  if (!stage->busy && !stage->stalled && stage->nop == 0 && (strcmp(stage->opcode,"")!=0))
+  int stage_id = writeback_stage(&cpu->config);
+  CPU_Stage* stage = &cpu->stage[stage_id];
+  if (!stage->busy && !stage->stalled && stage->nop == 0 && stage->opcode != OPCODE_NONE)
   {
-
-    /* Update register file */
-    if (strcmp(stage->opcode, "MOVC") == 0)
-    {
-      cpu->regs[stage->rd] = stage->buffer;
-      cpu->regs_valid[stage->rd]++;
-      cpu->stage[DRF].stalled=0;
-      cpu->stage[F].stalled=0;
-    }
-
-    if (strcmp(stage->opcode, "LOAD") == 0)
+    APEX_Stage_Handler handler = writeback_handlers[stage->opcode];
+    if (handler)
     {
-      cpu->regs[stage->rd] = stage->buffer;
-      cpu->regs_valid[stage->rd]++;
-      cpu->stage[DRF].stalled=0;
-      cpu->stage[F].stalled=0;
+      handler(cpu, stage);
     }
-
-    if (strcmp(stage->opcode, "LDR") == 0)
+    if (sets_zero_flag(stage))
     {
-      cpu->regs[stage->rd] = stage->buffer;
-      cpu->regs_valid[stage->rd]++;
-      cpu->stage[DRF].stalled=0;
-      cpu->stage[F].stalled=0;
+      zero_flag_release(cpu, stage_id, stage);
     }
 
-    if (strcmp(stage->opcode, "ADD") == 0)
-    {
-      cpu->regs[stage->rd] = stage->buffer;
-      cpu->regs_valid[stage->rd]++;
-      cpu->stage[DRF].stalled=0;
-      cpu->stage[F].stalled=0;
-    }
+    cpu->ins_completed++;
+    cpu->ins_committed++;
 
-    if (strcmp(stage->opcode, "ADDL") == 0)
-    {
-      cpu->regs[stage->rd] = stage->buffer;
-      cpu->regs_valid[stage->rd]++;
-      cpu->stage[DRF].stalled=0;
-      cpu->stage[F].stalled=0;
+    if (TRACING(cpu)) {
+      trace_stage(cpu, stage_id, stage);
     }
+  }
 
-    if (strcmp(stage->opcode, "SUB") == 0)
+  else
+  {
+    if (TRACING(cpu))
     {
-      cpu->regs[stage->rd] = stage->buffer;
-      cpu->regs_valid[stage->rd]++;
-      cpu->stage[DRF].stalled=0;
-      cpu->stage[F].stalled=0;
+      trace_empty(cpu, stage_id);
     }
+  }
+  return 0;
+}
 
-    if (strcmp(stage->opcode, "SUBL") == 0)
-    {
-      cpu->regs[stage->rd] = stage->buffer;
-      cpu->regs_valid[stage->rd]++;
-      cpu->stage[DRF].stalled=0;
-      cpu->stage[F].stalled=0;
-    }
+/* Whether decode would stall DRF on a source register */
+static int
+decode_waits_on_registers(APEX_CPU* cpu)
+{
+  CPU_Stage* stage = &cpu->stage[DRF];
+  APEX_Operand operands[3];
+  if (decode_handlers[stage->opcode] != decode_register_read) {
+    return 0;
+  }
+  return !find_operands(cpu, stage, operands);
+}
 
-    if (strcmp(stage->opcode, "MUL") == 0)
-    {
-      cpu->regs[stage->rd] = stage->buffer;
-      cpu->regs_valid[stage->rd]++;
-      cpu->stage[DRF].stalled=0;
-      cpu->stage[F].stalled=0;
-    }
+/* Whether memory and writeback leave a latch alone but for copying it */
+static int
+memory_idle(CPU_Stage* stage)
+{
+  return stage->busy || stage->stalled || stage->nop || !memory_handlers[stage->opcode];
+}
 
-    if (strcmp(stage->opcode, "AND") == 0)
-    {
-      cpu->regs[stage->rd] = stage->buffer;
-      cpu->regs_valid[stage->rd]++;
-      cpu->stage[DRF].stalled=0;
-      cpu->stage[F].stalled=0;
-    }
+static int
+writeback_idle(CPU_Stage* stage)
+{
+  return stage->busy || stage->stalled || stage->nop || stage->opcode == OPCODE_NONE;
+}
 
-    if (strcmp(stage->opcode, "OR") == 0)
-    {
-      cpu->regs[stage->rd] = stage->buffer;
-      cpu->regs_valid[stage->rd]++;
-      cpu->stage[DRF].stalled=0;
-      cpu->stage[F].stalled=0;
-    }
+/*
+ * Counts the coming cycles in which no stage can change state except by
+ * the passage of time. That is the case while DRF waits on a register
+ * that only a writeback can make valid, or with forwarding on, a load
+ * that only the last memory stage can bypass: F refetches the same pc, DRF
+ * sends the same bubble into EX1 every cycle and EX1 through Writeback
+ * only shift their latches, until an instruction reaches a stage with
+ * work to do. Counts at most one pass through EX1..Writeback, after which
+ * only bubbles are left and the pattern repeats.
+ */
+static int
+idle_cycles(APEX_CPU* cpu)
+{
+  CPU_Stage* drf = &cpu->stage[DRF];
+  if (!drf->stalled || drf->busy || drf->insflush || !decode_waits_on_registers(cpu)) {
+    return 0;
+  }
 
-    if (strcmp(stage->opcode, "EXOR") == 0)
-    {
-      cpu->regs[stage->rd] = stage->buffer;
-      cpu->regs_valid[stage->rd]++;
-      cpu->stage[DRF].stalled=0;
-      cpu->stage[F].stalled=0;
-    }
+  CPU_Stage* ex1 = &cpu->stage[EX1];
+  if (!ex1->busy && !ex1->stalled && execute1_handlers[ex1->opcode]) {
+    return 0;
+  }
 
-    if (strcmp(stage->opcode, "HALT") == 0)
-    {
-      //cpu->regs[stage->rd] = stage->buffer;
-       cpu->ins_completed = cpu->code_memory_size - 1;
-       cpu->stage[EX2].pc = 0;
-       strcpy(cpu->stage[EX2].opcode, "");
-       cpu->stage[DRF].pc = 0;
-       strcpy(cpu->stage[DRF].opcode, "");
-       cpu->stage[EX2].stalled = 1;
-       cpu->stage[DRF].stalled = 1;
-       cpu->stage[F].stalled = 1;
-       strcpy(cpu->stage[F].opcode, "");
-       cpu->stage[F].pc = 0;
-       cpu->stage[MEM2].pc = 0;
-       strcpy(cpu->stage[MEM2].opcode, "");
-       cpu->stage[MEM2].stalled = 1;
-       cpu->ex_halt=1;
+  /* In cycle t the last memory stage and Writeback hold what sat t stages
+   * before them, or the stalled bubble from DRF, which neither of them
+   * acts on
+   */
+  int mem = last_memory_stage(&cpu->config);
+  int wb = writeback_stage(&cpu->config);
+  int cycles = 0;
+  while (cycles <= wb - EX1) {
+    if ((mem - cycles >= EX1 && !memory_idle(&cpu->stage[mem - cycles])) ||
+        (wb - cycles >= EX1 && !writeback_idle(&cpu->stage[wb - cycles]))) {
+      break;
     }
+    cycles++;
+  }
+  return cycles;
+}
 
-    cpu->ins_completed++;
+/* Advances the pipeline by cycles counted by idle_cycles in one step */
+static void
+skip_idle_cycles(APEX_CPU* cpu, int cycles)
+{
+  CPU_Stage bubble = cpu->stage[DRF];
+  bubble.stalled = 1;
+  bubble.arithminstr = (opcode_info[bubble.opcode].flags & OPCODE_ARITH) ? 1 : 0;
 
-    if (ENABLE_DEBUG_MESSAGES) {
-      print_stage_content("Writeback", stage);
+  for (int i = writeback_stage(&cpu->config); i >= EX1; --i) {
+    cpu->stage[i] = (i - cycles >= EX1) ? cpu->stage[i - cycles] : bubble;
+  }
+  for (int r = 0; r < 32; ++r) {
+    if ((cpu->regs_pending & REG_BIT(r)) && cpu->regs_producer[r] >= EX1) {
+      cpu->regs_producer[r] += cycles;
     }
   }
+  if (cpu->zero_producer >= EX1) {
+    cpu->zero_producer += cycles;
+  }
 
-  else
-  {
-    if (ENABLE_DEBUG_MESSAGES)
-    {
-      printf("Writeback      : EMPTY\n");
+  cpu->stage[DRF].arithminstr = bubble.arithminstr;
+  cpu->stage[F].stalled = 1;
+  cpu->stage[F].pc = cpu->pc;
+  fetch_instruction(cpu, &cpu->stage[F]);
+  cpu->clock += cycles;
+}
+
+/* Whether Fetch has left code memory with no instruction left in flight.
+ * The program can then never commit another instruction, so it has ended,
+ * just as the functional engine ends it past the end of code memory. F and
+ * DRF hold what they hold until it moves on, later stages hold bubbles
+ * while busy or stalled, and from EX2 on also while nop. In EX1 nop marks
+ * a multi-cycle op that is still working.
+ */
+static int
+pipeline_drained(const APEX_CPU* cpu)
+{
+  if (pc_in_code_memory(cpu)) {
+    return 0;
+  }
+  for (int i = F; i <= writeback_stage(&cpu->config); ++i) {
+    const CPU_Stage* stage = &cpu->stage[i];
+    if (stage->opcode == OPCODE_NONE) {
+      continue;
+    }
+    if (i <= DRF || (!stage->busy && !stage->stalled && (i == EX1 || !stage->nop))) {
+      return 0;
     }
   }
-  return 0;
+  return 1;
 }
 
 /*
- *  APEX CPU simulation loop
- *
- *  Note : You are free to edit this function according to your
- * 				 implementation
+ * Runs the pipeline until the program completes, cpu->clock reaches
+ * stop_clock or Fetch is about to fetch stop_pc. A negative stop_clock or
+ * stop_pc is never reached. Returns 1 once the program has completed, 0
+ * when paused.
  */
 int
-APEX_cpu_run(APEX_CPU* cpu)
+APEX_cpu_run_until(APEX_CPU* cpu, int stop_clock, int stop_pc)
 {
   while (1)
   {
 
-    /* All the instructions committed, so exit */
+    /* All the instructions committed, or the program ran off code
+     * memory and drained, so exit
+     */
     if (cpu->ins_completed == cpu->code_memory_size) {
-      printf("(apex) >> Simulation Complete");
-      break;
+      return 1;
+    }
+    if (pipeline_drained(cpu)) {
+      cpu->ins_completed = cpu->code_memory_size;
+      return 1;
+    }
+
+    if ((stop_clock >= 0 && cpu->clock >= stop_clock) ||
+        (stop_pc >= 0 && cpu->pc == stop_pc)) {
+      return 0;
     }
 
-    if (ENABLE_DEBUG_MESSAGES) {
-      printf("--------------------------------\n");
-      printf("Clock Cycle #: %d\n", cpu->clock);
-      printf("--------------------------------\n");
+    if (TRACING(cpu)) {
+      trace_cycle(cpu);
+    }
+    else {
+      /* Every cycle is printed while tracing, otherwise stalls can be
+       * skipped over
+       */
+      int cycles = idle_cycles(cpu);
+      if (stop_clock >= 0 && cycles > stop_clock - cpu->clock) {
+        cycles = stop_clock - cpu->clock;
+      }
+      if (cycles) {
+        skip_idle_cycles(cpu, cycles);
+        continue;
+      }
     }
 
     writeback(cpu);
-    memory2(cpu);
-    memory1(cpu);
-    execute2(cpu);
+    memory(cpu);
+    for (int i = last_memory_stage(&cpu->config) - 1; i > EX1; --i) {
+      pass_stage(cpu, i);
+    }
     execute1(cpu);
     decode(cpu);
     fetch(cpu);
 
     cpu->clock++;
   }
+}
+
+/*
+ *  APEX CPU simulation loop
+ *
+ *  Note : You are free to edit this function according to your
+ * 				 implementation
+ */
+int
+APEX_cpu_run(APEX_CPU* cpu)
+{
+  APEX_cpu_run_until(cpu, -1, -1);
+  printf("(apex) >> Simulation Complete");
     printf("\n");
     printf("========ARCHITECTURAL REGISTER VALUES========\n");
     for(int j=0;j<=15;j++)
     {
       //printf("\n");
-      printf(" | Reg[%d] | Value = %d | Status = %s | \n",j,cpu->regs[j], (cpu->regs_valid[j])?"Valid" : "Invalid");
+      printf(" | Reg[%d] | Value = %d | Status = %s | \n",j,cpu->regs[j], (cpu->regs_pending & REG_BIT(j))?"Invalid" : "Valid");
     }
     //printf("\n\n");
     printf("======DATA MEMORY======\n");
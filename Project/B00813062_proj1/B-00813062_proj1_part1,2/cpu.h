@@ -8,53 +8,269 @@
  *  Akshay Shinde (ashinde3@binghamton.edu)
  *  State University of New York, Binghamton
  */
+#include <stddef.h>
+#include <stdint.h>
 
+/* Stage ids. The execute stages follow EX1, then the memory stages and
+ * Writeback, as many of each as the pipeline shape in APEX_Config asks for
+ */
 enum
 {
   F,
   DRF,
-  EX1,
-  EX2,
-  MEM1,
-  MEM2,
-  WB,
-  NUM_STAGES
+  EX1
+};
+
+#define APEX_MAX_EX_STAGES 8
+#define APEX_MAX_MEM_STAGES 8
+#define APEX_MAX_STAGES (EX1 + APEX_MAX_EX_STAGES + APEX_MAX_MEM_STAGES + 1)
+
+/* Trace levels, each level also prints everything the levels below print */
+enum
+{
+  TRACE_OFF,        // Final register and memory dump only
+  TRACE_COMMIT,     // Clock cycle banner and instructions leaving Writeback
+  TRACE_STAGE,      // Every stage latch, every cycle
+  TRACE_FULL,       // Code memory at start up as well
+  NUM_TRACE_LEVELS
+};
+
+/* Opcode IDs, predecoded once by the file parser */
+enum
+{
+  OPCODE_NONE,      // Empty latch, no instruction
+  OPCODE_INVALID,   // Mnemonic not recognized by the parser
+  OPCODE_MOVC,
+  OPCODE_STORE,
+  OPCODE_STR,
+  OPCODE_ADD,
+  OPCODE_ADDL,
+  OPCODE_SUB,
+  OPCODE_SUBL,
+  OPCODE_MUL,
+  OPCODE_AND,
+  OPCODE_OR,
+  OPCODE_EXOR,
+  OPCODE_LOAD,
+  OPCODE_LDR,
+  OPCODE_BZ,
+  OPCODE_BNZ,
+  OPCODE_JUMP,
+  OPCODE_HALT,
+  NUM_OPCODES
 };
 
-/* Format of an APEX instruction  */
+/* Operand-class flags of an opcode, operands appear in this order */
+#define OPERAND_RD    0x01  // Writes destination register
+#define OPERAND_RS1   0x02  // Reads source-1 register
+#define OPERAND_RS2   0x04  // Reads source-2 register
+#define OPERAND_RS3   0x08  // Reads source-3 register
+#define OPERAND_IMM   0x10  // Carries a literal
+#define OPCODE_ARITH  0x20  // Arithmetic op, updates the zero flag
+
+/* Static properties of an opcode */
+typedef struct APEX_Opcode_Info
+{
+  const char* name;   // Mnemonic
+  int flags;          // Operand-class flags
+} APEX_Opcode_Info;
+
+extern const APEX_Opcode_Info opcode_info[NUM_OPCODES];
+
+/* Registers in the register file, R0 to R31 */
+#define APEX_NUM_REGS 32
+
+/* Register arithmetic and address sums wrap through unsigned ints, every
+ * engine agrees on the result where signed overflow would be undefined
+ */
+#define APEX_ADD(a, b) ((int)((unsigned)(a) + (unsigned)(b)))
+#define APEX_SUB(a, b) ((int)((unsigned)(a) - (unsigned)(b)))
+#define APEX_MUL(a, b) ((int)((unsigned)(a) * (unsigned)(b)))
+
+/* Format of an APEX instruction, packed into 12 bytes */
 typedef struct APEX_Instruction
 {
-  char opcode[128];	// Operation Code
-  int rd;		    // Destination Register Address
-  int rs1;		    // Source-1 Register Address
-  int rs2;		    // Source-2 Register Address
-  int rs3;        // New Source-3 Register Address
-  int imm;		    // Literal Value
+  uint8_t opcode;   // Predecoded opcode ID
+  uint8_t flags;    // Operand-class flags
+  uint8_t rd;		    // Destination Register Address
+  uint8_t rs1;		  // Source-1 Register Address
+  uint8_t rs2;		  // Source-2 Register Address
+  uint8_t rs3;      // New Source-3 Register Address
+  int imm;		      // Literal Value
 } APEX_Instruction;
 
-/* Model of CPU stage latch */
+/* Model of CPU stage latch, 32 bytes so two latches share a cache line */
 typedef struct CPU_Stage
 {
-  int pc;		    // Program Counter
-  char opcode[128];	// Operation Code
-  int rs1;		    // Source-1 Register Address
-  int rs2;		    // Source-2 Register Address
-  int rs3;        // New Source-3 Register Address
-  int rd;		    // Destination Register Address
-  int imm;		    // Literal Value
-  int rs1_value;	// Source-1 Register Value
-  int rs2_value;	// Source-2 Register Value
-  int rs3_value;  //New Source-3 Register Value
-  int buffer;		// Latch to hold some value
-  int mem_address;	// Computed Memory Address
-  int busy;		    // Flag to indicate, stage is performing some action
-  int stalled;		// Flag to indicate, stage is stalled
-  int insflush;   // Flag to idicate instruction flush
-  int arithminstr;
-  int nop;
-  int mulFlag;
+  int pc;		        // Program Counter
+  uint8_t opcode;	  // Opcode ID
+  uint8_t rs1;		  // Source-1 Register Address
+  uint8_t rs2;		  // Source-2 Register Address
+  uint8_t rs3;      // New Source-3 Register Address
+  uint8_t rd;		    // Destination Register Address
+  uint8_t busy : 1;		    // Flag to indicate, stage is performing some action
+  uint8_t stalled : 1;		// Flag to indicate, stage is stalled
+  uint8_t insflush : 1;   // Flag to idicate instruction flush
+  uint8_t arithminstr : 1;
+  uint8_t nop : 1;
+  uint8_t predicted_taken : 1;  // Fetch followed the BTB target of this branch
+  uint8_t zero_flag : 1;        // Zero flag as the op left EX1, a branch's input before
+  uint8_t ex_cycles;      // Cycles a multi-cycle op has spent in EX1
+  int imm;		      // Literal Value
+  /* BZ and BNZ read no register and write none, the predictor keeps what
+   * it needs to resolve them in rs1_value and buffer
+   */
+  union {
+    int rs1_value;	  // Source-1 Register Value
+    int history;      // Global history the branch was predicted with
+  };
+  int rs2_value;	  // Source-2 Register Value
+  union {
+    int buffer;		    // Latch to hold some value
+    int fetch_clock;  // Cycle the branch was fetched in
+  };
+  /* rs3 is only read by STR, in the EX1 cycle that computes its address */
+  union {
+    int rs3_value;    //New Source-3 Register Value
+    int mem_address;	// Computed Memory Address
+  };
 } CPU_Stage;
 
+_Static_assert(sizeof(APEX_Instruction) <= 16, "APEX_Instruction must stay packed");
+_Static_assert(sizeof(CPU_Stage) == 32, "CPU_Stage must stay 32 bytes");
+
+/* Kinds of binary trace record, one per line of the stage-level text trace */
+enum
+{
+  APEX_TRACE_CYCLE,   // Clock cycle banner, pc holds the cycle
+  APEX_TRACE_STAGE,   // Stage latch holding an instruction
+  APEX_TRACE_EMPTY    // Stage with nothing to show
+};
+
+/* Why a stage latch is held */
+enum
+{
+  APEX_STALL_NONE,
+  APEX_STALL_DEPENDENCE,  // Waiting on a source register or the zero flag
+  APEX_STALL_LATENCY,     // Held while a multi-cycle op occupies EX1
+  APEX_STALL_HALT,        // Frozen after HALT
+  NUM_STALL_REASONS
+};
+
+/* Binary trace record, 16 bytes */
+typedef struct APEX_Trace_Record
+{
+  int32_t pc;       // Stage pc, or the clock cycle of an APEX_TRACE_CYCLE
+  int32_t imm;      // Literal Value
+  uint8_t kind;     // APEX_TRACE_CYCLE .. APEX_TRACE_EMPTY
+  uint8_t stage;    // F .. Writeback, numbered as in the header's shape
+  uint8_t opcode;   // Opcode ID
+  uint8_t stall;    // Stall reason
+  uint8_t rd;
+  uint8_t rs1;
+  uint8_t rs2;
+  uint8_t rs3;
+} APEX_Trace_Record;
+
+_Static_assert(sizeof(APEX_Trace_Record) == 16, "APEX_Trace_Record must stay 16 bytes");
+
+/* A trace file is this header followed by the records, in host byte order
+ * and gzip compressed as a whole. Bump APEX_TRACE_VERSION whenever
+ * APEX_Trace_Record or its codes change.
+ */
+#define APEX_TRACE_MAGIC "APXT"
+#define APEX_TRACE_VERSION 2
+
+typedef struct APEX_Trace_Header
+{
+  char magic[4];
+  uint16_t version;
+  uint16_t record_size;
+  uint8_t ex_stages;    // Pipeline shape the stage ids refer to
+  uint8_t mem_stages;
+  uint16_t reserved;
+} APEX_Trace_Header;
+
+/* Streams trace records to a compressed file from its own thread */
+typedef struct APEX_Trace_Writer APEX_Trace_Writer;
+
+/* Code memory translated for the functional engine */
+typedef struct APEX_Threaded_Op APEX_Threaded_Op;
+
+/* Native code cache of the functional JIT */
+typedef struct APEX_Jit APEX_Jit;
+
+/* Pipeline parameters a run can vary, set from "key=value,..." specs or
+ * config files
+ */
+typedef struct APEX_Config
+{
+  int ex_stages;              // Execute stages, EX1 does the work
+  int mem_stages;             // Memory stages, the last one accesses memory
+  int latency[NUM_OPCODES];   // Cycles each opcode spends in EX1, at least 1
+  int forwarding;             // 1 to bypass results and zero flag to DRF, 0 to wait for Writeback
+  int early_redirect;         // 1 to redirect Fetch from EX1, 0 from the last memory stage
+  int predictor;              // PREDICTOR_NONE .. PREDICTOR_TOURNAMENT
+  int btb_entries;
+  int predictor_entries;      // Counters in each direction table
+  int history_bits;           // Global history length used by gshare
+} APEX_Config;
+
+/* Outcome of one configuration run from a what-if branch point */
+typedef struct APEX_What_If_Result
+{
+  int completed;      // 1 if the program ran to completion
+  int clock;          // Clock cycles at the end of the run
+  long ins_committed; // Instructions committed by then
+} APEX_What_If_Result;
+
+/* Branch direction predictors, selected by the predictor config key */
+enum
+{
+  PREDICTOR_NONE,         // Fetch falls through, taken branches redirect it
+  PREDICTOR_BIMODAL,      // 2-bit counters indexed by pc
+  PREDICTOR_GSHARE,       // 2-bit counters indexed by pc xor global history
+  PREDICTOR_TOURNAMENT,   // 2-bit chooser between bimodal and gshare, by pc
+  NUM_PREDICTORS
+};
+
+#define APEX_MAX_BTB_ENTRIES 1024
+#define APEX_MAX_PREDICTOR_ENTRIES 4096
+#define APEX_MAX_HISTORY_BITS 12
+#define APEX_MAX_BRANCH_STATS 64
+
+/* Branch target buffer entry, pc 0 while empty */
+typedef struct APEX_BTB_Entry
+{
+  int pc;
+  int target;
+} APEX_BTB_Entry;
+
+/* How the predictor did on one static branch, or on all of them */
+typedef struct APEX_Branch_Stats
+{
+  int pc;
+  long resolved;        // Times the branch reached the last memory stage
+  long taken;
+  long mispredicted;
+  long penalty_cycles;  // Cycles the correct path was fetched late, summed
+} APEX_Branch_Stats;
+
+/* BTB, direction tables and their statistics, all sized for the largest
+ * configuration so that they live in APEX_CPU
+ */
+typedef struct APEX_Predictor
+{
+  int history;    // Global history, newest outcome in bit 0
+  APEX_BTB_Entry btb[APEX_MAX_BTB_ENTRIES];
+  uint8_t bimodal[APEX_MAX_PREDICTOR_ENTRIES];  // Saturating counters, 2 and 3 predict taken
+  uint8_t gshare[APEX_MAX_PREDICTOR_ENTRIES];
+  uint8_t chooser[APEX_MAX_PREDICTOR_ENTRIES];  // 2 and 3 pick gshare
+  APEX_Branch_Stats total;
+  int num_branches;
+  APEX_Branch_Stats branches[APEX_MAX_BRANCH_STATS];  // In order of first resolution
+} APEX_Predictor;
+
 /* Model of APEX CPU */
 typedef struct APEX_CPU
 {
@@ -67,34 +283,139 @@ typedef struct APEX_CPU
   int pc;
   int ex_halt;
 
+  /* Pipeline parameters, APEX_config_default unless changed */
+  APEX_Config config;
+
+  /* Trace level, one of TRACE_OFF .. TRACE_FULL */
+  int trace_level;
+  int tracing;                      // Nonzero if any text or binary trace is on
+  APEX_Trace_Writer* trace_writer;  // Binary trace, NULL if off
+
   /* Integer register file */
-  int regs[32];
-  int regs_valid[32];
+  int regs[APEX_NUM_REGS];
+
+  /* Scoreboard: bit r of regs_pending is set while an instruction past DRF
+   * will write register r, regs_producer[r] is the latch holding the
+   * youngest of them
+   */
+  uint32_t regs_pending;
+  uint8_t regs_producer[APEX_NUM_REGS];
 
-  /* Array of 7 CPU_stage */
-  CPU_Stage stage[7];
+  /* The zero flag is renamed the same way: zero_producer is the latch
+   * holding the youngest instruction past DRF that sets it, -1 if none.
+   * With forwarding on only Writeback updates zeroFlag.
+   */
+  int zero_producer;
+
+  /* CPU_stage latches, only the first 3 + ex_stages + mem_stages are used */
+  CPU_Stage stage[APEX_MAX_STAGES];
 
   /* Code Memory where instructions are stored */
   APEX_Instruction* code_memory;
   int code_memory_size;
+  size_t code_memory_mapped;  // Bytes mapped from an .apexo file, 0 if parsed
+  size_t checkpoint_mapped;   // Bytes mapped from an .apexc checkpoint, 0 if allocated
+  APEX_Threaded_Op* threaded_code;  // Built by the functional engine, NULL until used
+  APEX_Jit* jit;                    // Built by the functional JIT, NULL until used
 
   /* Data Memory */
   int data_memory[4096];
 
+  /* Branch prediction, in use unless config.predictor is PREDICTOR_NONE */
+  APEX_Predictor predictor;
+
   /* Some stats */
   int ins_completed;
+  long ins_committed;   // Instructions retired by Writeback
+  long forwarded[APEX_MAX_STAGES];  // Operands bypassed into DRF, by producing stage
 
 } APEX_CPU;
 
 APEX_Instruction*
 create_code_memory(const char* filename, int* size);
 
+int
+valid_instruction(const APEX_Instruction* ins);
+
+APEX_Instruction*
+load_code_memory(const char* filename, int* size, size_t* mapped_size);
+
+void
+free_code_memory(APEX_Instruction* code_memory, size_t mapped_size);
+
 APEX_CPU*
-APEX_cpu_init(const char* filename);
+APEX_cpu_init(const char* filename, int trace_level);
+
+int
+APEX_cpu_set_trace_file(APEX_CPU* cpu, const char* path);
+
+long
+APEX_cpu_fast_forward(APEX_CPU* cpu, int stop_pc, long max_instructions);
+
+long
+APEX_cpu_run_functional(APEX_CPU* cpu, int stop_pc, long max_instructions, int* done);
+
+void
+APEX_cpu_hand_over(APEX_CPU* cpu, int done);
+
+long
+APEX_cpu_fast_forward_jit(APEX_CPU* cpu, int stop_pc, long max_instructions);
+
+void
+free_threaded_code(APEX_Threaded_Op* code);
+
+void
+free_jit(APEX_Jit* jit);
+
+int
+get_code_index(int pc);
 
 int
 APEX_cpu_run(APEX_CPU* cpu);
 
+int
+APEX_cpu_run_until(APEX_CPU* cpu, int stop_clock, int stop_pc);
+
+void
+APEX_config_default(APEX_Config* config);
+
+int
+APEX_config_parse(APEX_Config* config, const char* spec);
+
+int
+APEX_config_load(APEX_Config* config, const char* path);
+
+int
+APEX_config_check(const APEX_Config* config);
+
+int
+APEX_cpu_set_config(APEX_CPU* cpu, const APEX_Config* config);
+
+void
+APEX_predictor_init(APEX_Predictor* predictor);
+
+int
+APEX_predictor_predict(APEX_Predictor* predictor, const APEX_Config* config, int pc,
+                       int* target);
+
+int
+APEX_predictor_resolve(APEX_Predictor* predictor, const APEX_Config* config, int pc,
+                       int history, int predicted_taken, int taken, int target,
+                       int late_cycles);
+
+int
+APEX_cpu_what_if(APEX_CPU* cpu, const APEX_Config* configs, int count, int max_clock,
+                 APEX_What_If_Result* results);
+
+int
+APEX_cpu_save_checkpoint(APEX_CPU* cpu, const char* path);
+
+APEX_CPU*
+APEX_cpu_restore_checkpoint(const char* path, int trace_level);
+
+void
+free_checkpoint(APEX_CPU* cpu);
+
 void
 APEX_cpu_stop(APEX_CPU* cpu);
 
@@ -108,15 +429,39 @@ int
 execute1(APEX_CPU* cpu);
 
 int
-execute2(APEX_CPU* cpu);
+pass_stage(APEX_CPU* cpu, int stage_id);
 
 int
-memory1(APEX_CPU* cpu);
+memory(APEX_CPU* cpu);
 
 int
-memory2(APEX_CPU* cpu);
+writeback(APEX_CPU* cpu);
+
+void
+print_cycle_banner(int clock);
+
+void
+print_stage(const APEX_Config* config, int stage_id, CPU_Stage* stage);
+
+void
+print_empty_stage(const APEX_Config* config, int stage_id);
+
+void
+stage_label(char* label, const APEX_Config* config, int stage_id);
+
+APEX_Trace_Writer*
+trace_writer_open(const char* path, const APEX_Config* config);
+
+void
+trace_writer_push(APEX_Trace_Writer* writer, const APEX_Trace_Record* record);
+
+void
+trace_writer_close(APEX_Trace_Writer* writer);
+
+/* Job of a thread pool run, called once for every index */
+typedef void (*APEX_Pool_Job)(void* arg, int index);
 
 int
-writeback(APEX_CPU* cpu);
+APEX_pool_run(int num_jobs, int num_threads, APEX_Pool_Job job, void* arg);
 
 #endif
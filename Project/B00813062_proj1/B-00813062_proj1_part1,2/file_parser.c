@@ -7,206 +7,227 @@
  *  Akshay Shinde (ashinde3@binghamton.edu)
  *  State University of New York, Binghamton
  */
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "cpu.h"
 
 /*
- * This function is related to parsing input file
- *
- * Note : You are not supposed to edit this function
+ * Reads the number of a register or literal field such as "R13" or "#-12"
+ * straight from the mapped file: the leading character is skipped and the
+ * rest is read the way atoi would. Leaves *text at the end of the field.
  */
 static int
-get_num_from_string(char* buffer)
-{
-  char str[16];
-  int j = 0;
-  for (int i = 1; buffer[i] != '\0'; ++i) {
-    str[j] = buffer[i];
-    j++;
-  }
-  str[j] = '\0';
-  return atoi(str);
-}
-
-/*
- * This function is related to parsing input file
- *
- * Note : you can edit this function to add new instructions
- */
-static void
-create_APEX_instruction(APEX_Instruction* ins, char* buffer)
+get_num_from_field(const char** text, const char* text_end)
 {
-  char* token = strtok(buffer, ",");
-  int token_num = 0;
-  char tokens[6][128];
-  while (token != NULL)
-  {
-    strcpy(tokens[token_num], token);
-    token_num++;
-    token = strtok(NULL, ",");
-  }
-
-  strcpy(ins->opcode, tokens[0]);
+  const char* p = *text + 1;
+  int negative = 0;
+  int value = 0;
 
-  if (strcmp(ins->opcode, "MOVC") == 0) {
-    ins->rd = get_num_from_string(tokens[1]);
-    ins->imm = get_num_from_string(tokens[2]);
+  while (p < text_end && (*p == ' ' || *p == '\t')) {
+    p++;
   }
-
-  if (strcmp(ins->opcode, "STORE") == 0) {
-    ins->rs1 = get_num_from_string(tokens[1]);
-    ins->rs2 = get_num_from_string(tokens[2]);
-    ins->imm = get_num_from_string(tokens[3]);
+  if (p < text_end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    p++;
   }
-
-  if(strcmp(ins->opcode, "STR") == 0)
-  {
-    ins->rs1 = get_num_from_string(tokens[1]);
-    ins->rs2 = get_num_from_string(tokens[2]);
-    ins->rs3 = get_num_from_string(tokens[3]);
+  while (p < text_end && *p >= '0' && *p <= '9') {
+    value = value * 10 + (*p - '0');
+    p++;
   }
-
-  if(strcmp(ins->opcode, "ADD") == 0)
-  {
-    ins->rd = get_num_from_string(tokens[1]);
-    ins->rs1 = get_num_from_string(tokens[2]);
-    ins->rs2 = get_num_from_string(tokens[3]);
-  }
-
-  if(strcmp(ins->opcode, "ADDL") == 0)
-  {
-    ins->rd = get_num_from_string(tokens[1]);
-    ins->rs1 = get_num_from_string(tokens[2]);
-    ins->imm = get_num_from_string(tokens[3]);
+  while (p < text_end && *p != ',' && *p != '\n') {
+    p++;
   }
 
-  if(strcmp(ins->opcode, "SUB") == 0)
-  {
-    ins->rd = get_num_from_string(tokens[1]);
-    ins->rs1 = get_num_from_string(tokens[2]);
-    ins->rs2 = get_num_from_string(tokens[3]);
-  }
-
-  if(strcmp(ins->opcode, "SUBL") == 0)
-  {
-    ins->rd = get_num_from_string(tokens[1]);
-    ins->rs1 = get_num_from_string(tokens[2]);
-    ins->imm = get_num_from_string(tokens[3]);
-  }
-
-  if(strcmp(ins->opcode, "MUL") == 0)
-  {
-    ins->rd = get_num_from_string(tokens[1]);
-    ins->rs1 = get_num_from_string(tokens[2]);
-    ins->rs2 = get_num_from_string(tokens[3]);
-  }
-
-  if(strcmp(ins->opcode, "AND") == 0)
-  {
-    ins->rd = get_num_from_string(tokens[1]);
-    ins->rs1 = get_num_from_string(tokens[2]);
-    ins->rs2 = get_num_from_string(tokens[3]);
-  }
-
-  if(strcmp(ins->opcode, "OR") == 0)
-  {
-    ins->rd = get_num_from_string(tokens[1]);
-    ins->rs1 = get_num_from_string(tokens[2]);
-    ins->rs2 = get_num_from_string(tokens[3]);
-  }
-
-  if(strcmp(ins->opcode, "EXOR") == 0)
-  {
-    ins->rd = get_num_from_string(tokens[1]);
-    ins->rs1 = get_num_from_string(tokens[2]);
-    ins->rs2 = get_num_from_string(tokens[3]);
-  }
-
-  if(strcmp(ins->opcode, "LOAD") == 0)
-  {
-    ins->rd = get_num_from_string(tokens[1]);
-    ins->rs1 = get_num_from_string(tokens[2]);
-    ins->imm = get_num_from_string(tokens[3]);
-  }
-
-  if(strcmp(ins->opcode, "LDR") == 0)
-  {
-    ins->rd = get_num_from_string(tokens[1]);
-    ins->rs1 = get_num_from_string(tokens[2]);
-    ins->rs2 = get_num_from_string(tokens[3]);
-  }
+  *text = p;
+  return negative ? -value : value;
+}
 
-  if(strcmp(ins->opcode, "BZ") == 0)
-  {
-    ins->imm = get_num_from_string(tokens[1]);
+/*
+ * Moves *text to the start of the next non-empty field of the line,
+ * returns 0 once the line is exhausted
+ */
+static int
+next_field(const char** text, const char* text_end)
+{
+  const char* p = *text;
+  while (p < text_end && (*p == ',' || *p == '\r')) {
+    p++;
   }
+  *text = p;
+  return p < text_end && *p != '\n';
+}
 
-  if(strcmp(ins->opcode, "BNZ") == 0)
-  {
-    ins->imm = get_num_from_string(tokens[1]);
-  }
+/* Mnemonic and operand classes of every opcode, indexed by opcode ID */
+const APEX_Opcode_Info opcode_info[NUM_OPCODES] = {
+  [OPCODE_NONE]    = { "",      0 },
+  [OPCODE_INVALID] = { "INVALID", 0 },
+  [OPCODE_MOVC]    = { "MOVC",  OPERAND_RD | OPERAND_IMM },
+  [OPCODE_STORE]   = { "STORE", OPERAND_RS1 | OPERAND_RS2 | OPERAND_IMM },
+  [OPCODE_STR]     = { "STR",   OPERAND_RS1 | OPERAND_RS2 | OPERAND_RS3 },
+  [OPCODE_ADD]     = { "ADD",   OPERAND_RD | OPERAND_RS1 | OPERAND_RS2 | OPCODE_ARITH },
+  [OPCODE_ADDL]    = { "ADDL",  OPERAND_RD | OPERAND_RS1 | OPERAND_IMM | OPCODE_ARITH },
+  [OPCODE_SUB]     = { "SUB",   OPERAND_RD | OPERAND_RS1 | OPERAND_RS2 | OPCODE_ARITH },
+  [OPCODE_SUBL]    = { "SUBL",  OPERAND_RD | OPERAND_RS1 | OPERAND_IMM | OPCODE_ARITH },
+  [OPCODE_MUL]     = { "MUL",   OPERAND_RD | OPERAND_RS1 | OPERAND_RS2 | OPCODE_ARITH },
+  [OPCODE_AND]     = { "AND",   OPERAND_RD | OPERAND_RS1 | OPERAND_RS2 },
+  [OPCODE_OR]      = { "OR",    OPERAND_RD | OPERAND_RS1 | OPERAND_RS2 },
+  [OPCODE_EXOR]    = { "EXOR",  OPERAND_RD | OPERAND_RS1 | OPERAND_RS2 },
+  [OPCODE_LOAD]    = { "LOAD",  OPERAND_RD | OPERAND_RS1 | OPERAND_IMM },
+  [OPCODE_LDR]     = { "LDR",   OPERAND_RD | OPERAND_RS1 | OPERAND_RS2 },
+  [OPCODE_BZ]      = { "BZ",    OPERAND_IMM },
+  [OPCODE_BNZ]     = { "BNZ",   OPERAND_IMM },
+  [OPCODE_JUMP]    = { "JUMP",  OPERAND_RS1 | OPERAND_IMM },
+  [OPCODE_HALT]    = { "HALT",  0 },
+};
 
-  if(strcmp(ins->opcode, "JUMP") == 0)
-  {
-    ins->rs1 = get_num_from_string(tokens[1]);
-    ins->imm = get_num_from_string(tokens[2]);
-  }
+/*
+ * Whether ins has a known opcode and names only registers in the register
+ * file, in the operands its opcode reads or writes. Code memory that did
+ * not come from the parser must pass this before a stage indexes regs with
+ * it.
+ */
+int
+valid_instruction(const APEX_Instruction* ins)
+{
+  if (ins->opcode >= NUM_OPCODES) {
+    return 0;
+  }
+  int flags = opcode_info[ins->opcode].flags;
+  return (!(flags & OPERAND_RD) || ins->rd < APEX_NUM_REGS) &&
+         (!(flags & OPERAND_RS1) || ins->rs1 < APEX_NUM_REGS) &&
+         (!(flags & OPERAND_RS2) || ins->rs2 < APEX_NUM_REGS) &&
+         (!(flags & OPERAND_RS3) || ins->rs3 < APEX_NUM_REGS);
+}
 
-  if(strcmp(ins->opcode, "HALT") == 0)
-  {
-  }
+/*
+ * Maps the mnemonic in [begin, end) to its opcode ID, OPCODE_INVALID if
+ * unknown
+ */
+static int
+lookup_opcode(const char* begin, const char* end)
+{
+  size_t len = end - begin;
+  for (int op = OPCODE_MOVC; op < NUM_OPCODES; ++op) {
+    const char* name = opcode_info[op].name;
+    if (name[0] == begin[0] && strncmp(name, begin, len) == 0 && name[len] == '\0') {
+      return op;
+    }
+  }
+  return OPCODE_INVALID;
+}
 
+/*
+ * This function is related to parsing input file
+ *
+ * Parses the line starting at text in a single scan: the mnemonic is
+ * predecoded into an opcode ID and operand-class flags, then the operands
+ * the flags call for are read in rd, rs1, rs2, rs3, imm order. Empty
+ * fields are skipped and nothing is copied out of the mapped file.
+ * Returns the start of the next line.
+ *
+ * Note : to add new instructions, add them to the opcode enum and
+ *        opcode_info table
+ */
+static const char*
+create_APEX_instruction(APEX_Instruction* ins, const char* text, const char* text_end)
+{
+  static const int operand_order[] = {
+    OPERAND_RD, OPERAND_RS1, OPERAND_RS2, OPERAND_RS3, OPERAND_IMM
+  };
+  int operands[5] = { 0 };
+  const char* p = text;
+
+  ins->opcode = OPCODE_INVALID;
+  if (next_field(&p, text_end)) {
+    const char* mnemonic = p;
+    while (p < text_end && *p != ',' && *p != '\n' && *p != '\r') {
+      p++;
+    }
+    ins->opcode = lookup_opcode(mnemonic, p);
+  }
+  ins->flags = opcode_info[ins->opcode].flags;
+
+  for (int i = 0; i < 5; ++i) {
+    if ((ins->flags & operand_order[i]) && next_field(&p, text_end)) {
+      operands[i] = get_num_from_field(&p, text_end);
+    }
+  }
+  ins->rd = operands[0];
+  ins->rs1 = operands[1];
+  ins->rs2 = operands[2];
+  ins->rs3 = operands[3];
+  ins->imm = operands[4];
+
+  p = memchr(p, '\n', text_end - p);
+  return p ? p + 1 : text_end;
 }
 
 /*
  * This function is related to parsing input file
  *
- * Note : You are not supposed to edit this function
+ * Maps the input file and parses it in a single pass, one instruction per
+ * line, into a code memory array that doubles as it fills.
  */
 APEX_Instruction*
 create_code_memory(const char* filename, int* size)
 {
+  *size = 0;
   if (!filename) {
     return NULL;
   }
 
-  FILE* fp = fopen(filename, "r");
-  if (!fp) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
     return NULL;
   }
 
-  char* line = NULL;
-  size_t len = 0;
-  ssize_t nread;
-  int code_memory_size = 0;
-
-  while ((nread = getline(&line, &len, fp)) != -1) {
-    code_memory_size++;
-  }
-  *size = code_memory_size;
-  if (!code_memory_size) {
-    fclose(fp);
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size == 0) {
+    close(fd);
     return NULL;
   }
 
-  APEX_Instruction* code_memory =
-    malloc(sizeof(*code_memory) * code_memory_size);
-  if (!code_memory) {
-    fclose(fp);
+  const char* text = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (text == MAP_FAILED) {
     return NULL;
   }
+  madvise((void*)text, st.st_size, MADV_SEQUENTIAL);
+
+  /* Start from an estimate of one instruction per 12 bytes of text */
+  int capacity = st.st_size / 12 + 16;
+  int code_memory_size = 0;
+  APEX_Instruction* code_memory = malloc(sizeof(*code_memory) * capacity);
+
+  const char* p = text;
+  const char* text_end = text + st.st_size;
+  while (code_memory && p < text_end) {
+    if (code_memory_size == capacity) {
+      capacity *= 2;
+      APEX_Instruction* grown = realloc(code_memory, sizeof(*code_memory) * capacity);
+      if (!grown) {
+        free(code_memory);
+        code_memory = NULL;
+        break;
+      }
+      code_memory = grown;
+    }
+
+    p = create_APEX_instruction(&code_memory[code_memory_size], p, text_end);
+    code_memory_size++;
+  }
 
-  rewind(fp);
-  int current_instruction = 0;
-  while ((nread = getline(&line, &len, fp)) != -1) {
-    create_APEX_instruction(&code_memory[current_instruction], line);
-    current_instruction++;
+  munmap((void*)text, st.st_size);
+  if (!code_memory) {
+    return NULL;
   }
 
-  free(line);
-  fclose(fp);
+  *size = code_memory_size;
   return code_memory;
 }
@@ -0,0 +1,306 @@
+/*
+ *  functional.c
+ *  Contains the functional (ISA-only) execution mode of APEX cpu
+ *
+ *  Instructions run one at a time, straight against the register file,
+ *  data memory and zero flag, with no pipeline latches and no timing.
+ *  It is used to fast-forward to a region of interest, after which
+ *  APEX_cpu_run continues cycle by cycle from the same architectural
+ *  state.
+ *
+ *  Author :
+ *  Akshay Shinde (ashinde3@binghamton.edu)
+ *  State University of New York, Binghamton
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+/* One threaded-code entry per instruction: the address of its handler in
+ * APEX_cpu_run_functional plus its operands
+ */
+struct APEX_Threaded_Op
+{
+  const void* handler;
+  int arg;          // Literal, or the target index of a branch
+  uint8_t rd;
+  uint8_t rs1;
+  uint8_t rs2;
+  uint8_t rs3;
+};
+
+void
+free_threaded_code(APEX_Threaded_Op* code)
+{
+  free(code);
+}
+
+/*
+ * Runs instructions functionally from cpu->pc until the pc reaches
+ * stop_pc, max_instructions have run, HALT executes or the pc leaves code
+ * memory. A negative stop_pc or max_instructions disables that limit.
+ *
+ * Code memory is translated once into threaded code, dispatched with
+ * computed goto. Every handler ends by jumping straight to the handler of
+ * the next instruction. A jump or branch to a pc that is not a
+ * word-aligned code address ends the run there.
+ *
+ * Only cpu->regs, data_memory, zeroFlag and pc are updated, the pipeline
+ * is left alone. *done_out is set once the program has completed, after
+ * HALT or past the end of code memory. Returns the number of instructions
+ * executed.
+ */
+long
+APEX_cpu_run_functional(APEX_CPU* cpu, int stop_pc, long max_instructions, int* done_out)
+{
+  static const void* const handlers[NUM_OPCODES] = {
+    [OPCODE_NONE]    = &&op_nop,
+    [OPCODE_INVALID] = &&op_nop,
+    [OPCODE_MOVC]    = &&op_movc,
+    [OPCODE_STORE]   = &&op_store,
+    [OPCODE_STR]     = &&op_str,
+    [OPCODE_ADD]     = &&op_add,
+    [OPCODE_ADDL]    = &&op_addl,
+    [OPCODE_SUB]     = &&op_sub,
+    [OPCODE_SUBL]    = &&op_subl,
+    [OPCODE_MUL]     = &&op_mul,
+    [OPCODE_AND]     = &&op_and,
+    [OPCODE_OR]      = &&op_or,
+    [OPCODE_EXOR]    = &&op_exor,
+    [OPCODE_LOAD]    = &&op_load,
+    [OPCODE_LDR]     = &&op_ldr,
+    [OPCODE_BZ]      = &&op_bz,
+    [OPCODE_BNZ]     = &&op_bnz,
+    [OPCODE_JUMP]    = &&op_jump,
+    [OPCODE_HALT]    = &&op_halt,
+  };
+
+  int size = cpu->code_memory_size;
+
+  /* Translate on first use, with one extra entry that ends the program */
+  if (!cpu->threaded_code) {
+    APEX_Threaded_Op* code = malloc((size + 1) * sizeof(*code));
+    if (!code) {
+      *done_out = 0;
+      return 0;
+    }
+    for (int i = 0; i < size; ++i) {
+      const APEX_Instruction* ins = &cpu->code_memory[i];
+      code[i].handler = handlers[ins->opcode];
+      code[i].arg = ins->imm;
+      code[i].rd = ins->rd;
+      code[i].rs1 = ins->rs1;
+      code[i].rs2 = ins->rs2;
+      code[i].rs3 = ins->rs3;
+
+      /* Branches carry their target index, or leave if it is not one */
+      if (ins->opcode == OPCODE_BZ || ins->opcode == OPCODE_BNZ) {
+        int target = i + ins->imm / 4;
+        if (ins->imm % 4 != 0 || target < 0 || target >= size) {
+          code[i].handler = (ins->opcode == OPCODE_BZ) ? &&op_bz_leave : &&op_bnz_leave;
+        }
+        else {
+          code[i].arg = target;
+        }
+      }
+    }
+    code[size].handler = &&op_end;
+    cpu->threaded_code = code;
+  }
+
+  APEX_Threaded_Op* code = cpu->threaded_code;
+  int* regs = cpu->regs;
+  int* mem = cpu->data_memory;
+  int zero = cpu->zeroFlag;
+  int pc = cpu->pc;
+  int done = 0;
+  long budget = (max_instructions < 0) ? -1 : max_instructions;
+  long remaining = budget;
+  const APEX_Threaded_Op* op;
+  int index;
+
+  /* A stop pc inside code memory patches its entry for the run */
+  int stop_index = -1;
+  const void* stop_handler = NULL;
+  if (stop_pc >= 4000 && (stop_pc - 4000) % 4 == 0 && get_code_index(stop_pc) < size) {
+    stop_index = get_code_index(stop_pc);
+    stop_handler = code[stop_index].handler;
+    code[stop_index].handler = &&op_stop;
+  }
+
+  if (pc < 4000 || (pc - 4000) % 4 != 0 || get_code_index(pc) >= size) {
+    goto leave_at_pc;
+  }
+  index = get_code_index(pc);
+
+#define DISPATCH()                      \
+  do {                                  \
+    if (remaining-- == 0) {             \
+      goto out_of_budget;               \
+    }                                   \
+    op = &code[index];                  \
+    goto *op->handler;                  \
+  } while (0)
+
+#define NEXT()                          \
+  do {                                  \
+    index++;                            \
+    DISPATCH();                         \
+  } while (0)
+
+  DISPATCH();
+
+op_nop:
+  NEXT();
+op_movc:
+  regs[op->rd] = op->arg;
+  NEXT();
+op_add:
+  regs[op->rd] = APEX_ADD(regs[op->rs1], regs[op->rs2]);
+  zero = (regs[op->rd] == 0);
+  NEXT();
+op_addl:
+  regs[op->rd] = APEX_ADD(regs[op->rs1], op->arg);
+  zero = (regs[op->rd] == 0);
+  NEXT();
+op_sub:
+  regs[op->rd] = APEX_SUB(regs[op->rs1], regs[op->rs2]);
+  zero = (regs[op->rd] == 0);
+  NEXT();
+op_subl:
+  regs[op->rd] = APEX_SUB(regs[op->rs1], op->arg);
+  zero = (regs[op->rd] == 0);
+  NEXT();
+op_mul:
+  regs[op->rd] = APEX_MUL(regs[op->rs1], regs[op->rs2]);
+  zero = (regs[op->rd] == 0);
+  NEXT();
+op_and:
+  regs[op->rd] = regs[op->rs1] & regs[op->rs2];
+  NEXT();
+op_or:
+  regs[op->rd] = regs[op->rs1] | regs[op->rs2];
+  NEXT();
+op_exor:
+  regs[op->rd] = regs[op->rs1] ^ regs[op->rs2];
+  NEXT();
+op_load:
+  regs[op->rd] = mem[APEX_ADD(regs[op->rs1], op->arg)];
+  NEXT();
+op_ldr:
+  regs[op->rd] = mem[APEX_ADD(regs[op->rs1], regs[op->rs2])];
+  NEXT();
+op_store:
+  mem[APEX_ADD(regs[op->rs2], op->arg)] = regs[op->rs1];
+  NEXT();
+op_str:
+  mem[APEX_ADD(regs[op->rs2], regs[op->rs3])] = regs[op->rs1];
+  NEXT();
+op_bz:
+  /* A taken BZ consumes the flag, as in EX1 */
+  if (zero) {
+    zero = 0;
+    index = op->arg;
+    DISPATCH();
+  }
+  NEXT();
+op_bnz:
+  if (!zero) {
+    index = op->arg;
+    DISPATCH();
+  }
+  NEXT();
+op_bz_leave:
+  if (zero) {
+    zero = 0;
+    pc = 4000 + index * 4 + op->arg;
+    goto leave_at_pc;
+  }
+  NEXT();
+op_bnz_leave:
+  if (!zero) {
+    pc = 4000 + index * 4 + op->arg;
+    goto leave_at_pc;
+  }
+  NEXT();
+op_jump:
+  pc = APEX_ADD(regs[op->rs1], op->arg);
+  if (pc >= 4000 && (pc - 4000) % 4 == 0 && get_code_index(pc) < size) {
+    index = get_code_index(pc);
+    DISPATCH();
+  }
+  goto leave_at_pc;
+op_halt:
+  done = 1;
+  pc = 4000 + index * 4;
+  goto leave;
+op_stop:
+  /* Reached stop_pc, this instruction has not run */
+  remaining++;
+  pc = 4000 + index * 4;
+  goto leave;
+op_end:
+  /* Ran off the end of code memory */
+  remaining++;
+  done = 1;
+  pc = 4000 + index * 4;
+  goto leave;
+out_of_budget:
+  remaining = 0;
+  pc = 4000 + index * 4;
+  goto leave;
+leave_at_pc:
+  /* At a pc that is not an entry: outside code memory the program has
+   * completed, a misaligned pc inside it is left to the pipeline
+   */
+  done = (pc < 4000 || pc >= 4000 + size * 4);
+
+#undef NEXT
+#undef DISPATCH
+
+leave:
+  if (stop_index >= 0) {
+    code[stop_index].handler = stop_handler;
+  }
+  cpu->zeroFlag = zero;
+  cpu->pc = pc;
+  *done_out = done;
+  return (budget < 0) ? (-1 - remaining) : (budget - remaining);
+}
+
+/*
+ * Leaves the pipeline empty and ready to fetch from cpu->pc, with every
+ * register valid, after a functional run. Once done, the program has
+ * completed and APEX_cpu_run only prints the final state.
+ */
+void
+APEX_cpu_hand_over(APEX_CPU* cpu, int done)
+{
+  cpu->regs_pending = 0;
+  cpu->zero_producer = -1;
+  memset(cpu->stage, 0, sizeof(cpu->stage));
+  for (int i = 1; i < APEX_MAX_STAGES; ++i) {
+    cpu->stage[i].busy = 1;
+  }
+  cpu->ex_halt = 0;
+
+  /* The run loop ends once ins_completed reaches code_memory_size, which
+   * tracks the position in the program, as taken branches rewind it
+   */
+  cpu->ins_completed = done ? cpu->code_memory_size : get_code_index(cpu->pc);
+}
+
+/*
+ * Fast-forwards functionally as APEX_cpu_run_functional does, then hands
+ * over to the pipeline. Returns the number of instructions executed.
+ */
+long
+APEX_cpu_fast_forward(APEX_CPU* cpu, int stop_pc, long max_instructions)
+{
+  int done;
+  long count = APEX_cpu_run_functional(cpu, stop_pc, max_instructions, &done);
+  APEX_cpu_hand_over(cpu, done);
+  return count;
+}
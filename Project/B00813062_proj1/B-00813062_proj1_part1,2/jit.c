@@ -0,0 +1,612 @@
+/*
+ *  jit.c
+ *  Contains the JIT tier of the functional (ISA-only) execution mode
+ *
+ *  Basic blocks, which end at BZ, BNZ, JUMP or HALT, start out running
+ *  on the threaded engine. A block entered JIT_HOT_THRESHOLD times is
+ *  translated to x86-64 in an executable code cache. Translated blocks
+ *  jump straight to each other, a block exit whose target is not yet
+ *  translated returns to the driver and is patched into a direct jump
+ *  once the target is translated.
+ *
+ *  Native code works on cpu->regs and data_memory in place and keeps the
+ *  zero flag in the run context, so the architectural state is exact at
+ *  every block boundary and the pipeline can take over at any of them.
+ *
+ *  Registers while in native code:
+ *    rbx  cpu->regs          r12  cpu->data_memory
+ *    r13  APEX_Jit_Context   r14  instructions left in the budget
+ *    r15d index of the stop pc, -1 if none
+ *
+ *  Author :
+ *  Akshay Shinde (ashinde3@binghamton.edu)
+ *  State University of New York, Binghamton
+ */
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "cpu.h"
+
+#define JIT_HOT_THRESHOLD 8
+#define JIT_MAX_BLOCK 256          // Longer blocks are split, falling through
+#define JIT_MAX_INSN_BYTES 64      // Upper bound of the code for one instruction
+#define JIT_BLOCK_OVERHEAD 64      // Entry checks and the entry exit
+#define JIT_CACHE_SIZE (16 << 20)
+
+/* Native code returns the index to continue from, or one of these */
+enum
+{
+  JIT_EXIT_HALT = -1,  // HALT at context.index ran
+  JIT_EXIT_PC = -2     // Continue from context.pc, it may not be an entry
+};
+
+/* Run state shared with native code, which addresses it through r13 */
+typedef struct APEX_Jit_Context
+{
+  int* regs;
+  int* mem;
+  long remaining;
+  int stop_index;
+  int zero;
+  int pc;
+  int index;
+} APEX_Jit_Context;
+
+#if defined(__x86_64__)
+
+_Static_assert(offsetof(APEX_Jit_Context, index) < 128, "context fields need disp8");
+
+typedef int (*APEX_Jit_Enter)(APEX_Jit_Context* ctx, const uint8_t* entry);
+
+/* An exit stub waiting for its target block to be translated */
+typedef struct APEX_Jit_Patch
+{
+  uint8_t* site;
+  int next;
+} APEX_Jit_Patch;
+
+struct APEX_Jit
+{
+  uint8_t* cache;
+  uint8_t* cache_ptr;
+  uint8_t* exit_common;   // Saves r14, restores the host registers, returns
+  APEX_Jit_Enter enter;
+
+  int size;
+  uint8_t** entry;        // Native entry of the block at each index, or NULL
+  uint8_t* heat;          // Times each block was entered before translation
+  int* pending;           // First patch waiting on each index, or -1
+  APEX_Jit_Patch* patches;
+  int num_patches;
+  int max_patches;
+};
+
+/* Machine code emission */
+
+static void
+emit_bytes(APEX_Jit* jit, const uint8_t* bytes, int len)
+{
+  memcpy(jit->cache_ptr, bytes, len);
+  jit->cache_ptr += len;
+}
+
+#define EMIT(...)                                        \
+  do {                                                   \
+    const uint8_t bytes_[] = { __VA_ARGS__ };            \
+    emit_bytes(jit, bytes_, sizeof(bytes_));             \
+  } while (0)
+
+static void
+emit_u32(APEX_Jit* jit, uint32_t value)
+{
+  memcpy(jit->cache_ptr, &value, 4);
+  jit->cache_ptr += 4;
+}
+
+static void
+patch_rel32(uint8_t* site, const uint8_t* target)
+{
+  int32_t rel = (int32_t)(target - (site + 4));
+  memcpy(site, &rel, 4);
+}
+
+#define CTX(field) ((uint8_t)offsetof(APEX_Jit_Context, field))
+#define REG(r) ((uint32_t)(r) * 4)
+
+/* op eax, [rbx + regs[r]], for opcodes 8B (mov), 03 (add), 2B (sub),
+ * 23 (and), 0B (or) and 33 (xor)
+ */
+static void
+emit_eax_reg(APEX_Jit* jit, uint8_t opcode, int r)
+{
+  EMIT(opcode, 0x83);
+  emit_u32(jit, REG(r));
+}
+
+static void
+emit_store_eax(APEX_Jit* jit, int rd)
+{
+  EMIT(0x89, 0x83);  // mov [rbx + rd], eax
+  emit_u32(jit, REG(rd));
+}
+
+/* zero = (eax == 0) */
+static void
+emit_set_zero(APEX_Jit* jit)
+{
+  EMIT(0x31, 0xC9,                    // xor ecx, ecx
+       0x85, 0xC0,                    // test eax, eax
+       0x0F, 0x94, 0xC1,              // sete cl
+       0x41, 0x89, 0x4D, CTX(zero));  // mov [r13 + zero], ecx
+}
+
+/* eax = address in eax as a data memory index, sign extended to rax */
+static void
+emit_index_rax(APEX_Jit* jit)
+{
+  EMIT(0x48, 0x63, 0xC0);  // movsxd rax, eax
+}
+
+/* Returns to the driver with eax = code, patchable into a direct jump */
+static uint8_t*
+emit_exit(APEX_Jit* jit, int code)
+{
+  uint8_t* site = jit->cache_ptr;
+  EMIT(0xB8);  // mov eax, code
+  emit_u32(jit, code);
+  EMIT(0xE9);  // jmp exit_common
+  emit_u32(jit, 0);
+  patch_rel32(jit->cache_ptr - 4, jit->exit_common);
+  return site;
+}
+
+static void
+patch_jump(uint8_t* site, const uint8_t* target)
+{
+  site[0] = 0xE9;  // jmp target
+  patch_rel32(site + 1, target);
+}
+
+/* Leaves the block for the instruction at index, chained when possible */
+static void
+emit_exit_to(APEX_Jit* jit, int index)
+{
+  if (index < jit->size && jit->entry[index]) {
+    EMIT(0xE9);
+    emit_u32(jit, 0);
+    patch_rel32(jit->cache_ptr - 4, jit->entry[index]);
+    return;
+  }
+
+  uint8_t* site = emit_exit(jit, index);
+  if (index >= jit->size) {
+    return;
+  }
+
+  if (jit->num_patches == jit->max_patches) {
+    int max = jit->max_patches ? jit->max_patches * 2 : 256;
+    APEX_Jit_Patch* patches = realloc(jit->patches, max * sizeof(*patches));
+    if (!patches) {
+      return;  // Stays an exit to the driver
+    }
+    jit->patches = patches;
+    jit->max_patches = max;
+  }
+  APEX_Jit_Patch* patch = &jit->patches[jit->num_patches];
+  patch->site = site;
+  patch->next = jit->pending[index];
+  jit->pending[index] = jit->num_patches++;
+}
+
+/* Leaves the block for pc, which need not be an entry */
+static void
+emit_exit_pc(APEX_Jit* jit, int pc)
+{
+  EMIT(0x41, 0xC7, 0x45, CTX(pc));  // mov dword [r13 + pc], pc
+  emit_u32(jit, pc);
+  emit_exit(jit, JIT_EXIT_PC);
+}
+
+/*
+ * Emits the host side glue at the start of the cache: the entry
+ * trampoline, called as enter(ctx, entry), and the common exit
+ */
+static void
+emit_trampoline(APEX_Jit* jit)
+{
+  jit->enter = (APEX_Jit_Enter)jit->cache_ptr;
+  EMIT(0x53,                            // push rbx
+       0x55,                            // push rbp
+       0x41, 0x54,                      // push r12
+       0x41, 0x55,                      // push r13
+       0x41, 0x56,                      // push r14
+       0x41, 0x57,                      // push r15
+       0x49, 0x89, 0xFD,                // mov r13, rdi
+       0x49, 0x8B, 0x5D, CTX(regs),     // mov rbx, [r13 + regs]
+       0x4D, 0x8B, 0x65, CTX(mem),      // mov r12, [r13 + mem]
+       0x4D, 0x8B, 0x75, CTX(remaining),  // mov r14, [r13 + remaining]
+       0x45, 0x8B, 0x7D, CTX(stop_index), // mov r15d, [r13 + stop_index]
+       0xFF, 0xE6);                     // jmp rsi
+
+  jit->exit_common = jit->cache_ptr;
+  EMIT(0x4D, 0x89, 0x75, CTX(remaining),  // mov [r13 + remaining], r14
+       0x41, 0x5F,                      // pop r15
+       0x41, 0x5E,                      // pop r14
+       0x41, 0x5D,                      // pop r13
+       0x41, 0x5C,                      // pop r12
+       0x5D,                            // pop rbp
+       0x5B,                            // pop rbx
+       0xC3);                           // ret
+}
+
+/* Drops every translation, used when the cache fills up */
+static void
+flush_cache(APEX_Jit* jit)
+{
+  jit->cache_ptr = jit->cache;
+  emit_trampoline(jit);
+  memset(jit->entry, 0, jit->size * sizeof(*jit->entry));
+  memset(jit->pending, 0xff, jit->size * sizeof(*jit->pending));
+  jit->num_patches = 0;
+}
+
+static int
+is_block_end(int opcode)
+{
+  return opcode == OPCODE_BZ || opcode == OPCODE_BNZ || opcode == OPCODE_JUMP ||
+         opcode == OPCODE_HALT;
+}
+
+/* Number of instructions in the block starting at index */
+static int
+block_length(const APEX_CPU* cpu, int index)
+{
+  int len = 0;
+  while (index + len < cpu->code_memory_size && len < JIT_MAX_BLOCK) {
+    if (is_block_end(cpu->code_memory[index + len++].opcode)) {
+      break;
+    }
+  }
+  return len;
+}
+
+/* Emits one instruction, which is not the end of its block */
+static void
+emit_instruction(APEX_Jit* jit, const APEX_Instruction* ins)
+{
+  switch (ins->opcode) {
+    case OPCODE_MOVC:
+      EMIT(0xC7, 0x83);  // mov dword [rbx + rd], imm
+      emit_u32(jit, REG(ins->rd));
+      emit_u32(jit, ins->imm);
+      break;
+
+    case OPCODE_ADD:
+    case OPCODE_SUB:
+    case OPCODE_MUL:
+      emit_eax_reg(jit, 0x8B, ins->rs1);
+      if (ins->opcode == OPCODE_MUL) {
+        EMIT(0x0F, 0xAF, 0x83);  // imul eax, [rbx + rs2]
+        emit_u32(jit, REG(ins->rs2));
+      }
+      else {
+        emit_eax_reg(jit, ins->opcode == OPCODE_ADD ? 0x03 : 0x2B, ins->rs2);
+      }
+      emit_store_eax(jit, ins->rd);
+      emit_set_zero(jit);
+      break;
+
+    case OPCODE_ADDL:
+    case OPCODE_SUBL:
+      emit_eax_reg(jit, 0x8B, ins->rs1);
+      EMIT(ins->opcode == OPCODE_ADDL ? 0x05 : 0x2D);  // add/sub eax, imm
+      emit_u32(jit, ins->imm);
+      emit_store_eax(jit, ins->rd);
+      emit_set_zero(jit);
+      break;
+
+    case OPCODE_AND:
+    case OPCODE_OR:
+    case OPCODE_EXOR:
+      emit_eax_reg(jit, 0x8B, ins->rs1);
+      emit_eax_reg(jit,
+                   ins->opcode == OPCODE_AND ? 0x23 : ins->opcode == OPCODE_OR ? 0x0B : 0x33,
+                   ins->rs2);
+      emit_store_eax(jit, ins->rd);
+      break;
+
+    case OPCODE_LOAD:
+    case OPCODE_LDR:
+      emit_eax_reg(jit, 0x8B, ins->rs1);
+      if (ins->opcode == OPCODE_LOAD) {
+        EMIT(0x05);  // add eax, imm
+        emit_u32(jit, ins->imm);
+      }
+      else {
+        emit_eax_reg(jit, 0x03, ins->rs2);
+      }
+      emit_index_rax(jit);
+      EMIT(0x41, 0x8B, 0x04, 0x84);  // mov eax, [r12 + rax * 4]
+      emit_store_eax(jit, ins->rd);
+      break;
+
+    case OPCODE_STORE:
+    case OPCODE_STR:
+      emit_eax_reg(jit, 0x8B, ins->rs2);
+      if (ins->opcode == OPCODE_STORE) {
+        EMIT(0x05);  // add eax, imm
+        emit_u32(jit, ins->imm);
+      }
+      else {
+        emit_eax_reg(jit, 0x03, ins->rs3);
+      }
+      emit_index_rax(jit);
+      EMIT(0x8B, 0x8B);  // mov ecx, [rbx + rs1]
+      emit_u32(jit, REG(ins->rs1));
+      EMIT(0x41, 0x89, 0x0C, 0x84);  // mov [r12 + rax * 4], ecx
+      break;
+
+    default:
+      break;  // Bubbles and invalid instructions do nothing
+  }
+}
+
+/* Emits the taken side of the branch at index */
+static void
+emit_branch_target(APEX_Jit* jit, int index, int imm)
+{
+  int target = index + imm / 4;
+  if (imm % 4 != 0 || target < 0 || target >= jit->size) {
+    emit_exit_pc(jit, 4000 + index * 4 + imm);
+  }
+  else {
+    emit_exit_to(jit, target);
+  }
+}
+
+/* Emits the instruction that ends the block, at index */
+static void
+emit_block_end(APEX_Jit* jit, const APEX_Instruction* ins, int index)
+{
+  uint8_t* taken;
+
+  switch (ins->opcode) {
+    case OPCODE_BZ:
+    case OPCODE_BNZ:
+      EMIT(0x41, 0x83, 0x7D, CTX(zero), 0x00);       // cmp dword [r13 + zero], 0
+      EMIT(0x0F, ins->opcode == OPCODE_BZ ? 0x85 : 0x84);  // jne/je taken
+      emit_u32(jit, 0);
+      taken = jit->cache_ptr - 4;
+      emit_exit_to(jit, index + 1);
+      patch_rel32(taken, jit->cache_ptr);
+      if (ins->opcode == OPCODE_BZ) {
+        /* A taken BZ consumes the flag, as in EX1 */
+        EMIT(0x41, 0xC7, 0x45, CTX(zero));  // mov dword [r13 + zero], 0
+        emit_u32(jit, 0);
+      }
+      emit_branch_target(jit, index, ins->imm);
+      break;
+
+    case OPCODE_JUMP:
+      emit_eax_reg(jit, 0x8B, ins->rs1);
+      EMIT(0x05);  // add eax, imm
+      emit_u32(jit, ins->imm);
+      EMIT(0x41, 0x89, 0x45, CTX(pc));  // mov [r13 + pc], eax
+      emit_exit(jit, JIT_EXIT_PC);
+      break;
+
+    case OPCODE_HALT:
+      EMIT(0x41, 0xC7, 0x45, CTX(index));  // mov dword [r13 + index], index
+      emit_u32(jit, index);
+      emit_exit(jit, JIT_EXIT_HALT);
+      break;
+
+    default:
+      /* The block was split or ran into the end of code memory */
+      emit_instruction(jit, ins);
+      emit_exit_to(jit, index + 1);
+      break;
+  }
+}
+
+/*
+ * Translates the block starting at index. On entry it returns to the
+ * driver, without running anything, if the budget cannot cover the whole
+ * block or the stop pc lies inside it.
+ */
+static uint8_t*
+translate_block(APEX_Jit* jit, const APEX_CPU* cpu, int index)
+{
+  int len = block_length(cpu, index);
+  size_t needed = (size_t)len * JIT_MAX_INSN_BYTES + JIT_BLOCK_OVERHEAD;
+  if (jit->cache_ptr + needed > jit->cache + JIT_CACHE_SIZE) {
+    flush_cache(jit);
+  }
+
+  uint8_t* entry = jit->cache_ptr;
+  jit->entry[index] = entry;  // A block may branch back to itself
+
+  EMIT(0x49, 0x81, 0xFE);  // cmp r14, len
+  emit_u32(jit, len);
+  EMIT(0x0F, 0x82);        // jb bail
+  emit_u32(jit, 0);
+  uint8_t* bail_budget = jit->cache_ptr - 4;
+  EMIT(0x44, 0x89, 0xF8,   // mov eax, r15d
+       0x2D);              // sub eax, index
+  emit_u32(jit, index);
+  EMIT(0x3D);              // cmp eax, len
+  emit_u32(jit, len);
+  EMIT(0x0F, 0x82);        // jb bail
+  emit_u32(jit, 0);
+  uint8_t* bail_stop = jit->cache_ptr - 4;
+  EMIT(0x49, 0x81, 0xEE);  // sub r14, len
+  emit_u32(jit, len);
+
+  for (int i = index; i < index + len - 1; ++i) {
+    emit_instruction(jit, &cpu->code_memory[i]);
+  }
+  emit_block_end(jit, &cpu->code_memory[index + len - 1], index + len - 1);
+
+  patch_rel32(bail_budget, jit->cache_ptr);
+  patch_rel32(bail_stop, jit->cache_ptr);
+  emit_exit(jit, index);
+
+  /* Chain every exit that was waiting for this block */
+  for (int p = jit->pending[index]; p >= 0; p = jit->patches[p].next) {
+    patch_jump(jit->patches[p].site, entry);
+  }
+  jit->pending[index] = -1;
+  return entry;
+}
+
+static APEX_Jit*
+create_jit(int size)
+{
+  APEX_Jit* jit = calloc(1, sizeof(*jit));
+  if (!jit) {
+    return NULL;
+  }
+  jit->size = size;
+  jit->entry = calloc(size, sizeof(*jit->entry));
+  jit->heat = calloc(size, sizeof(*jit->heat));
+  jit->pending = malloc(size * sizeof(*jit->pending));
+  jit->cache = mmap(NULL, JIT_CACHE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (jit->cache == MAP_FAILED) {
+    jit->cache = NULL;
+  }
+  if (!jit->entry || !jit->heat || !jit->pending || !jit->cache) {
+    free_jit(jit);
+    return NULL;
+  }
+  flush_cache(jit);
+  return jit;
+}
+
+void
+free_jit(APEX_Jit* jit)
+{
+  if (!jit) {
+    return;
+  }
+  if (jit->cache) {
+    munmap(jit->cache, JIT_CACHE_SIZE);
+  }
+  free(jit->entry);
+  free(jit->heat);
+  free(jit->pending);
+  free(jit->patches);
+  free(jit);
+}
+
+/*
+ * Fast-forwards as APEX_cpu_fast_forward does, with the same results,
+ * running hot blocks as native code. Falls back to the threaded engine
+ * where native code cannot run, or when the cache cannot be created.
+ * Returns the number of instructions executed.
+ */
+long
+APEX_cpu_fast_forward_jit(APEX_CPU* cpu, int stop_pc, long max_instructions)
+{
+  int size = cpu->code_memory_size;
+  if (!cpu->jit) {
+    cpu->jit = create_jit(size);
+    if (!cpu->jit) {
+      return APEX_cpu_fast_forward(cpu, stop_pc, max_instructions);
+    }
+  }
+
+  APEX_Jit* jit = cpu->jit;
+  APEX_Jit_Context ctx;
+  ctx.regs = cpu->regs;
+  ctx.mem = cpu->data_memory;
+  ctx.zero = cpu->zeroFlag;
+  ctx.stop_index = -1;
+  if (stop_pc >= 4000 && (stop_pc - 4000) % 4 == 0 && get_code_index(stop_pc) < size) {
+    ctx.stop_index = get_code_index(stop_pc);
+  }
+
+  long budget = (max_instructions < 0) ? LONG_MAX : max_instructions;
+  long remaining = budget;
+  int pc = cpu->pc;
+  int done = 0;
+
+  while (pc != stop_pc && remaining > 0) {
+    /* Outside code memory the program has completed, a misaligned pc
+     * inside it is left to the pipeline
+     */
+    if (pc < 4000 || pc >= 4000 + size * 4) {
+      done = 1;
+      break;
+    }
+    if ((pc - 4000) % 4 != 0) {
+      break;
+    }
+
+    int index = get_code_index(pc);
+    uint8_t* entry = jit->entry[index];
+    if (!entry && jit->heat[index] < JIT_HOT_THRESHOLD) {
+      jit->heat[index]++;
+    }
+    else if (!entry) {
+      entry = translate_block(jit, cpu, index);
+    }
+
+    if (entry) {
+      ctx.remaining = remaining;
+      int next = jit->enter(&ctx, entry);
+      long ran = remaining - ctx.remaining;
+      remaining = ctx.remaining;
+
+      if (next == JIT_EXIT_HALT) {
+        pc = 4000 + ctx.index * 4;
+        done = 1;
+        break;
+      }
+      pc = (next == JIT_EXIT_PC) ? ctx.pc : 4000 + next * 4;
+      if (ran > 0 || next != index) {
+        continue;
+      }
+      /* The block bailed out on entry, run it on the threaded engine */
+    }
+
+    /* One block on the threaded engine, which stops at its end */
+    int len = block_length(cpu, index);
+    cpu->pc = pc;
+    cpu->zeroFlag = ctx.zero;
+    remaining -= APEX_cpu_run_functional(cpu, stop_pc, remaining < len ? remaining : len, &done);
+    pc = cpu->pc;
+    ctx.zero = cpu->zeroFlag;
+    if (done) {
+      break;
+    }
+  }
+
+  cpu->pc = pc;
+  cpu->zeroFlag = ctx.zero;
+  APEX_cpu_hand_over(cpu, done);
+  return budget - remaining;
+}
+
+#else
+
+void
+free_jit(APEX_Jit* jit)
+{
+  (void)jit;
+}
+
+/* Native code is only generated for x86-64, elsewhere the threaded
+ * engine runs everything
+ */
+long
+APEX_cpu_fast_forward_jit(APEX_CPU* cpu, int stop_pc, long max_instructions)
+{
+  return APEX_cpu_fast_forward(cpu, stop_pc, max_instructions);
+}
+
+#endif
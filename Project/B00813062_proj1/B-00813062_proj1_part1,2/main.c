@@ -7,24 +7,317 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "cpu.h"
 
+static const char* trace_level_names[NUM_TRACE_LEVELS] = {
+  [TRACE_OFF]    = "off",
+  [TRACE_COMMIT] = "commit",
+  [TRACE_STAGE]  = "stage",
+  [TRACE_FULL]   = "full",
+};
+
+static int
+parse_trace_level(const char* name)
+{
+  for (int i = 0; i < NUM_TRACE_LEVELS; ++i) {
+    if (strcmp(name, trace_level_names[i]) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void
+usage(const char* prog)
+{
+  fprintf(stderr,
+          "APEX_Help : Usage %s <input_file> [off|commit|stage|full] [trace_file]\n"
+          "                  [--ff-pc=<pc>] [--ff-count=<n>] [--jit]\n"
+          "                  [--checkpoint=<file.apexc>] [--checkpoint-at=<cycle>]\n"
+          "                  [--config=<spec>] [--config-file=<file>]\n"
+          "                  [--what-if=<spec> ...]\n"
+          "                  [--what-if-at=<cycle>] [--what-if-pc=<pc>]\n"
+          "  --ff-pc, --ff-count : run functionally until the pc or instruction\n"
+          "                        count is reached, then switch to the pipeline\n"
+          "  --jit               : fast-forward hot blocks as native code\n"
+          "  --checkpoint        : save the complete state at the given cycle, or\n"
+          "                        once fast-forwarded, and run on. Pass the\n"
+          "                        .apexc file as input_file to resume from it\n"
+          "  --config            : pipeline parameters as key=value,... e.g.\n"
+          "                        ex_stages=3,mem_stages=1,latency.MUL=4,forwarding=1,\n"
+          "                        predictor=gshare\n"
+          "  --config-file       : pipeline parameters from a file, one\n"
+          "                        key=value per line\n"
+          "  --what-if           : at the given cycle or pc, branch off a run with\n"
+          "                        these parameters and report its cycles. Runs\n"
+          "                        share the state up to there and go in parallel.\n"
+          "                        Past the first cycle, runs cannot change\n"
+          "                        ex_stages, mem_stages or predictor\n",
+          prog);
+  exit(1);
+}
+
+/*
+ * Runs cpu to the branch point, then every spec from there in parallel,
+ * and reports the cycles and IPC each one takes to finish. cpu carries on
+ * from the branch point with its own parameters afterwards.
+ */
+static void
+run_what_ifs(APEX_CPU* cpu, const char** specs, int count, int stop_clock, int stop_pc)
+{
+  APEX_Config* configs = malloc(count * sizeof(*configs));
+  APEX_What_If_Result* results = malloc(count * sizeof(*results));
+  if (!configs || !results) {
+    fprintf(stderr, "APEX_Error : Out of memory\n");
+    exit(1);
+  }
+  for (int i = 0; i < count; ++i) {
+    configs[i] = cpu->config;
+    if (APEX_config_parse(&configs[i], specs[i]) != 0) {
+      fprintf(stderr, "APEX_Error : Invalid configuration %s\n", specs[i]);
+      exit(1);
+    }
+  }
+
+  APEX_cpu_run_until(cpu, stop_clock, stop_pc);
+  if (APEX_cpu_what_if(cpu, configs, count, -1, results) != 0) {
+    fprintf(stderr, "APEX_Error : Not every what-if run reported\n");
+  }
+
+  fprintf(stderr, "APEX_CPU : What-if runs from cycle %d, pc(%d)\n", cpu->clock, cpu->pc);
+  for (int i = 0; i < count; ++i) {
+    if (results[i].completed < 0) {
+      fprintf(stderr, "APEX_CPU :   %-32s failed\n", specs[i]);
+      continue;
+    }
+    int cycles = results[i].clock - cpu->clock;
+    long committed = results[i].ins_committed - cpu->ins_committed;
+    fprintf(stderr, "APEX_CPU :   %-32s %d cycles, %ld instructions, IPC %.3f\n", specs[i],
+            cycles, committed, cycles > 0 ? (double)committed / cycles : 0.0);
+  }
+
+  free(configs);
+  free(results);
+}
+
+/*
+ * Runs cpu from its current state to completion with forwarding off, in a
+ * forked child that leaves cpu as it was, and returns the clock it ends
+ * at, or -1 if that run failed
+ */
+static int
+run_without_forwarding(APEX_CPU* cpu)
+{
+  APEX_Config config = cpu->config;
+  APEX_What_If_Result result;
+  config.forwarding = 0;
+  if (APEX_cpu_what_if(cpu, &config, 1, -1, &result) != 0 || result.completed != 1) {
+    return -1;
+  }
+  return result.clock;
+}
+
+/* Operands bypassed into DRF by each stage, and the cycles the run saved
+ * against one without forwarding that ended at unforwarded_clock
+ */
+static void
+print_forwarding_stats(APEX_CPU* cpu, int unforwarded_clock)
+{
+  long total = 0;
+  fprintf(stderr, "APEX_CPU : Forwarded");
+  for (int i = EX1; i < APEX_MAX_STAGES; ++i) {
+    if (cpu->forwarded[i]) {
+      char label[16];
+      stage_label(label, &cpu->config, i);
+      fprintf(stderr, " %s %ld,", label, cpu->forwarded[i]);
+      total += cpu->forwarded[i];
+    }
+  }
+  fprintf(stderr, " %ld operands in all", total);
+  if (unforwarded_clock >= 0) {
+    fprintf(stderr, ", saving %d cycles against forwarding=0", unforwarded_clock - cpu->clock);
+  }
+  fprintf(stderr, "\n");
+}
+
+static void
+print_branch(const char* label, const APEX_Branch_Stats* stats)
+{
+  fprintf(stderr,
+          "APEX_CPU : %s resolved %ld, taken %ld, mispredicted %ld, %.1f%% accurate, "
+          "penalty %ld cycles\n",
+          label, stats->resolved, stats->taken, stats->mispredicted,
+          stats->resolved ? 100.0 * (stats->resolved - stats->mispredicted) / stats->resolved
+                          : 0.0,
+          stats->penalty_cycles);
+}
+
+/* How the predictor did on each branch, and on all of them */
+static void
+print_branch_stats(APEX_CPU* cpu)
+{
+  const APEX_Predictor* predictor = &cpu->predictor;
+  for (int i = 0; i < predictor->num_branches; ++i) {
+    char label[32];
+    sprintf(label, "Branch pc(%d)", predictor->branches[i].pc);
+    print_branch(label, &predictor->branches[i]);
+  }
+  print_branch("Branches", &predictor->total);
+}
+
 int
 main(int argc, char const* argv[])
 {
-  if (argc != 2) {
-    fprintf(stderr, "APEX_Help : Usage %s <input_file>\n", argv[0]);
-    exit(1);
+  int trace_level = TRACE_FULL;
+  const char* trace_file = NULL;
+  int ff_pc = -1;
+  long ff_count = -1;
+  int jit = 0;
+  const char* checkpoint_file = NULL;
+  int checkpoint_at = -1;
+  APEX_Config config;
+  int have_config = 0;
+  const char** what_if_specs = calloc(argc, sizeof(*what_if_specs));
+  int what_ifs = 0;
+  int what_if_at = -1;
+  int what_if_pc = -1;
+  int positional = 0;
+
+  APEX_config_default(&config);
+
+  if (argc < 2) {
+    usage(argv[0]);
+  }
+
+  for (int i = 2; i < argc; ++i) {
+    if (strncmp(argv[i], "--ff-pc=", 8) == 0) {
+      ff_pc = atoi(argv[i] + 8);
+    }
+    else if (strncmp(argv[i], "--ff-count=", 11) == 0) {
+      ff_count = atol(argv[i] + 11);
+    }
+    else if (strcmp(argv[i], "--jit") == 0) {
+      jit = 1;
+    }
+    else if (strncmp(argv[i], "--checkpoint=", 13) == 0) {
+      checkpoint_file = argv[i] + 13;
+    }
+    else if (strncmp(argv[i], "--checkpoint-at=", 16) == 0) {
+      checkpoint_at = atoi(argv[i] + 16);
+    }
+    else if (strncmp(argv[i], "--config=", 9) == 0) {
+      if (APEX_config_parse(&config, argv[i] + 9) != 0) {
+        usage(argv[0]);
+      }
+      have_config = 1;
+    }
+    else if (strncmp(argv[i], "--config-file=", 14) == 0) {
+      int line = APEX_config_load(&config, argv[i] + 14);
+      if (line < 0) {
+        fprintf(stderr, "APEX_Error : Unable to open %s\n", argv[i] + 14);
+        exit(1);
+      }
+      if (line > 0) {
+        fprintf(stderr, "APEX_Error : %s:%d : Invalid configuration\n", argv[i] + 14, line);
+        exit(1);
+      }
+      have_config = 1;
+    }
+    else if (strncmp(argv[i], "--what-if=", 10) == 0) {
+      what_if_specs[what_ifs++] = argv[i] + 10;
+    }
+    else if (strncmp(argv[i], "--what-if-at=", 13) == 0) {
+      what_if_at = atoi(argv[i] + 13);
+    }
+    else if (strncmp(argv[i], "--what-if-pc=", 13) == 0) {
+      what_if_pc = atoi(argv[i] + 13);
+    }
+    else if (positional == 0) {
+      trace_level = parse_trace_level(argv[i]);
+      if (trace_level < 0) {
+        usage(argv[0]);
+      }
+      positional++;
+    }
+    else if (positional == 1) {
+      trace_file = argv[i];
+      positional++;
+    }
+    else {
+      usage(argv[0]);
+    }
   }
 
-  APEX_CPU* cpu = APEX_cpu_init(argv[1]);
+  APEX_CPU* cpu = APEX_cpu_init(argv[1], trace_level);
   if (!cpu) {
     fprintf(stderr, "APEX_Error : Unable to initialize CPU\n");
     exit(1);
   }
 
+  /* A restored checkpoint keeps the parameters it was saved with, and
+   * its pipeline shape in any case
+   */
+  if (have_config && APEX_cpu_set_config(cpu, &config) != 0) {
+    fprintf(stderr, "APEX_Error : Unable to change the pipeline shape of a running cpu\n");
+    exit(1);
+  }
+
+  if (trace_file && APEX_cpu_set_trace_file(cpu, trace_file) != 0) {
+    fprintf(stderr, "APEX_Error : Unable to create trace file %s\n", trace_file);
+    exit(1);
+  }
+
+  struct timespec start, end;
+  if (ff_pc >= 0 || ff_count >= 0) {
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    long count = jit ? APEX_cpu_fast_forward_jit(cpu, ff_pc, ff_count)
+                     : APEX_cpu_fast_forward(cpu, ff_pc, ff_count);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr,
+            "APEX_CPU : Fast-forwarded %ld instructions to pc(%d) in %.3f s, %.0f instructions/sec\n",
+            count, cpu->pc, seconds, seconds > 0 ? count / seconds : 0.0);
+  }
+
+  /* The saving is measured from here, where the pipeline takes over */
+  int unforwarded_clock = -1;
+  if (cpu->config.forwarding) {
+    unforwarded_clock = run_without_forwarding(cpu);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if (checkpoint_file) {
+    if (checkpoint_at >= 0) {
+      APEX_cpu_run_until(cpu, checkpoint_at, -1);
+    }
+    if (APEX_cpu_save_checkpoint(cpu, checkpoint_file) != 0) {
+      fprintf(stderr, "APEX_Error : Unable to save checkpoint %s\n", checkpoint_file);
+      exit(1);
+    }
+    fprintf(stderr, "APEX_CPU : Saved checkpoint %s at cycle %d\n", checkpoint_file, cpu->clock);
+  }
+  if (what_ifs) {
+    run_what_ifs(cpu, what_if_specs, what_ifs, what_if_at, what_if_pc);
+  }
   APEX_cpu_run(cpu);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  fprintf(stderr, "APEX_CPU : Simulated %d cycles in %.3f s, %.0f cycles/sec\n",
+          cpu->clock, seconds, seconds > 0 ? cpu->clock / seconds : 0.0);
+
+  if (cpu->config.forwarding) {
+    print_forwarding_stats(cpu, unforwarded_clock);
+  }
+  if (cpu->config.predictor != PREDICTOR_NONE) {
+    print_branch_stats(cpu);
+  }
+
   APEX_cpu_stop(cpu);
+  free(what_if_specs);
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,271 @@
+/*
+ *  object_file.c
+ *  Contains functions to save predecoded code memory as a precompiled
+ *  APEX object (.apexo) and to map it back without parsing
+ *
+ *  An .apexo file is a header followed by the packed APEX_Instruction
+ *  records, in host byte order:
+ *
+ *    magic "APXO" | version | front end | record size | count | source hash
+ *
+ *  The source hash covers the .asm text the records were parsed from, so a
+ *  cached object is used only while its source is unchanged. The
+ *  out-of-order simulator writes the same layout under its own front end
+ *  tag to .ooo.apexo, so both can cache one source side by side. Bump
+ *  APEXO_VERSION whenever APEX_Instruction or the opcode numbering changes.
+ *
+ *  Author :
+ *  Akshay Shinde (ashinde3@binghamton.edu)
+ *  State University of New York, Binghamton
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cpu.h"
+
+#define APEXO_MAGIC "APXO"
+#define APEXO_VERSION 1
+#define APEXO_SUFFIX ".apexo"
+
+/* Front ends that produce .apexo records, their parsers differ */
+enum
+{
+  APEXO_FRONTEND_INORDER = 1,
+  APEXO_FRONTEND_OOO = 2
+};
+
+typedef struct APEX_Object_Header
+{
+  char magic[4];
+  uint16_t version;
+  uint16_t frontend;
+  uint32_t record_size;
+  uint32_t count;
+  uint64_t source_hash;
+} APEX_Object_Header;
+
+/*
+ * 64-bit FNV-1a style hash of the source text, folded in 8 bytes at a time
+ */
+static uint64_t
+hash_text(const char* text, size_t len)
+{
+  uint64_t hash = 0xcbf29ce484222325ULL ^ len;
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    uint64_t word;
+    memcpy(&word, text + i, sizeof(word));
+    hash = (hash ^ word) * 0x100000001b3ULL;
+    hash ^= hash >> 29;
+  }
+  for (; i < len; ++i) {
+    hash = (hash ^ (unsigned char)text[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static int
+hash_file(const char* filename, uint64_t* hash)
+{
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return 0;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size == 0) {
+    close(fd);
+    return 0;
+  }
+
+  const char* text = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (text == MAP_FAILED) {
+    return 0;
+  }
+
+  *hash = hash_text(text, st.st_size);
+  munmap((void*)text, st.st_size);
+  return 1;
+}
+
+static int
+has_suffix(const char* filename, const char* suffix)
+{
+  size_t len = strlen(filename);
+  size_t suffix_len = strlen(suffix);
+  return len >= suffix_len && strcmp(filename + len - suffix_len, suffix) == 0;
+}
+
+/* "prog.asm" caches to "prog.apexo", any other name gets the suffix added.
+ * The out-of-order simulator caches the same source to "prog.ooo.apexo".
+ */
+static char*
+object_path(const char* filename)
+{
+  size_t len = strlen(filename);
+  if (has_suffix(filename, ".asm")) {
+    len -= strlen(".asm");
+  }
+
+  char* path = malloc(len + sizeof(APEXO_SUFFIX));
+  if (path) {
+    memcpy(path, filename, len);
+    strcpy(path + len, APEXO_SUFFIX);
+  }
+  return path;
+}
+
+/*
+ * Maps an .apexo file and returns its records in place. With check_hash
+ * set, an object whose source hash differs from source_hash is rejected.
+ */
+static APEX_Instruction*
+map_object(const char* path, int check_hash, uint64_t source_hash, int* size,
+           size_t* mapped_size)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(APEX_Object_Header)) {
+    close(fd);
+    return NULL;
+  }
+
+  char* base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    return NULL;
+  }
+
+  const APEX_Object_Header* header = (const APEX_Object_Header*)base;
+  APEX_Instruction* records = (APEX_Instruction*)(base + sizeof(*header));
+  int valid = memcmp(header->magic, APEXO_MAGIC, 4) == 0 &&
+              header->version == APEXO_VERSION &&
+              header->frontend == APEXO_FRONTEND_INORDER &&
+              header->record_size == sizeof(APEX_Instruction) &&
+              header->count > 0 &&
+              sizeof(*header) + (size_t)header->count * sizeof(APEX_Instruction) ==
+                (size_t)st.st_size &&
+              (!check_hash || header->source_hash == source_hash);
+
+  /* Stages index their handler tables by opcode and the register file by
+   * operand, never trust a record blindly
+   */
+  for (uint32_t i = 0; valid && i < header->count; ++i) {
+    valid = valid_instruction(&records[i]);
+  }
+
+  if (!valid) {
+    munmap(base, st.st_size);
+    return NULL;
+  }
+
+  *size = header->count;
+  *mapped_size = st.st_size;
+  return records;
+}
+
+/*
+ * Saves code memory as an .apexo file. The object is written under a
+ * temporary name and renamed into place, so concurrent runs never map a
+ * partly written file. Failures are ignored, the cache is optional.
+ */
+static void
+write_object(const char* path, uint64_t source_hash, const APEX_Instruction* code_memory,
+             int size)
+{
+  APEX_Object_Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, APEXO_MAGIC, 4);
+  header.version = APEXO_VERSION;
+  header.frontend = APEXO_FRONTEND_INORDER;
+  header.record_size = sizeof(APEX_Instruction);
+  header.count = size;
+  header.source_hash = source_hash;
+
+  /* Unique per write, threads of one process may save the same object */
+  static int serial;
+  char* tmp_path = malloc(strlen(path) + 48);
+  if (!tmp_path) {
+    return;
+  }
+  sprintf(tmp_path, "%s.%ld.%d.tmp", path, (long)getpid(),
+          __atomic_fetch_add(&serial, 1, __ATOMIC_RELAXED));
+
+  FILE* fp = fopen(tmp_path, "wb");
+  if (!fp) {
+    free(tmp_path);
+    return;
+  }
+
+  int ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+           fwrite(code_memory, sizeof(*code_memory), size, fp) == (size_t)size;
+  ok = (fclose(fp) == 0) && ok;
+  if (!ok || rename(tmp_path, path) != 0) {
+    unlink(tmp_path);
+  }
+  free(tmp_path);
+}
+
+/*
+ * Loads code memory for filename. An .apexo file is mapped directly. For
+ * an .asm file the cached object next to it is mapped if its source hash
+ * still matches, otherwise the text is parsed and the object rewritten.
+ *
+ * *mapped_size is set to the mapping length for mapped code memory and to
+ * 0 for parsed code memory, release either with free_code_memory.
+ */
+APEX_Instruction*
+load_code_memory(const char* filename, int* size, size_t* mapped_size)
+{
+  *size = 0;
+  *mapped_size = 0;
+  if (!filename) {
+    return NULL;
+  }
+
+  if (has_suffix(filename, APEXO_SUFFIX)) {
+    return map_object(filename, 0, 0, size, mapped_size);
+  }
+
+  uint64_t source_hash;
+  if (!hash_file(filename, &source_hash)) {
+    return NULL;
+  }
+
+  char* path = object_path(filename);
+  if (!path) {
+    return NULL;
+  }
+
+  APEX_Instruction* code_memory = map_object(path, 1, source_hash, size, mapped_size);
+  if (!code_memory) {
+    code_memory = create_code_memory(filename, size);
+    if (code_memory) {
+      write_object(path, source_hash, code_memory, *size);
+    }
+  }
+
+  free(path);
+  return code_memory;
+}
+
+void
+free_code_memory(APEX_Instruction* code_memory, size_t mapped_size)
+{
+  if (mapped_size) {
+    munmap((char*)code_memory - sizeof(APEX_Object_Header), mapped_size);
+  }
+  else {
+    free(code_memory);
+  }
+}
@@ -0,0 +1,162 @@
+/*
+ *  predictor.c
+ *  Contains the branch predictors Fetch consults for BZ and BNZ
+ *
+ *  Fetch looks every BZ and BNZ up as it fetches it. The direction comes
+ *  from the predictor the config selects, the target from a direct-mapped
+ *  branch target buffer that only taken branches are entered into, so a
+ *  branch is followed only once it has been taken before. The predicted
+ *  direction is shifted into the global history right away. Wherever the
+ *  branch resolves, EX1 with early_redirect and the last memory stage
+ *  otherwise, it trains the tables on the real outcome and, on a
+ *  misprediction, repairs the history from the snapshot the branch
+ *  carries.
+ *
+ *  Author :
+ *  Akshay Shinde (ashinde3@binghamton.edu)
+ *  State University of New York, Binghamton
+ */
+#include <string.h>
+
+#include "cpu.h"
+
+#define COUNTER_MAX 3
+#define COUNTER_WEAKLY_TAKEN 2
+
+/* Counters start weakly not taken, the chooser weakly on bimodal */
+void
+APEX_predictor_init(APEX_Predictor* predictor)
+{
+  memset(predictor, 0, sizeof(*predictor));
+  memset(predictor->bimodal, COUNTER_WEAKLY_TAKEN - 1, sizeof(predictor->bimodal));
+  memset(predictor->gshare, COUNTER_WEAKLY_TAKEN - 1, sizeof(predictor->gshare));
+  memset(predictor->chooser, COUNTER_WEAKLY_TAKEN - 1, sizeof(predictor->chooser));
+}
+
+static int
+history_mask(const APEX_Config* config)
+{
+  return (1 << config->history_bits) - 1;
+}
+
+static int
+bimodal_index(const APEX_Config* config, int pc)
+{
+  return (unsigned)(pc / 4) % config->predictor_entries;
+}
+
+static int
+gshare_index(const APEX_Config* config, int pc, int history)
+{
+  return (unsigned)((pc / 4) ^ (history & history_mask(config))) % config->predictor_entries;
+}
+
+static void
+train(uint8_t* counter, int taken)
+{
+  if (taken && *counter < COUNTER_MAX) {
+    (*counter)++;
+  }
+  else if (!taken && *counter > 0) {
+    (*counter)--;
+  }
+}
+
+/* Direction the selected predictor gives the branch at pc */
+static int
+predict_direction(const APEX_Predictor* predictor, const APEX_Config* config, int pc,
+                  int history)
+{
+  int bimodal = predictor->bimodal[bimodal_index(config, pc)] >= COUNTER_WEAKLY_TAKEN;
+  int gshare = predictor->gshare[gshare_index(config, pc, history)] >= COUNTER_WEAKLY_TAKEN;
+
+  switch (config->predictor) {
+    case PREDICTOR_BIMODAL:
+      return bimodal;
+    case PREDICTOR_GSHARE:
+      return gshare;
+    case PREDICTOR_TOURNAMENT:
+      return (predictor->chooser[bimodal_index(config, pc)] >= COUNTER_WEAKLY_TAKEN) ? gshare
+                                                                                     : bimodal;
+    default:
+      return 0;
+  }
+}
+
+/*
+ * Predicts the branch at pc for Fetch. Returns 1 with *target set if it
+ * is to be followed, 0 to fall through.
+ */
+int
+APEX_predictor_predict(APEX_Predictor* predictor, const APEX_Config* config, int pc,
+                       int* target)
+{
+  const APEX_BTB_Entry* entry = &predictor->btb[(unsigned)(pc / 4) % config->btb_entries];
+  int taken = predict_direction(predictor, config, pc, predictor->history) && entry->pc == pc;
+
+  predictor->history = ((predictor->history << 1) | taken) & history_mask(config);
+  if (taken) {
+    *target = entry->target;
+  }
+  return taken;
+}
+
+static void
+count(APEX_Branch_Stats* stats, int taken, int mispredicted, int late_cycles)
+{
+  stats->resolved++;
+  stats->taken += taken;
+  if (mispredicted) {
+    stats->mispredicted++;
+    stats->penalty_cycles += late_cycles;
+  }
+}
+
+/*
+ * Trains the predictor on the outcome of the branch at pc, which Fetch
+ * predicted with history, and counts it. late_cycles is how much later
+ * than the next cycle after its fetch the correct path is fetched, should
+ * the prediction turn out wrong. Returns 1 if it did.
+ */
+int
+APEX_predictor_resolve(APEX_Predictor* predictor, const APEX_Config* config, int pc,
+                       int history, int predicted_taken, int taken, int target,
+                       int late_cycles)
+{
+  uint8_t* bimodal = &predictor->bimodal[bimodal_index(config, pc)];
+  uint8_t* gshare = &predictor->gshare[gshare_index(config, pc, history)];
+  uint8_t* chooser = &predictor->chooser[bimodal_index(config, pc)];
+
+  /* The chooser moves towards whichever table alone was right */
+  int bimodal_right = (*bimodal >= COUNTER_WEAKLY_TAKEN) == taken;
+  int gshare_right = (*gshare >= COUNTER_WEAKLY_TAKEN) == taken;
+  if (bimodal_right != gshare_right) {
+    train(chooser, gshare_right);
+  }
+  train(bimodal, taken);
+  train(gshare, taken);
+
+  if (taken) {
+    APEX_BTB_Entry* entry = &predictor->btb[(unsigned)(pc / 4) % config->btb_entries];
+    entry->pc = pc;
+    entry->target = target;
+  }
+
+  int mispredicted = (predicted_taken != taken);
+  if (mispredicted) {
+    predictor->history = ((history << 1) | taken) & history_mask(config);
+  }
+
+  count(&predictor->total, taken, mispredicted, late_cycles);
+  int i = 0;
+  while (i < predictor->num_branches && predictor->branches[i].pc != pc) {
+    i++;
+  }
+  if (i == predictor->num_branches && i < APEX_MAX_BRANCH_STATS) {
+    predictor->branches[predictor->num_branches++].pc = pc;
+  }
+  if (i < predictor->num_branches) {
+    count(&predictor->branches[i], taken, mispredicted, late_cycles);
+  }
+  return mispredicted;
+}
@@ -0,0 +1,142 @@
+/*
+ *  thread_pool.c
+ *  Runs a fixed set of independent jobs on a work-stealing pool of host
+ *  threads
+ *
+ *  Every thread owns a queue of job indices, dealt out in contiguous
+ *  blocks so neighbouring jobs (often the same program) run on the same
+ *  thread. A thread takes its next job from the back of its own queue;
+ *  once that is empty it steals from the front of the others' queues, so
+ *  threads that drew short jobs take over from those that drew long ones.
+ *  A job is a whole simulation, so a lock per queue costs nothing next to
+ *  it.
+ *
+ *  Author :
+ *  Akshay Shinde (ashinde3@binghamton.edu)
+ *  State University of New York, Binghamton
+ */
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "cpu.h"
+
+typedef struct APEX_Pool_Queue
+{
+  pthread_mutex_t lock;
+  int head;         // Next index to steal
+  int tail;         // One past the next index to run
+} APEX_Pool_Queue;
+
+typedef struct APEX_Pool
+{
+  APEX_Pool_Queue* queues;
+  int num_threads;
+  APEX_Pool_Job job;
+  void* arg;
+} APEX_Pool;
+
+typedef struct APEX_Pool_Worker
+{
+  APEX_Pool* pool;
+  int id;
+  pthread_t thread;
+} APEX_Pool_Worker;
+
+/* Takes a job from the back of the worker's own queue, or the front of
+ * another's. Returns -1 once every queue is empty; no jobs are added
+ * during a run, so none will turn up later.
+ */
+static int
+next_job(APEX_Pool* pool, int id)
+{
+  for (int k = 0; k < pool->num_threads; ++k) {
+    APEX_Pool_Queue* queue = &pool->queues[(id + k) % pool->num_threads];
+    int index = -1;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->head < queue->tail) {
+      index = (k == 0) ? --queue->tail : queue->head++;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    if (index >= 0) {
+      return index;
+    }
+  }
+  return -1;
+}
+
+static void*
+worker_main(void* arg)
+{
+  APEX_Pool_Worker* worker = arg;
+  int index;
+  while ((index = next_job(worker->pool, worker->id)) >= 0) {
+    worker->pool->job(worker->pool->arg, index);
+  }
+  return NULL;
+}
+
+/*
+ * Calls job(arg, i) for every i in [0, num_jobs) on num_threads threads
+ * and returns once all of them have finished. Jobs run in no particular
+ * order and must not depend on each other. Returns 0 on success, -1 if
+ * the threads could not be started; no job has run then.
+ */
+int
+APEX_pool_run(int num_jobs, int num_threads, APEX_Pool_Job job, void* arg)
+{
+  if (num_threads < 1) {
+    num_threads = 1;
+  }
+  if (num_threads > num_jobs) {
+    num_threads = num_jobs > 0 ? num_jobs : 1;
+  }
+
+  APEX_Pool pool = { NULL, num_threads, job, arg };
+  pool.queues = calloc(num_threads, sizeof(*pool.queues));
+  APEX_Pool_Worker* workers = calloc(num_threads, sizeof(*workers));
+  if (!pool.queues || !workers) {
+    free(pool.queues);
+    free(workers);
+    return -1;
+  }
+
+  /* Queue i holds the jobs [head, tail) of the i-th block */
+  for (int i = 0; i < num_threads; ++i) {
+    pthread_mutex_init(&pool.queues[i].lock, NULL);
+    pool.queues[i].head = (long)num_jobs * i / num_threads;
+    pool.queues[i].tail = (long)num_jobs * (i + 1) / num_threads;
+  }
+
+  /* Hold every queue until all threads are up, so a failed start can
+   * still report that nothing ran
+   */
+  for (int i = 0; i < num_threads; ++i) {
+    pthread_mutex_lock(&pool.queues[i].lock);
+  }
+  int started = 0;
+  for (; started < num_threads; ++started) {
+    workers[started].pool = &pool;
+    workers[started].id = started;
+    if (pthread_create(&workers[started].thread, NULL, worker_main, &workers[started]) != 0) {
+      break;
+    }
+  }
+  if (started < num_threads) {
+    for (int i = 0; i < num_threads; ++i) {
+      pool.queues[i].head = pool.queues[i].tail;
+    }
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    pthread_mutex_unlock(&pool.queues[i].lock);
+  }
+
+  for (int i = 0; i < started; ++i) {
+    pthread_join(workers[i].thread, NULL);
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    pthread_mutex_destroy(&pool.queues[i].lock);
+  }
+  free(pool.queues);
+  free(workers);
+  return started < num_threads ? -1 : 0;
+}
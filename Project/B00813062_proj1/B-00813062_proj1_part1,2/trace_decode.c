@@ -0,0 +1,132 @@
+/*
+ *  trace_decode.c
+ *  Offline decoder for binary pipeline traces
+ *
+ *  Prints a trace written with apex_sim's trace file argument exactly as
+ *  the stage-level text trace prints those cycles. With --stalls it
+ *  prints how many cycles each stage was held, by reason, instead.
+ *
+ *  Author :
+ *  Akshay Shinde (ashinde3@binghamton.edu)
+ *  State University of New York, Binghamton
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "cpu.h"
+
+#define DECODE_BATCH 4096
+
+static const char* stall_names[NUM_STALL_REASONS] = {
+  [APEX_STALL_NONE]       = "running",
+  [APEX_STALL_DEPENDENCE] = "dependence",
+  [APEX_STALL_LATENCY]    = "latency",
+  [APEX_STALL_HALT]       = "halt",
+};
+
+static void
+print_record(const APEX_Config* config, const APEX_Trace_Record* record)
+{
+  if (record->kind == APEX_TRACE_CYCLE) {
+    print_cycle_banner(record->pc);
+  }
+  else if (record->kind == APEX_TRACE_EMPTY) {
+    print_empty_stage(config, record->stage);
+  }
+  else {
+    CPU_Stage stage;
+    memset(&stage, 0, sizeof(stage));
+    stage.pc = record->pc;
+    stage.imm = record->imm;
+    stage.opcode = record->opcode;
+    stage.rd = record->rd;
+    stage.rs1 = record->rs1;
+    stage.rs2 = record->rs2;
+    stage.rs3 = record->rs3;
+    print_stage(config, record->stage, &stage);
+  }
+}
+
+int
+main(int argc, char const* argv[])
+{
+  int stalls = (argc == 3 && strcmp(argv[2], "--stalls") == 0);
+  if (argc != 2 && !stalls) {
+    fprintf(stderr, "APEX_Help : Usage %s <trace_file> [--stalls]\n", argv[0]);
+    exit(1);
+  }
+
+  gzFile file = gzopen(argv[1], "rb");
+  if (!file) {
+    fprintf(stderr, "APEX_Error : Unable to open %s\n", argv[1]);
+    exit(1);
+  }
+
+  APEX_Trace_Header header;
+  if (gzread(file, &header, sizeof(header)) != sizeof(header) ||
+      memcmp(header.magic, APEX_TRACE_MAGIC, 4) != 0 ||
+      header.version != APEX_TRACE_VERSION ||
+      header.record_size != sizeof(APEX_Trace_Record)) {
+    fprintf(stderr, "APEX_Error : %s is not an APEX trace\n", argv[1]);
+    exit(1);
+  }
+
+  /* Stage ids in the records are numbered as in the traced pipeline */
+  APEX_Config config;
+  APEX_config_default(&config);
+  config.ex_stages = header.ex_stages;
+  config.mem_stages = header.mem_stages;
+  if (APEX_config_check(&config) != 0) {
+    fprintf(stderr, "APEX_Error : %s has an invalid pipeline shape\n", argv[1]);
+    exit(1);
+  }
+  int num_stages = EX1 + config.ex_stages + config.mem_stages + 1;
+
+  static APEX_Trace_Record records[DECODE_BATCH];
+  long stall_cycles[APEX_MAX_STAGES][NUM_STALL_REASONS] = { { 0 } };
+  int bytes;
+  while ((bytes = gzread(file, records, sizeof(records))) > 0) {
+    int count = bytes / sizeof(APEX_Trace_Record);
+    for (int i = 0; i < count; ++i) {
+      if (records[i].kind > APEX_TRACE_EMPTY || records[i].stage >= num_stages ||
+          records[i].opcode >= NUM_OPCODES || records[i].stall >= NUM_STALL_REASONS) {
+        fprintf(stderr, "APEX_Error : Corrupt trace record\n");
+        exit(1);
+      }
+      if (stalls) {
+        if (records[i].kind != APEX_TRACE_CYCLE) {
+          stall_cycles[records[i].stage][records[i].stall]++;
+        }
+      }
+      else {
+        print_record(&config, &records[i]);
+      }
+    }
+  }
+
+  if (bytes < 0) {
+    fprintf(stderr, "APEX_Error : Truncated trace\n");
+    exit(1);
+  }
+  gzclose(file);
+
+  if (stalls) {
+    printf("%-6s", "stage");
+    for (int r = 0; r < NUM_STALL_REASONS; ++r) {
+      printf(" %12s", stall_names[r]);
+    }
+    printf("\n");
+    for (int s = 0; s < num_stages; ++s) {
+      char label[16];
+      stage_label(label, &config, s);
+      printf("%-6s", label);
+      for (int r = 0; r < NUM_STALL_REASONS; ++r) {
+        printf(" %12ld", stall_cycles[s][r]);
+      }
+      printf("\n");
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,156 @@
+/*
+ *  trace_writer.c
+ *  Contains the binary pipeline trace writer
+ *
+ *  The simulator thread pushes records into a single-producer,
+ *  single-consumer ring. A writer thread drains the ring into a gzip
+ *  file, so compression and I/O never run in the simulation loop. When
+ *  the ring is full the simulator waits for the writer, records are
+ *  never dropped.
+ *
+ *  Author :
+ *  Akshay Shinde (ashinde3@binghamton.edu)
+ *  State University of New York, Binghamton
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+
+#include "cpu.h"
+
+/* Ring size in records, a power of two */
+#define TRACE_RING_RECORDS (1 << 16)
+#define TRACE_RING_MASK (TRACE_RING_RECORDS - 1)
+
+struct APEX_Trace_Writer
+{
+  APEX_Trace_Record* ring;
+
+  /* Producer side, written by the simulator thread only */
+  _Atomic size_t head;    // Next slot to fill
+  size_t tail_seen;       // Last tail read, refreshed only when the ring looks full
+
+  /* Consumer side, written by the writer thread only */
+  _Atomic size_t tail;    // Next slot to drain
+
+  _Atomic int closing;    // Set once the last record has been pushed
+  int failed;             // Set by the writer thread on a write error
+  gzFile file;
+  pthread_t thread;
+};
+
+static void*
+trace_writer_main(void* arg)
+{
+  APEX_Trace_Writer* writer = arg;
+  const struct timespec idle = { 0, 200 * 1000 };
+
+  while (1) {
+    size_t tail = atomic_load_explicit(&writer->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&writer->head, memory_order_acquire);
+
+    if (head == tail) {
+      if (atomic_load_explicit(&writer->closing, memory_order_acquire) &&
+          atomic_load_explicit(&writer->head, memory_order_acquire) == tail) {
+        break;
+      }
+      nanosleep(&idle, NULL);
+      continue;
+    }
+
+    /* Drain up to the end of the ring, the wrapped part goes next round */
+    size_t begin = tail & TRACE_RING_MASK;
+    size_t count = head - tail;
+    if (count > TRACE_RING_RECORDS - begin) {
+      count = TRACE_RING_RECORDS - begin;
+    }
+
+    size_t bytes = count * sizeof(APEX_Trace_Record);
+    if (!writer->failed && gzwrite(writer->file, &writer->ring[begin], bytes) != (int)bytes) {
+      writer->failed = 1;
+    }
+    atomic_store_explicit(&writer->tail, tail + count, memory_order_release);
+  }
+  return NULL;
+}
+
+/*
+ * Creates the trace file at path for a pipeline of the shape in config,
+ * writes its header and starts the writer thread. Returns NULL on failure.
+ */
+APEX_Trace_Writer*
+trace_writer_open(const char* path, const APEX_Config* config)
+{
+  APEX_Trace_Writer* writer = calloc(1, sizeof(*writer));
+  if (!writer) {
+    return NULL;
+  }
+
+  writer->ring = malloc(TRACE_RING_RECORDS * sizeof(APEX_Trace_Record));
+  writer->file = gzopen(path, "wb1");
+  if (!writer->ring || !writer->file) {
+    goto fail;
+  }
+
+  APEX_Trace_Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, APEX_TRACE_MAGIC, 4);
+  header.version = APEX_TRACE_VERSION;
+  header.record_size = sizeof(APEX_Trace_Record);
+  header.ex_stages = config->ex_stages;
+  header.mem_stages = config->mem_stages;
+  if (gzwrite(writer->file, &header, sizeof(header)) != sizeof(header)) {
+    goto fail;
+  }
+
+  atomic_init(&writer->head, 0);
+  atomic_init(&writer->tail, 0);
+  atomic_init(&writer->closing, 0);
+  if (pthread_create(&writer->thread, NULL, trace_writer_main, writer) != 0) {
+    goto fail;
+  }
+  return writer;
+
+fail:
+  if (writer->file) {
+    gzclose(writer->file);
+  }
+  free(writer->ring);
+  free(writer);
+  return NULL;
+}
+
+void
+trace_writer_push(APEX_Trace_Writer* writer, const APEX_Trace_Record* record)
+{
+  size_t head = atomic_load_explicit(&writer->head, memory_order_relaxed);
+
+  while (head - writer->tail_seen == TRACE_RING_RECORDS) {
+    writer->tail_seen = atomic_load_explicit(&writer->tail, memory_order_acquire);
+    if (head - writer->tail_seen == TRACE_RING_RECORDS) {
+      sched_yield();
+    }
+  }
+
+  writer->ring[head & TRACE_RING_MASK] = *record;
+  atomic_store_explicit(&writer->head, head + 1, memory_order_release);
+}
+
+/* Waits for the writer thread to drain the ring, then closes the file */
+void
+trace_writer_close(APEX_Trace_Writer* writer)
+{
+  atomic_store_explicit(&writer->closing, 1, memory_order_release);
+  pthread_join(writer->thread, NULL);
+
+  if (gzclose(writer->file) != Z_OK || writer->failed) {
+    fprintf(stderr, "APEX_Error : Trace file is incomplete\n");
+  }
+  free(writer->ring);
+  free(writer);
+}
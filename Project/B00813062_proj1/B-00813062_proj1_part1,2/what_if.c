@@ -0,0 +1,112 @@
+/*
+ *  what_if.c
+ *  Contains functions to branch one APEX cpu into several runs that each
+ *  use their own pipeline parameters
+ *
+ *  The branch point is wherever the caller paused the cpu, typically with
+ *  APEX_cpu_run_until. Every configuration runs in a forked child, which
+ *  shares the state of the paused cpu copy-on-write, so only the pages a
+ *  run dirties are copied and no run repeats the simulation up to the
+ *  branch point. Children run at the same time and return their stats to
+ *  the parent through a pipe each.
+ *
+ *  Author :
+ *  Akshay Shinde (ashinde3@binghamton.edu)
+ *  State University of New York, Binghamton
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "cpu.h"
+
+/* Runs in the child: finish the program under config and report */
+static void
+what_if_child(APEX_CPU* cpu, const APEX_Config* config, int max_clock, int fd)
+{
+  /* The trace writer thread was not forked, and several runs printing to
+   * the same terminal would only interleave
+   */
+  cpu->trace_writer = NULL;
+  cpu->trace_level = TRACE_OFF;
+  cpu->tracing = 0;
+  if (APEX_cpu_set_config(cpu, config) != 0) {
+    _exit(1);
+  }
+
+  APEX_What_If_Result result;
+  memset(&result, 0, sizeof(result));
+  result.completed = APEX_cpu_run_until(cpu, max_clock, -1);
+  result.clock = cpu->clock;
+  result.ins_committed = cpu->ins_committed;
+
+  int ok = write(fd, &result, sizeof(result)) == sizeof(result);
+  _exit(ok ? 0 : 1);
+}
+
+/*
+ * Runs cpu from its current state once per configuration in configs, each
+ * in its own forked child, until the program completes or max_clock is
+ * reached (a negative max_clock runs to completion). cpu itself is left
+ * as it was. Fills results[i] for configs[i], with completed set to -1
+ * where the run failed, as it does for a configuration APEX_cpu_set_config
+ * refuses. Returns 0 if every run reported, -1 otherwise.
+ */
+int
+APEX_cpu_what_if(APEX_CPU* cpu, const APEX_Config* configs, int count, int max_clock,
+                 APEX_What_If_Result* results)
+{
+  pid_t* pids = calloc(count, sizeof(*pids));
+  int* fds = malloc(count * sizeof(*fds));
+  if (!pids || !fds) {
+    free(pids);
+    free(fds);
+    return -1;
+  }
+
+  /* Output still buffered would be written once by every child as well */
+  fflush(stdout);
+  fflush(stderr);
+
+  for (int i = 0; i < count; ++i) {
+    int pipe_fds[2];
+    fds[i] = -1;
+    if (pipe(pipe_fds) < 0) {
+      continue;
+    }
+    pids[i] = fork();
+    if (pids[i] == 0) {
+      close(pipe_fds[0]);
+      what_if_child(cpu, &configs[i], max_clock, pipe_fds[1]);
+    }
+    close(pipe_fds[1]);
+    if (pids[i] < 0) {
+      close(pipe_fds[0]);
+      continue;
+    }
+    fds[i] = pipe_fds[0];
+  }
+
+  int failed = 0;
+  for (int i = 0; i < count; ++i) {
+    memset(&results[i], 0, sizeof(results[i]));
+    results[i].completed = -1;
+    if (fds[i] >= 0) {
+      APEX_What_If_Result result;
+      if (read(fds[i], &result, sizeof(result)) == sizeof(result)) {
+        results[i] = result;
+      }
+      close(fds[i]);
+    }
+    if (pids[i] > 0) {
+      waitpid(pids[i], NULL, 0);
+    }
+    failed |= (results[i].completed < 0);
+  }
+
+  free(pids);
+  free(fds);
+  return failed ? -1 : 0;
+}
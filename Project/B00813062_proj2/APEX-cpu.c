@@ -2,6 +2,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <time.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
 
 #ifndef VALID
 #define VALID 1
@@ -9,37 +17,28 @@
 #ifndef INVALID
 #define INVALID 0
 #endif
-#ifndef max_instructions
-#define max_instructions 100
+#ifndef code_chunk_records
+#define code_chunk_records 4096
 #endif
 
-long data_Memory[1000];
-int pc = 0;
-int instr_line_Number = 0;
-
-void iq();
-void LSQ();
-void ROB();
-
-int prf_available();
-int find_new_prf();
-void old_instance_prf(int );
-int find_existing_prf(int, int);
-
-void FETCH_STAGE();
-void DECODE_RF_STAGE();
-void INT1_FU_STAGE();
-void INT2_FU_STAG();
-void memory();
-void mul1();
-void mul2();
-void mul3();
-void bz_fu();
-void intialize();
-void simulate(char file_name[]);
-void display();
-
-
+//Largest sizes a machine can be configured with, the machine keeps room
+//for this many entries whatever sizes it runs with
+#define MAX_ROB_SIZE 256
+#define MAX_IQ_SIZE 256
+#define MAX_LSQ_SIZE 128
+#define MAX_PRF_SIZE 512
+
+//Trace levels, each level also prints everything the levels below print:
+//off prints nothing per cycle, commit the cycle banner and ROB head, stage
+//every stage and queue, full the program listing at load as well
+enum { TRACE_OFF, TRACE_COMMIT, TRACE_STAGE, TRACE_FULL, NUM_TRACE_LEVELS };
+const char *trace_level_names[NUM_TRACE_LEVELS] = { "off", "commit", "stage", "full" };
+int trace_level = TRACE_FULL;
+
+//printf when tracing at level or above. With tracing off this is a single
+//compare and a branch that is never taken, the arguments are not evaluated
+#define trace(level, ...) \
+    do { if (__builtin_expect(trace_level >= (level), 0)) printf(__VA_ARGS__); } while (0)
 
 //ARF structure
 typedef struct {
@@ -49,8 +48,6 @@ typedef struct {
     int prf_id;
 }registers;
 
-registers arch_Reg_File[16] = {};
-
 //PRF structure
 typedef struct {
     long value;
@@ -61,8 +58,6 @@ typedef struct {
     int old_instance;
 }prf;
 
-prf physical_Reg_File[24];
-
 //Instructions structure
 typedef struct {
 
@@ -77,1843 +72,2651 @@ typedef struct {
   int branch;
   int id;
   int status;
+  int phys_dest;
 } Instructions;
 
-Instructions instruction[max_instructions];
-Instructions *ptr_instruction = instruction;
-
-Instructions iqueue[12];
-Instructions rob[12];
-Instructions lsq[6];
-
-int lst_arithm_index = -1;
-int lst_arithm_instruction = -1;
-long lst_arithm_resultset = -10;
-
-const Instructions nop = {0, "nop", 0, 0, -1, 0, 0, 0, 0, 0, 0};
-Instructions fetch_input = {0, "nop", 0, 0, -1, 0, 0, 0, 0, 0, 0};
-Instructions decode_input = {0, "nop", 0, 0, -1, 0, 0, 0, 0, 0, 0};
-Instructions int_fun1_input = {0, "nop", 0, 0, -1, 0, 0, 0, 0, 0, 0};
-Instructions int_fun2_input = {0, "nop", 0, 0, -1, 0, 0, 0, 0, 0, 0};
-Instructions memory_input = {0, "nop", 0, 0, -1, 0, 0, 0, 0, 0, 0};
-Instructions mul_fun1_input = {0, "nop", 0, 0, -1, 0, 0, 0, 0, 0, 0};
-Instructions mul_fun2_input = {0, "nop", 0, 0, -1, 0, 0, 0, 0, 0, 0};
-Instructions mul_fun3_input = {0, "nop", 0, 0, -1, 0, 0, 0, 0, 0, 0};
-Instructions branch_fun_input = {0, "nop", 0, 0, -1, 0, 0, 0, 0, 0, 0};
-
-int ind = 0;
-int bflag = 0;
-int hflag = 0;
-int mflag = 0;
-int dflag = 0;
-int id = 1;
-int ch = 0;
-int bzflag = 0;
-int jflag = 0;
-
-int dummy1 = 0;
-int dummy2 = 0;
-int dummy3 = 0;
-
-int iq_add_index = 0;
-int iq_rem_index = 0;
-int iq_full_index = 0;
-
-int rob_add_index = 0;
-int rob_com_index = 0;
-int rob_full_index = 0;
-
-int lsq_add_index = 0;
-int lsq_rem_index = 0;
-int lsq_full_index = 0;
-
-int main(){
+
+//Precompiled object (.ooo.apexo) format, the same layout as the in-order
+//simulator's .apexo with its own front end tag and file, so the two never
+//evict each other's cache: header, then one packed record per instruction,
+//in host byte order. The source hash covers the .asm text, so a stale
+//object is re-parsed.
+#define APEXO_MAGIC "APXO"
+#define APEXO_VERSION 1
+#define APEXO_FRONTEND_OOO 2
+#define APEXO_SUFFIX ".ooo.apexo"
+
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t frontend;
+    uint32_t record_size;
+    uint32_t count;
+    uint64_t source_hash;
+} object_header;
+
+//Opcode IDs, numbered as in the in-order simulator
+enum {
+    OPCODE_NONE, OPCODE_INVALID, OPCODE_MOVC, OPCODE_STORE, OPCODE_STR,
+    OPCODE_ADD, OPCODE_ADDL, OPCODE_SUB, OPCODE_SUBL, OPCODE_MUL, OPCODE_AND,
+    OPCODE_OR, OPCODE_EXOR, OPCODE_LOAD, OPCODE_LDR, OPCODE_BZ, OPCODE_BNZ,
+    OPCODE_JUMP, OPCODE_HALT, NUM_OPCODES
+};
+
+const char *opcode_names[NUM_OPCODES] = {
+    "", "INVALID", "MOVC", "STORE", "STR", "ADD", "ADDL", "SUB", "SUBL", "MUL",
+    "AND", "OR", "EX-OR", "LOAD", "LDR", "BZ", "BNZ", "JUMP", "HALT"
+};
+
+//Packed instruction record, a dest of -1 is stored as 0xFF
+typedef struct {
+    uint8_t opcode;
+    uint8_t flags;
+    uint8_t rd;
+    uint8_t rs1;
+    uint8_t rs2;
+    uint8_t rs3;
+    int imm;
+} packed_instruction;
+
+//Code store: the program as packed records with their instruction ids, kept
+//in fixed-size chunks so a large program grows without moving loaded code
+typedef struct {
+    packed_instruction ins;
+    int id;
+} code_record;
+
+typedef struct {
+    code_record **chunks;
+    int num_chunks;
+    int max_chunks;
+    int size;
+} code_store;
+
+//Complete state of one out-of-order machine. Every stage works on the
+//machine it is passed and nothing else, so any number of machines can be
+//simulated at once, each from one host thread.
+typedef struct {
+    long data_Memory[1000];
+    int pc;
+    int cycle;
+    int instr_line_Number;
+
+    //Entries in use of the ROB, IQ, LSQ and PRF, 12, 12, 6 and 24 unless
+    //set with ooo_cpu_set_sizes
+    int rob_size;
+    int iq_size;
+    int lsq_size;
+    int prf_size;
+    long committed;
+    int last_commit_cycle;
+
+    registers arch_Reg_File[16];
+    prf physical_Reg_File[MAX_PRF_SIZE];
+
+    //PRF free list: bit i of prf_free is set while physical register i is
+    //free, so the lowest free one is a find-first-set away
+    uint64_t prf_free[MAX_PRF_SIZE / 64];
+    int prf_free_count;
+
+    //Rename table: the physical register each architectural register maps
+    //to, -1 until it is first written. committed_rename_table is the
+    //mapping as of the last commit, which a squash goes back to.
+    int rename_table[16];
+    int committed_rename_table[16];
+    code_store program;
+
+    Instructions iqueue[MAX_IQ_SIZE];
+    Instructions rob[MAX_ROB_SIZE];
+    Instructions lsq[MAX_LSQ_SIZE];
+
+    int lst_arithm_index;
+    int lst_arithm_instruction;
+    long lst_arithm_resultset;
+
+    Instructions fetch_input;
+    Instructions decode_input;
+    Instructions int_fun1_input;
+    Instructions int_fun2_input;
+    Instructions memory_input;
+    Instructions mul_fun1_input;
+    Instructions mul_fun2_input;
+    Instructions mul_fun3_input;
+    Instructions branch_fun_input;
+
+    int ind;
+    int bflag;
+    int hflag;
+    int mflag;
+    int dflag;
+    int id;
+    int bzflag;
+    int jflag;
+
+    int dummy1;
+    int dummy2;
+    int dummy3;
+
+    int iq_add_index;
+    int iq_rem_index;
+    int iq_full_index;
+
+    int rob_add_index;
+    int rob_com_index;
+    int rob_full_index;
+
+    int lsq_add_index;
+    int lsq_rem_index;
+    int lsq_full_index;
+} APEX_OOO_CPU;
+
+const Instructions nop = {0, "nop", 0, 0, -1, 0, 0, 0, 0, 0, 0, -1};
+
+APEX_OOO_CPU *ooo_cpu_create();
+int sizes_valid(int rob_size, int iq_size, int lsq_size, int prf_size);
+int ooo_cpu_set_sizes(APEX_OOO_CPU *cpu, int rob_size, int iq_size, int lsq_size, int prf_size);
+void ooo_cpu_destroy(APEX_OOO_CPU *cpu);
+
+void iq(APEX_OOO_CPU *cpu);
+void LSQ(APEX_OOO_CPU *cpu);
+void ROB(APEX_OOO_CPU *cpu);
+
+int prf_available(APEX_OOO_CPU *cpu);
+int find_new_prf(APEX_OOO_CPU *cpu);
+void free_prf(APEX_OOO_CPU *cpu, int);
+int rename_dest(APEX_OOO_CPU *cpu, int, int);
+int rename_source(APEX_OOO_CPU *cpu, int, int);
+void rename_restore(APEX_OOO_CPU *cpu);
+
+void FETCH_STAGE(APEX_OOO_CPU *cpu);
+void DECODE_RF_STAGE(APEX_OOO_CPU *cpu);
+void INT1_FU_STAGE(APEX_OOO_CPU *cpu);
+void INT2_FU_STAG(APEX_OOO_CPU *cpu);
+void memory(APEX_OOO_CPU *cpu);
+void mul1(APEX_OOO_CPU *cpu);
+void mul2(APEX_OOO_CPU *cpu);
+void mul3(APEX_OOO_CPU *cpu);
+void bz_fu(APEX_OOO_CPU *cpu);
+void intialize(APEX_OOO_CPU *cpu);
+void simulate(APEX_OOO_CPU *cpu, char file_name[]);
+int load_program(APEX_OOO_CPU *cpu, char file_name[]);
+void run_cycles(APEX_OOO_CPU *cpu, int cycles);
+int simulate_cycles(APEX_OOO_CPU *cpu, int cycles);
+int sweep(char file_name[], char *ranges[4], int cycles, int threads);
+void display(APEX_OOO_CPU *cpu);
+
+uint64_t hash_text(const char *text, size_t len);
+int hash_file(char file_name[], uint64_t *hash);
+void object_path(char file_name[], char path[], size_t size);
+int valid_record(const packed_instruction *record);
+int load_object(APEX_OOO_CPU *cpu, char file_name[], uint64_t source_hash);
+void save_object(APEX_OOO_CPU *cpu, char file_name[], uint64_t source_hash, int first, int count);
+int save_checkpoint(APEX_OOO_CPU *cpu, char file_name[]);
+int restore_checkpoint(APEX_OOO_CPU *cpu, char file_name[]);
+
+code_record *code_store_grow(APEX_OOO_CPU *cpu);
+void code_store_append(APEX_OOO_CPU *cpu, Instructions *ins);
+Instructions code_store_fetch(APEX_OOO_CPU *cpu, int address);
+
+//Checkpoint (.apexc) format, shared with the in-order simulator: header,
+//then every region of state_regions in order, then the code store records,
+//in host byte order. Bump CHECKPOINT_VERSION whenever a region is added,
+//removed or changes type; the state size catches most such changes.
+#define CHECKPOINT_MAGIC "APXC"
+#define CHECKPOINT_VERSION 4
+#define CHECKPOINT_FRONTEND_OOO 2
+
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t frontend;
+    uint32_t state_size;
+    uint32_t record_size;
+    uint32_t count;
+    uint32_t state_offset;
+    uint64_t code_offset;
+} checkpoint_header;
+
+//Everything a run reads or writes: register files, data memory, IQ, ROB,
+//LSQ, function unit latches, pc and the pipeline control flags. The code
+//store is saved as records after them.
+typedef struct {
+    size_t offset;
+    size_t size;
+} state_region;
+
+#define STATE_REGION(x) { offsetof(APEX_OOO_CPU, x), sizeof(((APEX_OOO_CPU *)0)->x) }
+
+const state_region state_regions[] = {
+    STATE_REGION(data_Memory), STATE_REGION(pc), STATE_REGION(cycle),
+    STATE_REGION(instr_line_Number),
+    STATE_REGION(rob_size), STATE_REGION(iq_size), STATE_REGION(lsq_size),
+    STATE_REGION(prf_size), STATE_REGION(committed), STATE_REGION(last_commit_cycle),
+    STATE_REGION(arch_Reg_File), STATE_REGION(physical_Reg_File),
+    STATE_REGION(prf_free), STATE_REGION(prf_free_count),
+    STATE_REGION(rename_table), STATE_REGION(committed_rename_table),
+    STATE_REGION(iqueue), STATE_REGION(rob), STATE_REGION(lsq),
+    STATE_REGION(lst_arithm_index), STATE_REGION(lst_arithm_instruction),
+    STATE_REGION(lst_arithm_resultset),
+    STATE_REGION(fetch_input), STATE_REGION(decode_input),
+    STATE_REGION(int_fun1_input), STATE_REGION(int_fun2_input),
+    STATE_REGION(memory_input), STATE_REGION(mul_fun1_input),
+    STATE_REGION(mul_fun2_input), STATE_REGION(mul_fun3_input),
+    STATE_REGION(branch_fun_input),
+    STATE_REGION(ind), STATE_REGION(bflag), STATE_REGION(hflag), STATE_REGION(mflag),
+    STATE_REGION(dflag), STATE_REGION(id), STATE_REGION(bzflag), STATE_REGION(jflag),
+    STATE_REGION(dummy1), STATE_REGION(dummy2), STATE_REGION(dummy3),
+    STATE_REGION(iq_add_index), STATE_REGION(iq_rem_index), STATE_REGION(iq_full_index),
+    STATE_REGION(rob_add_index), STATE_REGION(rob_com_index), STATE_REGION(rob_full_index),
+    STATE_REGION(lsq_add_index), STATE_REGION(lsq_rem_index), STATE_REGION(lsq_full_index),
+};
+
+#define NUM_STATE_REGIONS (sizeof(state_regions) / sizeof(state_regions[0]))
+
+//Sizes named on the command line, in the order rob, iq, lsq, prf
+const char *size_options[4] = { "--rob=", "--iq=", "--lsq=", "--prf=" };
+
+void usage(char *program){
+    fprintf(stderr, "Usage %s [off|commit|stage|full] [--rob=<n>] [--iq=<n>] [--lsq=<n>] [--prf=<n>]\n"
+                    "       %s --sweep=<file> [--rob=<range>] [--iq=<range>] [--lsq=<range>]\n"
+                    "                 [--prf=<range>] [--cycles=<n>] [--threads=<n>]\n"
+                    "  A range is <first>:<last>[:<step>] or a single size. --sweep runs\n"
+                    "  every combination of sizes in parallel and prints the IPC of each\n",
+            program, program);
+    exit(1);
+}
+
+int main(int argc, char *argv[]){
 
     char file_name[20];
+    int ch = 0;
+    char *sizes[4] = { "12", "12", "6", "24" };
+    char *sweep_file = NULL;
+    int sweep_cycles = 100000;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int a = 1; a < argc; a++){
+        int matched = 0;
+        for (int k = 0; k < 4; k++){
+            if (!(strncmp(argv[a], size_options[k], strlen(size_options[k])))){
+                sizes[k] = argv[a] + strlen(size_options[k]);
+                matched = 1;
+            }
+        }
+        if (matched)
+            continue;
+        if (!(strncmp(argv[a], "--sweep=", 8)))
+            sweep_file = argv[a] + 8;
+        else if (!(strncmp(argv[a], "--cycles=", 9)))
+            sweep_cycles = atoi(argv[a] + 9);
+        else if (!(strncmp(argv[a], "--threads=", 10)))
+            threads = atoi(argv[a] + 10);
+        else {
+            trace_level = -1;
+            for (int i = 0; i < NUM_TRACE_LEVELS; i++){
+                if (!(strcmp(argv[a], trace_level_names[i])))
+                    trace_level = i;
+            }
+            if (trace_level < 0)
+                usage(argv[0]);
+        }
+    }
+
+    if (sweep_file){
+        trace_level = TRACE_OFF;
+        if (!sweep(sweep_file, sizes, sweep_cycles, threads))
+            usage(argv[0]);
+        return 0;
+    }
+
+    APEX_OOO_CPU *cpu = ooo_cpu_create();
+    if (!cpu){
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    char *end[4];
+    if (!ooo_cpu_set_sizes(cpu, strtol(sizes[0], &end[0], 10), strtol(sizes[1], &end[1], 10),
+                           strtol(sizes[2], &end[2], 10), strtol(sizes[3], &end[3], 10)) ||
+        *end[0] || *end[1] || *end[2] || *end[3])
+        usage(argv[0]);
 
     while (1)
     {
-        printf("\n Enter '1' for 'INITIALIZATION', '2' to 'SIMULATE', '3' to 'DISPLAY', and '0' to TERMINATE\n\t");
+        printf("\n Enter '1' for 'INITIALIZATION', '2' to 'SIMULATE', '3' to 'DISPLAY', '4' to 'SAVE CHECKPOINT', '5' to 'RESTORE CHECKPOINT', '6' to 'CONTINUE', and '0' to TERMINATE\n\t");
         scanf("%d", &ch);
 
         if (ch == 1)
-            intialize();
+            intialize(cpu);
         else if (ch == 2)
         {
             printf("\n Enter the filename you want to simulate : \t ");
             scanf("%s", file_name);
-            simulate(file_name);
+            simulate(cpu, file_name);
         }
         else if (ch == 3)
-            display();
+            display(cpu);
+        else if (ch == 4 || ch == 5)
+        {
+            printf("\n Enter the checkpoint filename : \t ");
+            scanf("%s", file_name);
+            if (ch == 4 && !save_checkpoint(cpu, file_name))
+                printf("\n Unable to save checkpoint %s", file_name);
+            if (ch == 5 && !restore_checkpoint(cpu, file_name))
+                printf("\n Unable to restore checkpoint %s", file_name);
+        }
+        else if (ch == 6)
+        {
+            printf("\n\t Enter the no. of clock cycles: ");
+            int cycles = 0;
+            scanf("%d", &cycles);
+            run_cycles(cpu, cycles);
+        }
         else if (ch == 0)
             break;
         else
             printf("\n Enter a Valid Command");
     }
+    ooo_cpu_destroy(cpu);
+}
+
+//Returns a machine in its power-on state, with every latch and queue
+//entry empty and no program loaded
+APEX_OOO_CPU *ooo_cpu_create(){
+    APEX_OOO_CPU *cpu = calloc(1, sizeof(APEX_OOO_CPU));
+    if (!cpu)
+        return NULL;
+
+    cpu->lst_arithm_index = -1;
+    cpu->lst_arithm_instruction = -1;
+    cpu->lst_arithm_resultset = -10;
+    cpu->fetch_input = nop;
+    cpu->decode_input = nop;
+    cpu->int_fun1_input = nop;
+    cpu->int_fun2_input = nop;
+    cpu->memory_input = nop;
+    cpu->mul_fun1_input = nop;
+    cpu->mul_fun2_input = nop;
+    cpu->mul_fun3_input = nop;
+    cpu->branch_fun_input = nop;
+    cpu->id = 1;
+    ooo_cpu_set_sizes(cpu, 12, 12, 6, 24);
+    return cpu;
+}
+
+int sizes_valid(int rob_size, int iq_size, int lsq_size, int prf_size){
+    return rob_size >= 2 && rob_size <= MAX_ROB_SIZE && iq_size >= 2 && iq_size <= MAX_IQ_SIZE &&
+           lsq_size >= 2 && lsq_size <= MAX_LSQ_SIZE && prf_size >= 2 && prf_size <= MAX_PRF_SIZE;
+}
+
+//Sets the sizes of the ROB, IQ, LSQ and PRF, before the machine is
+//initialized. Returns 0, changing nothing, if a size is out of range.
+int ooo_cpu_set_sizes(APEX_OOO_CPU *cpu, int rob_size, int iq_size, int lsq_size, int prf_size){
+    if (!sizes_valid(rob_size, iq_size, lsq_size, prf_size))
+        return 0;
+    cpu->rob_size = rob_size;
+    cpu->iq_size = iq_size;
+    cpu->lsq_size = lsq_size;
+    cpu->prf_size = prf_size;
+    return 1;
+}
+
+void ooo_cpu_destroy(APEX_OOO_CPU *cpu){
+    for (int i = 0; i < cpu->program.num_chunks; i++)
+        free(cpu->program.chunks[i]);
+    free(cpu->program.chunks);
+    free(cpu);
+}
+
+//One combination of sizes in a sweep and how the program ran with it
+typedef struct {
+    int sizes[4];
+    int cycles;
+    long committed;
+    int halted;
+    int loaded;
+} sweep_point;
+
+typedef struct {
+    char *file_name;
+    sweep_point *points;
+    int count;
+    int next;
+    int cycles;
+} sweep_job;
+
+//Parses <first>:<last>[:<step>] or a single size into range[3]
+int parse_range(char *text, int range[3]){
+    char *end;
+    range[0] = strtol(text, &end, 10);
+    range[1] = range[0];
+    range[2] = 1;
+    if (*end == ':'){
+        range[1] = strtol(end + 1, &end, 10);
+        if (*end == ':')
+            range[2] = strtol(end + 1, &end, 10);
+    }
+    return *end == 0 && end != text && range[2] > 0 && range[1] >= range[0];
 }
 
-void simulate(char file_name[])
+//Worker thread, takes the next point of the sweep until none is left
+void *sweep_worker(void *arg){
+    sweep_job *job = arg;
+    int index;
+    while ((index = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->count){
+        sweep_point *point = &job->points[index];
+        APEX_OOO_CPU *cpu = ooo_cpu_create();
+        if (!cpu)
+            continue;
+        ooo_cpu_set_sizes(cpu, point->sizes[0], point->sizes[1], point->sizes[2], point->sizes[3]);
+        intialize(cpu);
+        point->loaded = load_program(cpu, job->file_name);
+        if (point->loaded){
+            //The model rarely retires HALT and can stall for good once a
+            //queue wraps, so IPC counts cycles up to the last commit
+            simulate_cycles(cpu, job->cycles);
+            point->cycles = cpu->last_commit_cycle;
+            point->committed = cpu->committed;
+            point->halted = (cpu->hflag == 100);
+        }
+        ooo_cpu_destroy(cpu);
+    }
+    return NULL;
+}
+
+//Runs file_name for up to cycles cycles with every combination of the
+//ROB, IQ, LSQ and PRF size ranges, on threads threads, and prints one row
+//of IPC per combination. Returns 0 if a range is invalid.
+int sweep(char file_name[], char *ranges[4], int cycles, int threads){
+    int range[4][3];
+    int count = 1;
+    for (int k = 0; k < 4; k++){
+        if (!parse_range(ranges[k], range[k]))
+            return 0;
+        count *= (range[k][1] - range[k][0]) / range[k][2] + 1;
+    }
+
+    sweep_job job = { file_name, calloc(count, sizeof(sweep_point)), count, 0, cycles };
+    if (!job.points){
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    int index = 0;
+    for (int rob_size = range[0][0]; rob_size <= range[0][1]; rob_size += range[0][2])
+        for (int iq_size = range[1][0]; iq_size <= range[1][1]; iq_size += range[1][2])
+            for (int lsq_size = range[2][0]; lsq_size <= range[2][1]; lsq_size += range[2][2])
+                for (int prf_size = range[3][0]; prf_size <= range[3][1]; prf_size += range[3][2]){
+                    if (!sizes_valid(rob_size, iq_size, lsq_size, prf_size)){
+                        free(job.points);
+                        return 0;
+                    }
+                    sweep_point *point = &job.points[index++];
+                    point->sizes[0] = rob_size;
+                    point->sizes[1] = iq_size;
+                    point->sizes[2] = lsq_size;
+                    point->sizes[3] = prf_size;
+                }
+
+    if (threads < 1)
+        threads = 1;
+    if (threads > count)
+        threads = count;
+    pthread_t *workers = calloc(threads, sizeof(pthread_t));
+    int started = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (workers && started < threads && pthread_create(&workers[started], NULL, sweep_worker, &job) == 0)
+        started++;
+    if (started == 0)
+        sweep_worker(&job);
+    for (int i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("rob\tiq\tlsq\tprf\tcycles\tcommitted\tIPC\thalted\n");
+    for (int i = 0; i < count; i++){
+        sweep_point *point = &job.points[i];
+        if (!point->loaded){
+            printf("%d\t%d\t%d\t%d\t-\t-\t-\tunable to load %s\n", point->sizes[0], point->sizes[1],
+                   point->sizes[2], point->sizes[3], file_name);
+            continue;
+        }
+        printf("%d\t%d\t%d\t%d\t%d\t%ld\t%.3f\t%s\n", point->sizes[0], point->sizes[1],
+               point->sizes[2], point->sizes[3], point->cycles, point->committed,
+               point->cycles > 0 ? (double)point->committed / point->cycles : 0.0,
+               point->halted ? "yes" : "no");
+    }
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr, "\n Swept %d configurations on %d threads in %.3f s\n", count,
+            started ? started : 1, seconds);
+    free(workers);
+    free(job.points);
+    return 1;
+}
+
+void simulate(APEX_OOO_CPU *cpu, char file_name[])
 {
 
     printf("\n\t Enter the no. of clock cycles: ");
     int cycles = 0;
     scanf("%d", &cycles);
 
+    if (!load_program(cpu, file_name)){
+        printf("\n Unable to open %s", file_name);
+        return;
+    }
+    run_cycles(cpu, cycles);
+}
+
+//Appends the program in file_name to the code store of cpu, from its
+//cached object when that is up to date. Returns 0 if the file cannot be
+//read.
+int load_program(APEX_OOO_CPU *cpu, char file_name[])
+{
+    uint64_t source_hash = 0;
+    int have_hash = hash_file(file_name, &source_hash);
+    if (have_hash && load_object(cpu, file_name, source_hash))
+        return 1;
+
+    int first = cpu->program.size;
     FILE *ptr_File = fopen (file_name,"r");
+    if (!ptr_File)
+        return 0;
 
     char line[255];
 
     while( feof( ptr_File ) == 0)
     {
+        Instructions parsed;
+        Instructions *ptr_instruction = &parsed;
+        memset(&parsed, 0, sizeof(parsed));
 
         fgets (line, 255, ptr_File);
-        printf("\n%d", instr_line_Number);
-        printf("\t%s", line);
-        instr_line_Number++;
+        trace(TRACE_FULL, "\n%d", cpu->instr_line_Number);
+        trace(TRACE_FULL, "\t%s", line);
+        cpu->instr_line_Number++;
         sscanf(line,"%[^,]", ptr_instruction->opcode);
 
         if (!(strcmp(ptr_instruction->opcode, "MOVC"))){
             sscanf(line, "%[^,],R%d,#%d", ptr_instruction->opcode, &ptr_instruction->dest, &ptr_instruction->literal);
-            ptr_instruction->id = id;
-            id++;
-            printf("\t%s R%d %d", ptr_instruction->opcode, ptr_instruction->dest, ptr_instruction->literal);
+            ptr_instruction->id = cpu->id;
+            cpu->id++;
+            trace(TRACE_FULL, "\t%s R%d %d", ptr_instruction->opcode, ptr_instruction->dest, ptr_instruction->literal);
         }
         else if ((!(strcmp(ptr_instruction->opcode, "MUL")) || !(strcmp(ptr_instruction->opcode, "ADD")) || !(strcmp(ptr_instruction->opcode, "SUB")) || !(strcmp(ptr_instruction->opcode, "OR")) || !(strcmp(ptr_instruction->opcode, "AND")) || !(strcmp(ptr_instruction->opcode, "EX-OR")))){
             sscanf(line, "%[^,],R%d,R%d,R%d", ptr_instruction->opcode, &ptr_instruction->dest, &ptr_instruction->src1, &ptr_instruction->src2);
-            printf("\t%s R%d R%d R%d", ptr_instruction->opcode, ptr_instruction->dest, ptr_instruction->src1, ptr_instruction->src2);
-            ptr_instruction->id = id;
-            id++;
+            trace(TRACE_FULL, "\t%s R%d R%d R%d", ptr_instruction->opcode, ptr_instruction->dest, ptr_instruction->src1, ptr_instruction->src2);
+            ptr_instruction->id = cpu->id;
+            cpu->id++;
         }
         else if (!(strcmp(ptr_instruction->opcode, "ADDL"))){
             sscanf(line, "%[^,],R%d,R%d,#%d", ptr_instruction->opcode, &ptr_instruction->dest, &ptr_instruction->src1, &ptr_instruction->literal);
-            printf("\t%s R%d R%d %d", ptr_instruction->opcode, ptr_instruction->dest, ptr_instruction->src1, ptr_instruction->literal);
-            ptr_instruction->id = id;
-            id++;
+            trace(TRACE_FULL, "\t%s R%d R%d %d", ptr_instruction->opcode, ptr_instruction->dest, ptr_instruction->src1, ptr_instruction->literal);
+            ptr_instruction->id = cpu->id;
+            cpu->id++;
         }
         else if (!(strcmp(ptr_instruction->opcode, "SUBL"))){
             sscanf(line, "%[^,],R%d,R%d,#%d", ptr_instruction->opcode, &ptr_instruction->dest, &ptr_instruction->src1, &ptr_instruction->literal);
-            printf("\t%s R%d R%d %d", ptr_instruction->opcode, ptr_instruction->dest, ptr_instruction->src1, ptr_instruction->literal);
-            ptr_instruction->id = id;
-            id++;
+            trace(TRACE_FULL, "\t%s R%d R%d %d", ptr_instruction->opcode, ptr_instruction->dest, ptr_instruction->src1, ptr_instruction->literal);
+            ptr_instruction->id = cpu->id;
+            cpu->id++;
         }
         else if (!(strcmp(ptr_instruction->opcode, "LOAD"))){
             sscanf(line, "%[^,],R%d,R%d,#%d", ptr_instruction->opcode, &ptr_instruction->dest, &ptr_instruction->src1, &ptr_instruction->literal);
-            printf("\t%s R%d R%d %d", ptr_instruction->opcode, ptr_instruction->dest, ptr_instruction->src1, ptr_instruction->literal);
-            ptr_instruction->id = id;
-            id++;
+            trace(TRACE_FULL, "\t%s R%d R%d %d", ptr_instruction->opcode, ptr_instruction->dest, ptr_instruction->src1, ptr_instruction->literal);
+            ptr_instruction->id = cpu->id;
+            cpu->id++;
         }
         else if (!(strcmp(ptr_instruction->opcode, "STORE"))){
             sscanf(line, "%[^,],R%d,R%d,#%d", ptr_instruction->opcode, &ptr_instruction->src1, &ptr_instruction->src2, &ptr_instruction->literal);
-            printf("\t%s R%d R%d %d", ptr_instruction->opcode, ptr_instruction->dest, ptr_instruction->src1, ptr_instruction->literal);
-            ptr_instruction->id = id;
-            id++;
+            trace(TRACE_FULL, "\t%s R%d R%d %d", ptr_instruction->opcode, ptr_instruction->dest, ptr_instruction->src1, ptr_instruction->literal);
+            ptr_instruction->id = cpu->id;
+            cpu->id++;
         }
         else if (!(strcmp(ptr_instruction->opcode, "HALT"))){
             sscanf(line, "%[^,]", ptr_instruction->opcode);
-            printf("\t%s", ptr_instruction->opcode);
-            ptr_instruction->id = id;
-            id++;
+            trace(TRACE_FULL, "\t%s", ptr_instruction->opcode);
+            ptr_instruction->id = cpu->id;
+            cpu->id++;
             ptr_instruction->dest = -1;
         }
         else if (!(strcmp(ptr_instruction->opcode, "JUMP"))){
             sscanf(line, "%[^,],R%d,#%d", ptr_instruction->opcode, &ptr_instruction->src1, &ptr_instruction->literal);
-            printf("\t%s R%d %d", ptr_instruction->opcode, ptr_instruction->src1, ptr_instruction->literal);
-            ptr_instruction->id = id;
-            id++;
+            trace(TRACE_FULL, "\t%s R%d %d", ptr_instruction->opcode, ptr_instruction->src1, ptr_instruction->literal);
+            ptr_instruction->id = cpu->id;
+            cpu->id++;
             ptr_instruction->dest = -1;
         }
         else if (!(strcmp(ptr_instruction->opcode, "BZ"))){
             sscanf(line, "%[^,],#%d", ptr_instruction->opcode, &ptr_instruction->literal);
-            printf("\t%s %d", ptr_instruction->opcode, ptr_instruction->literal);
-            ptr_instruction->id = id;
-            id++;
+            trace(TRACE_FULL, "\t%s %d", ptr_instruction->opcode, ptr_instruction->literal);
+            ptr_instruction->id = cpu->id;
+            cpu->id++;
             ptr_instruction->dest = -1;
         }
         else{
-         printf("\t%s", "Not a valid opcode");
+         trace(TRACE_FULL, "\t%s", "Not a valid opcode");
        }
-       ptr_instruction++;
+       code_store_append(cpu, ptr_instruction);
 
     }
 
     fclose(ptr_File);
-    for (int i = 1; i <= cycles; i++)
-    {
-        printf("\n--------------------------Cycle No. = %d-------------------------", i);
-        ROB();
-        ROB();
+    if (have_hash)
+        save_object(cpu, file_name, source_hash, first, cpu->program.size - first);
+    return 1;
+}
+
+//Simulates up to cycles cycles of the loaded program, from wherever the
+//last run or restored checkpoint left off
+void run_cycles(APEX_OOO_CPU *cpu, int cycles)
+{
+    struct timespec start, end;
 
-        if (mflag == 1)
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int simulated = simulate_cycles(cpu, cycles);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr, "\n Simulated %d cycles in %.3f s, %.0f cycles/sec\n",
+            simulated, seconds, seconds > 0 ? simulated / seconds : 0.0);
+}
+
+//Simulates up to cycles cycles, stopping early once HALT commits. Returns
+//the cycles simulated.
+int simulate_cycles(APEX_OOO_CPU *cpu, int cycles)
+{
+    int i;
+    for (i = 1; i <= cycles; i++)
+    {
+        cpu->cycle++;
+        trace(TRACE_COMMIT, "\n--------------------------Cycle No. = %d-------------------------", cpu->cycle);
+        long committed = cpu->committed;
+        ROB(cpu);
+        ROB(cpu);
+        if (cpu->committed != committed)
+            cpu->last_commit_cycle = cpu->cycle;
+
+        if (cpu->mflag == 1)
         {
-            mul3();
-            mul2();
-            mul1();
-        }
-        bz_fu();
-        INT2_FU_STAG();
-        INT1_FU_STAGE();
-        iq();
-        iq();
-        memory();
-        LSQ();
-        DECODE_RF_STAGE();
-        FETCH_STAGE();
-        if (hflag == 100)
+            mul3(cpu);
+            mul2(cpu);
+            mul1(cpu);
+        }
+        bz_fu(cpu);
+        INT2_FU_STAG(cpu);
+        INT1_FU_STAGE(cpu);
+        iq(cpu);
+        iq(cpu);
+        memory(cpu);
+        LSQ(cpu);
+        DECODE_RF_STAGE(cpu);
+        FETCH_STAGE(cpu);
+        if (cpu->hflag == 100)
             break;
     }
+    return (i > cycles) ? cycles : i;
 }
 
 
-void FETCH_STAGE(){
-  if((pc <= instr_line_Number) && hflag == 0 && bzflag == 0 && jflag == 0)
+void FETCH_STAGE(APEX_OOO_CPU *cpu){
+  if((cpu->pc <= cpu->instr_line_Number) && cpu->hflag == 0 && cpu->bzflag == 0 && cpu->jflag == 0)
   {
-    fetch_input = instruction[pc];
-    if (!(strcmp(fetch_input.opcode, "MOVC")))
+    cpu->fetch_input = code_store_fetch(cpu, cpu->pc);
+    if (!(strcmp(cpu->fetch_input.opcode, "MOVC")))
     {
-        if(!(strcmp(decode_input.opcode, "nop")))
+        if(!(strcmp(cpu->decode_input.opcode, "nop")))
         {
-            if (bflag == 0)
+            if (cpu->bflag == 0)
             {
-                printf("\n Instruction at FETCH_STAGE ---> \t %s R%d %d", fetch_input.opcode, fetch_input.dest, fetch_input.literal);
-                decode_input = fetch_input;
-                fetch_input = nop;
-                pc++;
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t %s R%d %d", cpu->fetch_input.opcode, cpu->fetch_input.dest, cpu->fetch_input.literal);
+                cpu->decode_input = cpu->fetch_input;
+                cpu->fetch_input = nop;
+                cpu->pc++;
             }
             else{
-                bflag = 0;
-                printf("\n FETCH_STAGE : \t\t idle");
+                cpu->bflag = 0;
+                trace(TRACE_STAGE, "\n FETCH_STAGE : \t\t idle");
             }
         }
         else{
-            printf("\n Instruction at FETCH_STAGE ---> \t %s R%d %d stalled", fetch_input.opcode, fetch_input.dest, fetch_input.literal);
+            trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t %s R%d %d stalled", cpu->fetch_input.opcode, cpu->fetch_input.dest, cpu->fetch_input.literal);
         }
     }
-    else if (!(strcmp(fetch_input.opcode, "ADD")))
+    else if (!(strcmp(cpu->fetch_input.opcode, "ADD")))
     {
-        if(!(strcmp(decode_input.opcode, "nop")))
+        if(!(strcmp(cpu->decode_input.opcode, "nop")))
         {
-            if (bflag == 0)
+            if (cpu->bflag == 0)
             {
-                printf("\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d ", fetch_input.opcode, fetch_input.dest, fetch_input.src1,fetch_input.src2);
-                decode_input = fetch_input;
-                fetch_input = nop;
-                pc++;
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d ", cpu->fetch_input.opcode, cpu->fetch_input.dest, cpu->fetch_input.src1,cpu->fetch_input.src2);
+                cpu->decode_input = cpu->fetch_input;
+                cpu->fetch_input = nop;
+                cpu->pc++;
             }
             else{
-                bflag = 0;
-                printf("\n FETCH_STAGE : \t\t idle");
+                cpu->bflag = 0;
+                trace(TRACE_STAGE, "\n FETCH_STAGE : \t\t idle");
             }
         }
         else{
-            printf("\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d stalled", fetch_input.opcode, fetch_input.dest, fetch_input.src1,fetch_input.src2);
+            trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d stalled", cpu->fetch_input.opcode, cpu->fetch_input.dest, cpu->fetch_input.src1,cpu->fetch_input.src2);
         }
     }
-    else if (!(strcmp(fetch_input.opcode, "SUB")))
+    else if (!(strcmp(cpu->fetch_input.opcode, "SUB")))
     {
-        if(!(strcmp(decode_input.opcode, "nop")))
+        if(!(strcmp(cpu->decode_input.opcode, "nop")))
         {
-            if (bflag == 0)
+            if (cpu->bflag == 0)
             {
-                printf("\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d", fetch_input.opcode, fetch_input.dest, fetch_input.src1,fetch_input.src2);
-                decode_input = fetch_input;
-                fetch_input = nop;
-                pc++;
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d", cpu->fetch_input.opcode, cpu->fetch_input.dest, cpu->fetch_input.src1,cpu->fetch_input.src2);
+                cpu->decode_input = cpu->fetch_input;
+                cpu->fetch_input = nop;
+                cpu->pc++;
             }
             else{
-                bflag = 0;
-                printf("\n FETCH_STAGE : \t\t idle");
+                cpu->bflag = 0;
+                trace(TRACE_STAGE, "\n FETCH_STAGE : \t\t idle");
             }
         }
         else{
-            printf("\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d stalled", fetch_input.opcode, fetch_input.dest, fetch_input.src1,fetch_input.src2);
+            trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d stalled", cpu->fetch_input.opcode, cpu->fetch_input.dest, cpu->fetch_input.src1,cpu->fetch_input.src2);
         }
     }
-    else if (!(strcmp(fetch_input.opcode, "AND")))
+    else if (!(strcmp(cpu->fetch_input.opcode, "AND")))
     {
-        if(!(strcmp(decode_input.opcode, "nop")))
+        if(!(strcmp(cpu->decode_input.opcode, "nop")))
         {
-            if (bflag == 0)
+            if (cpu->bflag == 0)
             {
-                printf("\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d", fetch_input.opcode, fetch_input.dest, fetch_input.src1,fetch_input.src2);
-                decode_input = fetch_input;
-                fetch_input = nop;
-                pc++;
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d", cpu->fetch_input.opcode, cpu->fetch_input.dest, cpu->fetch_input.src1,cpu->fetch_input.src2);
+                cpu->decode_input = cpu->fetch_input;
+                cpu->fetch_input = nop;
+                cpu->pc++;
             }
             else{
-                bflag = 0;
-                printf("\n FETCH_STAGE : \t\t idle");
+                cpu->bflag = 0;
+                trace(TRACE_STAGE, "\n FETCH_STAGE : \t\t idle");
             }
         }
         else{
-            printf("\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d stalled", fetch_input.opcode, fetch_input.dest, fetch_input.src1,fetch_input.src2);
+            trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d stalled", cpu->fetch_input.opcode, cpu->fetch_input.dest, cpu->fetch_input.src1,cpu->fetch_input.src2);
         }
     }
-    else if (!(strcmp(fetch_input.opcode, "MUL")))
+    else if (!(strcmp(cpu->fetch_input.opcode, "MUL")))
     {
 
       //printf("i am in multiplication n" );
-        if(!(strcmp(decode_input.opcode, "nop")))
+        if(!(strcmp(cpu->decode_input.opcode, "nop")))
         {
-            if (bflag == 0)
+            if (cpu->bflag == 0)
             {
-                printf("\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d ", fetch_input.opcode, fetch_input.dest, fetch_input.src1,fetch_input.src2);
-                decode_input = fetch_input;
-                fetch_input = nop;
-                pc++;
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d ", cpu->fetch_input.opcode, cpu->fetch_input.dest, cpu->fetch_input.src1,cpu->fetch_input.src2);
+                cpu->decode_input = cpu->fetch_input;
+                cpu->fetch_input = nop;
+                cpu->pc++;
             }
             else{
-                bflag = 0;
-                printf("\n FETCH_STAGE : \t\t idle");
+                cpu->bflag = 0;
+                trace(TRACE_STAGE, "\n FETCH_STAGE : \t\t idle");
             }
         }
         else{
-            printf("\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d stalled", fetch_input.opcode, fetch_input.dest, fetch_input.src1,fetch_input.src2);
+            trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d stalled", cpu->fetch_input.opcode, cpu->fetch_input.dest, cpu->fetch_input.src1,cpu->fetch_input.src2);
         }
     }
-    else if (!(strcmp(fetch_input.opcode, "LOAD")))
+    else if (!(strcmp(cpu->fetch_input.opcode, "LOAD")))
     {
-        if(!(strcmp(decode_input.opcode, "nop"))){
-            if (bflag == 0){
-                printf("\n Instruction at FETCH_STAGE ---> \t\t %s R%d R%d %d", fetch_input.opcode, fetch_input.dest, fetch_input.src1, fetch_input.literal);
-                pc++;
-                decode_input = fetch_input;
-                fetch_input = nop;
+        if(!(strcmp(cpu->decode_input.opcode, "nop"))){
+            if (cpu->bflag == 0){
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t\t %s R%d R%d %d", cpu->fetch_input.opcode, cpu->fetch_input.dest, cpu->fetch_input.src1, cpu->fetch_input.literal);
+                cpu->pc++;
+                cpu->decode_input = cpu->fetch_input;
+                cpu->fetch_input = nop;
             }
             else{
-                bflag = 0;
-                printf("\n Instruction at FETCH_STAGE --->: \t\t idle");
+                cpu->bflag = 0;
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE --->: \t\t idle");
             }
         }
         else{
-            printf("\n Instruction at FETCH_STAGE ---> \t\t %s R%d R%d %d stalled", fetch_input.opcode, fetch_input.dest, fetch_input.src1, fetch_input.literal);
+            trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t\t %s R%d R%d %d stalled", cpu->fetch_input.opcode, cpu->fetch_input.dest, cpu->fetch_input.src1, cpu->fetch_input.literal);
         }
     }
-    else if (!(strcmp(fetch_input.opcode, "STORE")))
+    else if (!(strcmp(cpu->fetch_input.opcode, "STORE")))
     {
-        if(!(strcmp(decode_input.opcode, "nop"))){
-            if (bflag == 0){
-                printf("\n Instruction at FETCH_STAGE ---> \t %s R%d R%d %d", fetch_input.opcode, fetch_input.src1, fetch_input.src2, fetch_input.literal);
-                decode_input = fetch_input;
-                fetch_input = nop;
-                pc++;
+        if(!(strcmp(cpu->decode_input.opcode, "nop"))){
+            if (cpu->bflag == 0){
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t %s R%d R%d %d", cpu->fetch_input.opcode, cpu->fetch_input.src1, cpu->fetch_input.src2, cpu->fetch_input.literal);
+                cpu->decode_input = cpu->fetch_input;
+                cpu->fetch_input = nop;
+                cpu->pc++;
             }
             else{
-                bflag = 0;
-                printf("\n FInstruction at FETCH_STAGE ---> \t\t idle");
+                cpu->bflag = 0;
+                trace(TRACE_STAGE, "\n FInstruction at FETCH_STAGE ---> \t\t idle");
             }
         }
         else{
-            printf("\n Fetch stage : \t\t %s R%d R%d %d stalled", fetch_input.opcode, fetch_input.src1, fetch_input.src2, fetch_input.literal);
+            trace(TRACE_STAGE, "\n Fetch stage : \t\t %s R%d R%d %d stalled", cpu->fetch_input.opcode, cpu->fetch_input.src1, cpu->fetch_input.src2, cpu->fetch_input.literal);
         }
     }
-    else if (!(strcmp(fetch_input.opcode, "ADDL")))
+    else if (!(strcmp(cpu->fetch_input.opcode, "ADDL")))
     {
-        if(!(strcmp(decode_input.opcode, "nop"))){
-            if (bflag == 0){
-                printf("\n Instruction at FETCH_STAGE ---> \t %s R%d R%d %d", fetch_input.opcode, fetch_input.dest, fetch_input.src1, fetch_input.literal);
-                pc++;
-                decode_input = fetch_input;
-                fetch_input = nop;
+        if(!(strcmp(cpu->decode_input.opcode, "nop"))){
+            if (cpu->bflag == 0){
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t %s R%d R%d %d", cpu->fetch_input.opcode, cpu->fetch_input.dest, cpu->fetch_input.src1, cpu->fetch_input.literal);
+                cpu->pc++;
+                cpu->decode_input = cpu->fetch_input;
+                cpu->fetch_input = nop;
             }
             else{
-                bflag = 0;
-                printf("\n Instruction at FETCH_STAGE ---> \t\t idle");
+                cpu->bflag = 0;
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t\t idle");
             }
         }
         else{
-            printf("\n Instruction at FETCH_STAGE ---> \t %s R%d R%d %d stalled", fetch_input.opcode, fetch_input.dest, fetch_input.src1, fetch_input.literal);
+            trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t %s R%d R%d %d stalled", cpu->fetch_input.opcode, cpu->fetch_input.dest, cpu->fetch_input.src1, cpu->fetch_input.literal);
         }
     }
-    else if (!(strcmp(fetch_input.opcode, "SUBL")))
+    else if (!(strcmp(cpu->fetch_input.opcode, "SUBL")))
     {
-        if(!(strcmp(decode_input.opcode, "nop"))){
-            if (bflag == 0){
-                printf("\n Instruction at FETCH_STAGE ---> \t %s R%d R%d %d", fetch_input.opcode, fetch_input.dest, fetch_input.src1, fetch_input.literal);
-                pc++;
-                decode_input = fetch_input;
-                fetch_input = nop;
+        if(!(strcmp(cpu->decode_input.opcode, "nop"))){
+            if (cpu->bflag == 0){
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t %s R%d R%d %d", cpu->fetch_input.opcode, cpu->fetch_input.dest, cpu->fetch_input.src1, cpu->fetch_input.literal);
+                cpu->pc++;
+                cpu->decode_input = cpu->fetch_input;
+                cpu->fetch_input = nop;
             }
             else{
-                bflag = 0;
-                printf("\n Instruction at FETCH_STAGE --->: \t\t idle");
+                cpu->bflag = 0;
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE --->: \t\t idle");
             }
         }
         else{
-            printf("\n Instruction at FETCH_STAGE ---> \t %s R%d R%d %d stalled", fetch_input.opcode, fetch_input.dest, fetch_input.src1, fetch_input.literal);
+            trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t %s R%d R%d %d stalled", cpu->fetch_input.opcode, cpu->fetch_input.dest, cpu->fetch_input.src1, cpu->fetch_input.literal);
         }
     }
-    else if (!(strcmp(fetch_input.opcode, "OR")))
+    else if (!(strcmp(cpu->fetch_input.opcode, "OR")))
     {
-        if(!(strcmp(decode_input.opcode, "nop")))
+        if(!(strcmp(cpu->decode_input.opcode, "nop")))
         {
-            if (bflag == 0)
+            if (cpu->bflag == 0)
             {
-                printf("\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d", fetch_input.opcode, fetch_input.dest, fetch_input.src1,fetch_input.src2);
-                decode_input = fetch_input;
-                fetch_input = nop;
-                pc++;
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d", cpu->fetch_input.opcode, cpu->fetch_input.dest, cpu->fetch_input.src1,cpu->fetch_input.src2);
+                cpu->decode_input = cpu->fetch_input;
+                cpu->fetch_input = nop;
+                cpu->pc++;
             }
             else{
-                bflag = 0;
-                printf("\n Instruction at FETCH_STAGE ---> \t\t idle");
+                cpu->bflag = 0;
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t\t idle");
             }
         }
         else{
-            printf("\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d stalled", fetch_input.opcode, fetch_input.dest, fetch_input.src1,fetch_input.src2);
+            trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d stalled", cpu->fetch_input.opcode, cpu->fetch_input.dest, cpu->fetch_input.src1,cpu->fetch_input.src2);
         }
     }
-    else if (!(strcmp(fetch_input.opcode, "EX-OR")))
+    else if (!(strcmp(cpu->fetch_input.opcode, "EX-OR")))
     {
-        if(!(strcmp(decode_input.opcode, "nop")))
+        if(!(strcmp(cpu->decode_input.opcode, "nop")))
         {
-            if (bflag == 0)
+            if (cpu->bflag == 0)
             {
-                printf("\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d", fetch_input.opcode, fetch_input.dest, fetch_input.src1,fetch_input.src2);
-                decode_input = fetch_input;
-                fetch_input = nop;
-                pc++;
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d", cpu->fetch_input.opcode, cpu->fetch_input.dest, cpu->fetch_input.src1,cpu->fetch_input.src2);
+                cpu->decode_input = cpu->fetch_input;
+                cpu->fetch_input = nop;
+                cpu->pc++;
             }
             else{
-                bflag = 0;
-                printf("\n Instruction at FETCH_STAGE ---> \t\t idle");
+                cpu->bflag = 0;
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t\t idle");
             }
         }
         else{
-            printf("\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d stalled", fetch_input.opcode, fetch_input.dest, fetch_input.src1,fetch_input.src2);
+            trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t %s R%d R%d R%d stalled", cpu->fetch_input.opcode, cpu->fetch_input.dest, cpu->fetch_input.src1,cpu->fetch_input.src2);
         }
     }
-    else if (!(strcmp(fetch_input.opcode, "HALT")))
+    else if (!(strcmp(cpu->fetch_input.opcode, "HALT")))
     {
-        if(!(strcmp(decode_input.opcode, "nop"))){
-            if (bflag == 0){
-                printf("\n Instruction at FETCH_STAGE ---> \t\t %s", fetch_input.opcode);
-                decode_input = fetch_input;
-                fetch_input = nop;
-                pc++;
+        if(!(strcmp(cpu->decode_input.opcode, "nop"))){
+            if (cpu->bflag == 0){
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t\t %s", cpu->fetch_input.opcode);
+                cpu->decode_input = cpu->fetch_input;
+                cpu->fetch_input = nop;
+                cpu->pc++;
             }
             else{
-                bflag = 0;
-                printf("\n Instruction at FETCH_STAGE --->: \t\t idle");
+                cpu->bflag = 0;
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE --->: \t\t idle");
             }
         }
 
         else{
-            printf("\n Instruction at FETCH_STAGE --->: \t\t %s stalled", fetch_input.opcode);
+            trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE --->: \t\t %s stalled", cpu->fetch_input.opcode);
         }
     }
-    else if (!(strcmp(fetch_input.opcode, "JUMP")))
+    else if (!(strcmp(cpu->fetch_input.opcode, "JUMP")))
     {
 
-        if(!(strcmp(decode_input.opcode, "nop"))){
-            if (bflag == 0){
-                printf("\n Instruction at FETCH_STAGE ---> \t\t %s R%d %d", fetch_input.opcode, fetch_input.src1, fetch_input.literal);
-                decode_input = fetch_input;
-                fetch_input = nop;
-                pc++;
+        if(!(strcmp(cpu->decode_input.opcode, "nop"))){
+            if (cpu->bflag == 0){
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t\t %s R%d %d", cpu->fetch_input.opcode, cpu->fetch_input.src1, cpu->fetch_input.literal);
+                cpu->decode_input = cpu->fetch_input;
+                cpu->fetch_input = nop;
+                cpu->pc++;
             }
             else{
-                bflag = 0;
-                printf("\n Instruction at FETCH_STAGE ---> \t\t idle");
+                cpu->bflag = 0;
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t\t idle");
             }
         }
         else{
-            printf("\n Instruction at FETCH_STAGE --->: \t\t %s R%d %d stalled", fetch_input.opcode, fetch_input.src1, fetch_input.literal);
+            trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE --->: \t\t %s R%d %d stalled", cpu->fetch_input.opcode, cpu->fetch_input.src1, cpu->fetch_input.literal);
         }
     }
-    else if (!(strcmp(fetch_input.opcode, "BZ")))
+    else if (!(strcmp(cpu->fetch_input.opcode, "BZ")))
     {
-        if(!(strcmp(decode_input.opcode, "nop"))){
-            if (bflag == 0){
-                printf("\n Instruction at FETCH_STAGE ---> \t\t %s %d", fetch_input.opcode, fetch_input.literal);
-                fetch_input.index = pc;
-                decode_input = fetch_input;
-                fetch_input = nop;
-                pc++;
+        if(!(strcmp(cpu->decode_input.opcode, "nop"))){
+            if (cpu->bflag == 0){
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t\t %s %d", cpu->fetch_input.opcode, cpu->fetch_input.literal);
+                cpu->fetch_input.index = cpu->pc;
+                cpu->decode_input = cpu->fetch_input;
+                cpu->fetch_input = nop;
+                cpu->pc++;
             }
             else{
-                bflag = 0;
-                printf("\n Instruction at FETCH_STAGE ---> \t\t idle");
+                cpu->bflag = 0;
+                trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t\t idle");
             }
         }
         else{
-            printf("\n Instruction at FETCH_STAGE ---> \t %s %d stalled", fetch_input.opcode, fetch_input.literal);
+            trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t %s %d stalled", cpu->fetch_input.opcode, cpu->fetch_input.literal);
         }
     }
 
   }
     else
-    printf("\n Instruction at FETCH_STAGE ---> \t\t idle");
+    trace(TRACE_STAGE, "\n Instruction at FETCH_STAGE ---> \t\t idle");
 }
 
-void DECODE_RF_STAGE(){
+void DECODE_RF_STAGE(APEX_OOO_CPU *cpu){
     int dest = -1;
 
-  if((strcmp(decode_input.opcode, "nop")))
+  if((strcmp(cpu->decode_input.opcode, "nop")))
   {
-    if (!(strcmp(decode_input.opcode, "MOVC")))
+    if (!(strcmp(cpu->decode_input.opcode, "MOVC")))
     {
-        if(prf_available() == 1 && iq_full_index == 0 && rob_full_index == 0)
+        if(prf_available(cpu) == 1 && cpu->iq_full_index == 0 && cpu->rob_full_index == 0)
         {
-          printf("\n Instruction at DECODE_RF_STAGE --->  \t %s R%d %d", decode_input.opcode, decode_input.dest, decode_input.literal);
-
-          rob[rob_add_index] = decode_input;
-          rob_add_index++;
+          trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE --->  \t %s R%d %d", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.literal);
 
-          dummy1 = decode_input.dest;
-          old_instance_prf(decode_input.dest);
-          dest = find_new_prf();
-          decode_input.dest = dest;
-          physical_Reg_File[dest].status = INVALID;
-          physical_Reg_File[dest].ins_id = decode_input.id;         // for later use in rob, iq
-          physical_Reg_File[dest].busy = 1;                   // make 0 in rob when the inst id of prf mathces the index of instruction being commited
-          physical_Reg_File[dest].arf_id = dummy1;
+          cpu->dummy1 = cpu->decode_input.dest;
+          dest = rename_dest(cpu, cpu->dummy1, cpu->decode_input.id);
+          cpu->decode_input.dest = dest;
+          cpu->decode_input.phys_dest = dest;
 
-          printf("\n Details of RENAME TABLE State --> \t %s P%d %d", decode_input.opcode, decode_input.dest, decode_input.literal);
+          trace(TRACE_STAGE, "\n Details of RENAME TABLE State --> \t %s P%d %d", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.literal);
           //printf("\n stat %d ins_id %d busy %d arf_id %d\n", physical_Reg_File[dest].status, physical_Reg_File[dest].ins_id, physical_Reg_File[dest].busy, physical_Reg_File[dest].arf_id );
 
-          iqueue[iq_add_index] = decode_input;
-          decode_input = nop;
-          iq_add_index++;                               // can instead use in IQUEUE function
+          cpu->rob[cpu->rob_add_index] = cpu->decode_input;
+          cpu->rob[cpu->rob_add_index].dest = cpu->dummy1;
+          cpu->rob_add_index++;
+
+          cpu->iqueue[cpu->iq_add_index] = cpu->decode_input;
+          cpu->decode_input = nop;
+          cpu->iq_add_index++;                               // can instead use in IQUEUE function
         }
         else
-            printf("\n Instruction at DECODE_RF_STAGE --->  \t %s R%d %d stalled", decode_input.opcode, decode_input.dest, decode_input.literal);
+            trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE --->  \t %s R%d %d stalled", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.literal);
     }
-    else if (!(strcmp(decode_input.opcode, "ADD")))
+    else if (!(strcmp(cpu->decode_input.opcode, "ADD")))
     {
-        if(prf_available() == 1 && iq_full_index == 0 && rob_full_index == 0)
+        if(prf_available(cpu) == 1 && cpu->iq_full_index == 0 && cpu->rob_full_index == 0)
         {
-          printf("\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d", decode_input.opcode, decode_input.dest, decode_input.src1,decode_input.src2);
+          trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1,cpu->decode_input.src2);
 
-          decode_input.src1 = find_existing_prf(decode_input.src1, decode_input.id);
-          decode_input.src2 = find_existing_prf(decode_input.src2, decode_input.id);
+          cpu->decode_input.src1 = rename_source(cpu, cpu->decode_input.src1, cpu->decode_input.id);
+          cpu->decode_input.src2 = rename_source(cpu, cpu->decode_input.src2, cpu->decode_input.id);
 
-          dummy1 = decode_input.dest;
-          old_instance_prf(decode_input.dest);
-          dest = find_new_prf();
-          decode_input.dest = dest;
-          physical_Reg_File[dest].status = INVALID;
-          physical_Reg_File[dest].ins_id = decode_input.id;         // for later use in rob, iq
-          physical_Reg_File[dest].busy = 1;                   // make 0 in rob when the inst id of prf mathces the index of instruction being commited
-          physical_Reg_File[dest].arf_id = dummy1;
+          cpu->dummy1 = cpu->decode_input.dest;
+          dest = rename_dest(cpu, cpu->dummy1, cpu->decode_input.id);
+          cpu->decode_input.dest = dest;
+          cpu->decode_input.phys_dest = dest;
 
-          printf("\n Details of RENAME TABLE State --> \t %s P%d P%d P%d", decode_input.opcode, decode_input.dest, decode_input.src1,decode_input.src2);
+          trace(TRACE_STAGE, "\n Details of RENAME TABLE State --> \t %s P%d P%d P%d", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1,cpu->decode_input.src2);
           //printf("\n stat %d ins_id %d busy %d arf_id %d\n", physical_Reg_File[dest].status, physical_Reg_File[dest].ins_id, physical_Reg_File[dest].busy, physical_Reg_File[dest].arf_id );
 
-          rob[rob_add_index] = decode_input;
-          rob[rob_add_index].dest = dummy1;
-          rob_add_index++;
+          cpu->rob[cpu->rob_add_index] = cpu->decode_input;
+          cpu->rob[cpu->rob_add_index].dest = cpu->dummy1;
+          cpu->rob_add_index++;
 
-          iqueue[iq_add_index] = decode_input;
-          decode_input = nop;
-          iq_add_index++;                               // can instead use in IQUEUE function
+          cpu->iqueue[cpu->iq_add_index] = cpu->decode_input;
+          cpu->decode_input = nop;
+          cpu->iq_add_index++;                               // can instead use in IQUEUE function
         }
         else
-            printf("\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d stalled", decode_input.opcode, decode_input.dest, decode_input.src1,decode_input.src2);
+            trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d stalled", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1,cpu->decode_input.src2);
     }
-    else if (!(strcmp(decode_input.opcode, "SUB")))
+    else if (!(strcmp(cpu->decode_input.opcode, "SUB")))
     {
-        if(prf_available() == 1 && iq_full_index == 0 && rob_full_index == 0)
+        if(prf_available(cpu) == 1 && cpu->iq_full_index == 0 && cpu->rob_full_index == 0)
         {
-          printf("\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d", decode_input.opcode, decode_input.dest, decode_input.src1,decode_input.src2);
+          trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1,cpu->decode_input.src2);
 
-          decode_input.src1 = find_existing_prf(decode_input.src1, decode_input.id);
-          decode_input.src2 = find_existing_prf(decode_input.src2, decode_input.id);
+          cpu->decode_input.src1 = rename_source(cpu, cpu->decode_input.src1, cpu->decode_input.id);
+          cpu->decode_input.src2 = rename_source(cpu, cpu->decode_input.src2, cpu->decode_input.id);
 
-          dummy1 = decode_input.dest;
-          old_instance_prf(decode_input.dest);
-          dest = find_new_prf();
-          decode_input.dest = dest;
-          physical_Reg_File[dest].status = INVALID;
-          physical_Reg_File[dest].ins_id = decode_input.id;         // for later use in rob, iq
-          physical_Reg_File[dest].busy = 1;                   // make 0 in rob when the inst id of prf mathces the index of instruction being commited
-          physical_Reg_File[dest].arf_id = dummy1;
+          cpu->dummy1 = cpu->decode_input.dest;
+          dest = rename_dest(cpu, cpu->dummy1, cpu->decode_input.id);
+          cpu->decode_input.dest = dest;
+          cpu->decode_input.phys_dest = dest;
 
-          printf("\n Details of RENAME TABLE State --> \t %s P%d P%d P%d", decode_input.opcode, decode_input.dest, decode_input.src1,decode_input.src2);
+          trace(TRACE_STAGE, "\n Details of RENAME TABLE State --> \t %s P%d P%d P%d", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1,cpu->decode_input.src2);
           //printf("\n stat %d ins_id %d busy %d arf_id %d\n", physical_Reg_File[dest].status, physical_Reg_File[dest].ins_id, physical_Reg_File[dest].busy, physical_Reg_File[dest].arf_id );
 
-          rob[rob_add_index] = decode_input;
-          rob[rob_add_index].dest = dummy1;
-          rob_add_index++;
+          cpu->rob[cpu->rob_add_index] = cpu->decode_input;
+          cpu->rob[cpu->rob_add_index].dest = cpu->dummy1;
+          cpu->rob_add_index++;
 
-          iqueue[iq_add_index] = decode_input;
-          decode_input = nop;
-          iq_add_index++;                               // can instead use in IQUEUE function
+          cpu->iqueue[cpu->iq_add_index] = cpu->decode_input;
+          cpu->decode_input = nop;
+          cpu->iq_add_index++;                               // can instead use in IQUEUE function
         }
         else
-            printf("\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d stalled", decode_input.opcode, decode_input.dest, decode_input.src1,decode_input.src2);
+            trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d stalled", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1,cpu->decode_input.src2);
     }
-    else if (!(strcmp(decode_input.opcode, "AND")))
+    else if (!(strcmp(cpu->decode_input.opcode, "AND")))
     {
-        if(prf_available() == 1 && iq_full_index == 0 && rob_full_index == 0)
+        if(prf_available(cpu) == 1 && cpu->iq_full_index == 0 && cpu->rob_full_index == 0)
         {
-          printf("\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d", decode_input.opcode, decode_input.dest, decode_input.src1,decode_input.src2);
+          trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1,cpu->decode_input.src2);
 
-          decode_input.src1 = find_existing_prf(decode_input.src1, decode_input.id);
-          decode_input.src2 = find_existing_prf(decode_input.src2, decode_input.id);
+          cpu->decode_input.src1 = rename_source(cpu, cpu->decode_input.src1, cpu->decode_input.id);
+          cpu->decode_input.src2 = rename_source(cpu, cpu->decode_input.src2, cpu->decode_input.id);
 
-          dummy1 = decode_input.dest;
-          old_instance_prf(decode_input.dest);
-          dest = find_new_prf();
-          decode_input.dest = dest;
-          physical_Reg_File[dest].status = INVALID;
-          physical_Reg_File[dest].ins_id = decode_input.id;         // for later use in rob, iq
-          physical_Reg_File[dest].busy = 1;                   // make 0 in rob when the inst id of prf mathces the index of instruction being commited
-          physical_Reg_File[dest].arf_id = dummy1;
+          cpu->dummy1 = cpu->decode_input.dest;
+          dest = rename_dest(cpu, cpu->dummy1, cpu->decode_input.id);
+          cpu->decode_input.dest = dest;
+          cpu->decode_input.phys_dest = dest;
 
-          printf("\n Details of RENAME TABLE State --> \t %s P%d P%d P%d", decode_input.opcode, decode_input.dest, decode_input.src1,decode_input.src2);
+          trace(TRACE_STAGE, "\n Details of RENAME TABLE State --> \t %s P%d P%d P%d", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1,cpu->decode_input.src2);
           //printf("\n stat %d ins_id %d busy %d arf_id %d\n", physical_Reg_File[dest].status, physical_Reg_File[dest].ins_id, physical_Reg_File[dest].busy, physical_Reg_File[dest].arf_id );
 
-          rob[rob_add_index] = decode_input;
-          rob[rob_add_index].dest = dummy1;
-          rob_add_index++;
+          cpu->rob[cpu->rob_add_index] = cpu->decode_input;
+          cpu->rob[cpu->rob_add_index].dest = cpu->dummy1;
+          cpu->rob_add_index++;
 
-          iqueue[iq_add_index] = decode_input;
-          decode_input = nop;
-          iq_add_index++;                               // can instead use in IQUEUE function
+          cpu->iqueue[cpu->iq_add_index] = cpu->decode_input;
+          cpu->decode_input = nop;
+          cpu->iq_add_index++;                               // can instead use in IQUEUE function
         }
         else
-            printf("\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d stalled", decode_input.opcode, decode_input.dest, decode_input.src1,decode_input.src2);
+            trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d stalled", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1,cpu->decode_input.src2);
     }
-    else if (!(strcmp(decode_input.opcode, "MUL")))
+    else if (!(strcmp(cpu->decode_input.opcode, "MUL")))
     {
 
-        if(prf_available() == 1 && iq_full_index == 0 && rob_full_index == 0)
+        if(prf_available(cpu) == 1 && cpu->iq_full_index == 0 && cpu->rob_full_index == 0)
         {
 
-          printf("\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d", decode_input.opcode, decode_input.dest, decode_input.src1,decode_input.src2);
+          trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1,cpu->decode_input.src2);
 
-          decode_input.src1 = find_existing_prf(decode_input.src1, decode_input.id);
-          decode_input.src2 = find_existing_prf(decode_input.src2, decode_input.id);
+          cpu->decode_input.src1 = rename_source(cpu, cpu->decode_input.src1, cpu->decode_input.id);
+          cpu->decode_input.src2 = rename_source(cpu, cpu->decode_input.src2, cpu->decode_input.id);
           //printf("I am decode MUL %d %d\n", decode_input.src1, decode_input.src2);
-          dummy1 = decode_input.dest;
-          old_instance_prf(decode_input.dest);
-          dest = find_new_prf();
-          decode_input.dest = dest;
-          physical_Reg_File[dest].status = INVALID;
-          physical_Reg_File[dest].ins_id = decode_input.id;         // for later use in rob, iq
-          physical_Reg_File[dest].busy = 1;                   // make 0 in rob when the inst id of prf mathces the index of instruction being commited
-          physical_Reg_File[dest].arf_id = dummy1;
-
-          printf("\n Details of RENAME TABLE State --> \t %s P%d P%d P%d", decode_input.opcode, decode_input.dest, decode_input.src1,decode_input.src2);
+          cpu->dummy1 = cpu->decode_input.dest;
+          dest = rename_dest(cpu, cpu->dummy1, cpu->decode_input.id);
+          cpu->decode_input.dest = dest;
+          cpu->decode_input.phys_dest = dest;
+
+          trace(TRACE_STAGE, "\n Details of RENAME TABLE State --> \t %s P%d P%d P%d", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1,cpu->decode_input.src2);
           //printf("\n stat %d ins_id %d busy %d arf_id %d\n", physical_Reg_File[dest].status, physical_Reg_File[dest].ins_id, physical_Reg_File[dest].busy, physical_Reg_File[dest].arf_id );
 
-          rob[rob_add_index] = decode_input;
-          rob[rob_add_index].dest = dummy1;
-          rob_add_index++;
+          cpu->rob[cpu->rob_add_index] = cpu->decode_input;
+          cpu->rob[cpu->rob_add_index].dest = cpu->dummy1;
+          cpu->rob_add_index++;
 
-          iqueue[iq_add_index] = decode_input;
-          decode_input = nop;
-          iq_add_index++;                               // can instead use in IQUEUE function
+          cpu->iqueue[cpu->iq_add_index] = cpu->decode_input;
+          cpu->decode_input = nop;
+          cpu->iq_add_index++;                               // can instead use in IQUEUE function
         }
         else
-            printf("\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d stalled", decode_input.opcode, decode_input.dest, decode_input.src1,decode_input.src2);
+            trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d stalled", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1,cpu->decode_input.src2);
     }
-    else if (!(strcmp(decode_input.opcode, "LOAD")))
+    else if (!(strcmp(cpu->decode_input.opcode, "LOAD")))
     {
-            if(prf_available() == 1 && iq_full_index == 0 && rob_full_index == 0 && lsq_full_index == 0){
-                printf("\n Instruction at DECODE_RF_STAGE ---> \t %s R%d R%d %d", decode_input.opcode, decode_input.dest, decode_input.src1, decode_input.literal);
+            if(prf_available(cpu) == 1 && cpu->iq_full_index == 0 && cpu->rob_full_index == 0 && cpu->lsq_full_index == 0){
+                trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE ---> \t %s R%d R%d %d", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1, cpu->decode_input.literal);
 
-                decode_input.src1 = find_existing_prf(decode_input.src1, decode_input.id);
+                cpu->decode_input.src1 = rename_source(cpu, cpu->decode_input.src1, cpu->decode_input.id);
 
-                dummy1 = decode_input.dest;
-                old_instance_prf(decode_input.dest);
-                dest = find_new_prf();
-                decode_input.dest = dest;
-                physical_Reg_File[dest].status = INVALID;
-                physical_Reg_File[dest].ins_id = decode_input.id;
-                physical_Reg_File[dest].busy = 1;
-                physical_Reg_File[dest].arf_id = dummy1;
+                cpu->dummy1 = cpu->decode_input.dest;
+                dest = rename_dest(cpu, cpu->dummy1, cpu->decode_input.id);
+                cpu->decode_input.dest = dest;
+                cpu->decode_input.phys_dest = dest;
 
-                printf("\n Details of RENAME TABLE State --> \t %s P%d P%d %d", decode_input.opcode, decode_input.dest, decode_input.src1, decode_input.literal);
+                trace(TRACE_STAGE, "\n Details of RENAME TABLE State --> \t %s P%d P%d %d", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1, cpu->decode_input.literal);
 
-                rob[rob_add_index] = decode_input;
-                rob[rob_add_index].dest = dummy1;
-                rob_add_index++;
+                cpu->rob[cpu->rob_add_index] = cpu->decode_input;
+                cpu->rob[cpu->rob_add_index].dest = cpu->dummy1;
+                cpu->rob_add_index++;
 
-                lsq[lsq_add_index] = decode_input;
-                lsq_add_index++;
+                cpu->lsq[cpu->lsq_add_index] = cpu->decode_input;
+                cpu->lsq_add_index++;
 
-                iqueue[iq_add_index] = decode_input;
-                decode_input = nop;
-                iq_add_index++;
+                cpu->iqueue[cpu->iq_add_index] = cpu->decode_input;
+                cpu->decode_input = nop;
+                cpu->iq_add_index++;
             }
             else
-                printf("\n Instruction at DECODE_RF_STAGE ---> \t %s R%d R%d %d stalled", decode_input.opcode, decode_input.dest, decode_input.src1, decode_input.literal);
+                trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE ---> \t %s R%d R%d %d stalled", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1, cpu->decode_input.literal);
     }
-    else if (!(strcmp(decode_input.opcode, "STORE")))
+    else if (!(strcmp(cpu->decode_input.opcode, "STORE")))
     {
-            if(iq_full_index == 0 && rob_full_index == 0 && lsq_full_index == 0){
-                printf("\n Instruction at DECODE_RF_STAGE ---> \t %s R%d R%d %d", decode_input.opcode, decode_input.src1, decode_input.src2, decode_input.literal);
+            if(cpu->iq_full_index == 0 && cpu->rob_full_index == 0 && cpu->lsq_full_index == 0){
+                trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE ---> \t %s R%d R%d %d", cpu->decode_input.opcode, cpu->decode_input.src1, cpu->decode_input.src2, cpu->decode_input.literal);
 
-                decode_input.src1 = find_existing_prf(decode_input.src1, decode_input.id);
-                decode_input.src2 = find_existing_prf(decode_input.src2, decode_input.id);
+                cpu->decode_input.src1 = rename_source(cpu, cpu->decode_input.src1, cpu->decode_input.id);
+                cpu->decode_input.src2 = rename_source(cpu, cpu->decode_input.src2, cpu->decode_input.id);
 
-                printf("\n Details of RENAME TABLE State --> \t %s P%d P%d %d", decode_input.opcode, decode_input.src1, decode_input.src2, decode_input.literal);
+                trace(TRACE_STAGE, "\n Details of RENAME TABLE State --> \t %s P%d P%d %d", cpu->decode_input.opcode, cpu->decode_input.src1, cpu->decode_input.src2, cpu->decode_input.literal);
 
-                rob[rob_add_index] = decode_input;
-                rob_add_index++;
+                cpu->rob[cpu->rob_add_index] = cpu->decode_input;
+                cpu->rob_add_index++;
 
-                lsq[lsq_add_index] = decode_input;
-                lsq_add_index++;
+                cpu->lsq[cpu->lsq_add_index] = cpu->decode_input;
+                cpu->lsq_add_index++;
 
-                iqueue[iq_add_index] = decode_input;
-                decode_input = nop;
-                iq_add_index++;
+                cpu->iqueue[cpu->iq_add_index] = cpu->decode_input;
+                cpu->decode_input = nop;
+                cpu->iq_add_index++;
             }
             else
-                printf("\n Instruction at DECODE_RF_STAGE ---> \t %s R%d R%d %d stalled", decode_input.opcode, decode_input.src1, decode_input.src2, decode_input.literal);
+                trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE ---> \t %s R%d R%d %d stalled", cpu->decode_input.opcode, cpu->decode_input.src1, cpu->decode_input.src2, cpu->decode_input.literal);
     }
-    else if (!(strcmp(decode_input.opcode, "ADDL")))
+    else if (!(strcmp(cpu->decode_input.opcode, "ADDL")))
     {
-            if(prf_available() == 1 && iq_full_index == 0 && rob_full_index == 0 && lsq_full_index == 0){
-                printf("\n Instruction at DECODE_RF_STAGE ---> \t %s R%d R%d %d", decode_input.opcode, decode_input.dest, decode_input.src1, decode_input.literal);
+            if(prf_available(cpu) == 1 && cpu->iq_full_index == 0 && cpu->rob_full_index == 0 && cpu->lsq_full_index == 0){
+                trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE ---> \t %s R%d R%d %d", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1, cpu->decode_input.literal);
 
-                decode_input.src1 = find_existing_prf(decode_input.src1, decode_input.id);
+                cpu->decode_input.src1 = rename_source(cpu, cpu->decode_input.src1, cpu->decode_input.id);
 
-                dummy1 = decode_input.dest;
-                old_instance_prf(decode_input.dest);
-                dest = find_new_prf();
-                decode_input.dest = dest;
-                physical_Reg_File[dest].status = INVALID;
-                physical_Reg_File[dest].ins_id = decode_input.id;         // for later use in rob, iq
-                physical_Reg_File[dest].busy = 1;                   // make 0 in rob when the inst id of prf mathces the index of instruction being commited
-                physical_Reg_File[dest].arf_id = dummy1;
+                cpu->dummy1 = cpu->decode_input.dest;
+                dest = rename_dest(cpu, cpu->dummy1, cpu->decode_input.id);
+                cpu->decode_input.dest = dest;
+                cpu->decode_input.phys_dest = dest;
 
-                printf("\n Details of RENAME TABLE State --> \t %s P%d P%d %d", decode_input.opcode, decode_input.dest, decode_input.src1, decode_input.literal);
+                trace(TRACE_STAGE, "\n Details of RENAME TABLE State --> \t %s P%d P%d %d", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1, cpu->decode_input.literal);
 
-                rob[rob_add_index] = decode_input;
-                rob[rob_add_index].dest = dummy1;
-                rob_add_index++;
+                cpu->rob[cpu->rob_add_index] = cpu->decode_input;
+                cpu->rob[cpu->rob_add_index].dest = cpu->dummy1;
+                cpu->rob_add_index++;
 
-                iqueue[iq_add_index] = decode_input;
-                decode_input = nop;
-                iq_add_index++;                               // can instead use in IQUEUE function
+                cpu->iqueue[cpu->iq_add_index] = cpu->decode_input;
+                cpu->decode_input = nop;
+                cpu->iq_add_index++;                               // can instead use in IQUEUE function
             }
             else
-                printf("\n Instruction at DECODE_RF_STAGE ---> \t %s R%d R%d %d stalled", decode_input.opcode, decode_input.dest, decode_input.src1, decode_input.literal);
+                trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE ---> \t %s R%d R%d %d stalled", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1, cpu->decode_input.literal);
     }
-    else if (!(strcmp(decode_input.opcode, "SUBL")))
+    else if (!(strcmp(cpu->decode_input.opcode, "SUBL")))
     {
-            if(prf_available() == 1 && iq_full_index == 0 && rob_full_index == 0 && lsq_full_index == 0){
-                printf("\n Instruction at DECODE_RF_STAGE ---> \t %s R%d R%d %d", decode_input.opcode, decode_input.dest, decode_input.src1, decode_input.literal);
+            if(prf_available(cpu) == 1 && cpu->iq_full_index == 0 && cpu->rob_full_index == 0 && cpu->lsq_full_index == 0){
+                trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE ---> \t %s R%d R%d %d", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1, cpu->decode_input.literal);
 
-                decode_input.src1 = find_existing_prf(decode_input.src1, decode_input.id);
+                cpu->decode_input.src1 = rename_source(cpu, cpu->decode_input.src1, cpu->decode_input.id);
 
-                dummy1 = decode_input.dest;
-                old_instance_prf(decode_input.dest);
-                dest = find_new_prf();
-                decode_input.dest = dest;
-                physical_Reg_File[dest].status = INVALID;
-                physical_Reg_File[dest].ins_id = decode_input.id;         // for later use in rob, iq
-                physical_Reg_File[dest].busy = 1;                   // make 0 in rob when the inst id of prf mathces the index of instruction being commited
-                physical_Reg_File[dest].arf_id = dummy1;
+                cpu->dummy1 = cpu->decode_input.dest;
+                dest = rename_dest(cpu, cpu->dummy1, cpu->decode_input.id);
+                cpu->decode_input.dest = dest;
+                cpu->decode_input.phys_dest = dest;
 
-                printf("\n Details of RENAME TABLE State --> \t %s P%d P%d %d", decode_input.opcode, decode_input.dest, decode_input.src1, decode_input.literal);
+                trace(TRACE_STAGE, "\n Details of RENAME TABLE State --> \t %s P%d P%d %d", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1, cpu->decode_input.literal);
 
-                rob[rob_add_index] = decode_input;
-                rob[rob_add_index].dest = dummy1;
-                rob_add_index++;
+                cpu->rob[cpu->rob_add_index] = cpu->decode_input;
+                cpu->rob[cpu->rob_add_index].dest = cpu->dummy1;
+                cpu->rob_add_index++;
 
-                iqueue[iq_add_index] = decode_input;
-                decode_input = nop;
-                iq_add_index++;                               // can instead use in IQUEUE function
+                cpu->iqueue[cpu->iq_add_index] = cpu->decode_input;
+                cpu->decode_input = nop;
+                cpu->iq_add_index++;                               // can instead use in IQUEUE function
             }
             else
-                printf("\n Instruction at DECODE_RF_STAGE ---> \t %s R%d R%d %d stalled", decode_input.opcode, decode_input.dest, decode_input.src1, decode_input.literal);
+                trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE ---> \t %s R%d R%d %d stalled", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1, cpu->decode_input.literal);
     }
-    else if (!(strcmp(decode_input.opcode, "OR")))
+    else if (!(strcmp(cpu->decode_input.opcode, "OR")))
     {
-        if(prf_available() == 1 && iq_full_index == 0 && rob_full_index == 0)
+        if(prf_available(cpu) == 1 && cpu->iq_full_index == 0 && cpu->rob_full_index == 0)
         {
-          printf("\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d", decode_input.opcode, decode_input.dest, decode_input.src1,decode_input.src2);
+          trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1,cpu->decode_input.src2);
 
-          decode_input.src1 = find_existing_prf(decode_input.src1, decode_input.id);
-          decode_input.src2 = find_existing_prf(decode_input.src2, decode_input.id);
+          cpu->decode_input.src1 = rename_source(cpu, cpu->decode_input.src1, cpu->decode_input.id);
+          cpu->decode_input.src2 = rename_source(cpu, cpu->decode_input.src2, cpu->decode_input.id);
 
-          dummy1 = decode_input.dest;
-          old_instance_prf(decode_input.dest);
-          dest = find_new_prf();
-          decode_input.dest = dest;
-          physical_Reg_File[dest].status = INVALID;
-          physical_Reg_File[dest].ins_id = decode_input.id;         // for later use in rob, iq
-          physical_Reg_File[dest].busy = 1;                   // make 0 in rob when the inst id of prf mathces the index of instruction being commited
-          physical_Reg_File[dest].arf_id = dummy1;
+          cpu->dummy1 = cpu->decode_input.dest;
+          dest = rename_dest(cpu, cpu->dummy1, cpu->decode_input.id);
+          cpu->decode_input.dest = dest;
+          cpu->decode_input.phys_dest = dest;
 
-          printf("\n Details of RENAME TABLE State --> \t %s P%d P%d P%d", decode_input.opcode, decode_input.dest, decode_input.src1,decode_input.src2);
+          trace(TRACE_STAGE, "\n Details of RENAME TABLE State --> \t %s P%d P%d P%d", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1,cpu->decode_input.src2);
           //printf("\n stat %d ins_id %d busy %d arf_id %d\n", physical_Reg_File[dest].status, physical_Reg_File[dest].ins_id, physical_Reg_File[dest].busy, physical_Reg_File[dest].arf_id );
 
-          rob[rob_add_index] = decode_input;
-          rob[rob_add_index].dest = dummy1;
-          rob_add_index++;
+          cpu->rob[cpu->rob_add_index] = cpu->decode_input;
+          cpu->rob[cpu->rob_add_index].dest = cpu->dummy1;
+          cpu->rob_add_index++;
 
-          iqueue[iq_add_index] = decode_input;
-          decode_input = nop;
-          iq_add_index++;                               // can instead use in IQUEUE function
+          cpu->iqueue[cpu->iq_add_index] = cpu->decode_input;
+          cpu->decode_input = nop;
+          cpu->iq_add_index++;                               // can instead use in IQUEUE function
         }
         else
-            printf("\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d stalled", decode_input.opcode, decode_input.dest, decode_input.src1,decode_input.src2);
+            trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d stalled", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1,cpu->decode_input.src2);
     }
-    else if (!(strcmp(decode_input.opcode, "EX-OR")))
+    else if (!(strcmp(cpu->decode_input.opcode, "EX-OR")))
     {
-        if(prf_available() == 1 && iq_full_index == 0 && rob_full_index == 0)
+        if(prf_available(cpu) == 1 && cpu->iq_full_index == 0 && cpu->rob_full_index == 0)
         {
-          printf("\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d", decode_input.opcode, decode_input.dest, decode_input.src1,decode_input.src2);
+          trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1,cpu->decode_input.src2);
 
-          decode_input.src1 = find_existing_prf(decode_input.src1, decode_input.id);
-          decode_input.src2 = find_existing_prf(decode_input.src2, decode_input.id);
+          cpu->decode_input.src1 = rename_source(cpu, cpu->decode_input.src1, cpu->decode_input.id);
+          cpu->decode_input.src2 = rename_source(cpu, cpu->decode_input.src2, cpu->decode_input.id);
 
-          dummy1 = decode_input.dest;
-          old_instance_prf(decode_input.dest);
-          dest = find_new_prf();
-          decode_input.dest = dest;
-          physical_Reg_File[dest].status = INVALID;
-          physical_Reg_File[dest].ins_id = decode_input.id;         // for later use in rob, iq
-          physical_Reg_File[dest].busy = 1;                   // make 0 in rob when the inst id of prf mathces the index of instruction being commited
-          physical_Reg_File[dest].arf_id = dummy1;
+          cpu->dummy1 = cpu->decode_input.dest;
+          dest = rename_dest(cpu, cpu->dummy1, cpu->decode_input.id);
+          cpu->decode_input.dest = dest;
+          cpu->decode_input.phys_dest = dest;
 
-          printf("\n Details of RENAME TABLE State --> \t %s P%d P%d P%d", decode_input.opcode, decode_input.dest, decode_input.src1,decode_input.src2);
+          trace(TRACE_STAGE, "\n Details of RENAME TABLE State --> \t %s P%d P%d P%d", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1,cpu->decode_input.src2);
           //printf("\n stat %d ins_id %d busy %d arf_id %d\n", physical_Reg_File[dest].status, physical_Reg_File[dest].ins_id, physical_Reg_File[dest].busy, physical_Reg_File[dest].arf_id );
 
-          rob[rob_add_index] = decode_input;
-          rob[rob_add_index].dest = dummy1;
-          rob_add_index++;
+          cpu->rob[cpu->rob_add_index] = cpu->decode_input;
+          cpu->rob[cpu->rob_add_index].dest = cpu->dummy1;
+          cpu->rob_add_index++;
 
-          iqueue[iq_add_index] = decode_input;
-          decode_input = nop;
-          iq_add_index++;                               // can instead use in IQUEUE function
+          cpu->iqueue[cpu->iq_add_index] = cpu->decode_input;
+          cpu->decode_input = nop;
+          cpu->iq_add_index++;                               // can instead use in IQUEUE function
         }
         else
-            printf("\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d stalled", decode_input.opcode, decode_input.dest, decode_input.src1,decode_input.src2);
+            trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE --->  \t %s R%d R%d R%d stalled", cpu->decode_input.opcode, cpu->decode_input.dest, cpu->decode_input.src1,cpu->decode_input.src2);
     }
-    else if (!(strcmp(decode_input.opcode, "HALT")))
+    else if (!(strcmp(cpu->decode_input.opcode, "HALT")))
     {
-        if(prf_available() == 1 && iq_full_index == 0 && rob_full_index == 0){
-            printf("\n Instruction at DECODE_RF_STAGE ---> \t %s ", decode_input.opcode);
+        if(prf_available(cpu) == 1 && cpu->iq_full_index == 0 && cpu->rob_full_index == 0){
+            trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE ---> \t %s ", cpu->decode_input.opcode);
 
-            rob[rob_add_index] = decode_input;
-            rob_add_index++;
+            cpu->rob[cpu->rob_add_index] = cpu->decode_input;
+            cpu->rob_add_index++;
             //iqueue[iq_add_index] = decode_input;
             //iq_add_index++;
 
-            fetch_input = nop;
-            hflag = 1;   // HALT flag
-            decode_input = nop;
+            cpu->fetch_input = nop;
+            cpu->hflag = 1;   // HALT flag
+            cpu->decode_input = nop;
         }
         else
-            printf("\n Instruction at DECODE_RF_STAGE ---> \t %s stalled", decode_input.opcode);
+            trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE ---> \t %s stalled", cpu->decode_input.opcode);
     }
-    else if (!(strcmp(decode_input.opcode, "JUMP")))
+    else if (!(strcmp(cpu->decode_input.opcode, "JUMP")))
     {
-        if(iq_full_index == 0 && rob_full_index == 0){
-            printf("\n Instruction at DECODE_RF_STAGE ---> \t %s R%d %d ", decode_input.opcode, decode_input.src1, decode_input.literal);
+        if(cpu->iq_full_index == 0 && cpu->rob_full_index == 0){
+            trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE ---> \t %s R%d %d ", cpu->decode_input.opcode, cpu->decode_input.src1, cpu->decode_input.literal);
 
-            decode_input.src1 = find_existing_prf(decode_input.src1, decode_input.id);
-            printf("\n Details of RENAME TABLE State ---> \t %s P%d %d ", decode_input.opcode, decode_input.src1, decode_input.literal);
+            cpu->decode_input.src1 = rename_source(cpu, cpu->decode_input.src1, cpu->decode_input.id);
+            trace(TRACE_STAGE, "\n Details of RENAME TABLE State ---> \t %s P%d %d ", cpu->decode_input.opcode, cpu->decode_input.src1, cpu->decode_input.literal);
 
-            rob[rob_add_index] = decode_input;
-            rob_add_index++;
-            iqueue[iq_add_index] = decode_input;
-            iq_add_index++;
+            cpu->rob[cpu->rob_add_index] = cpu->decode_input;
+            cpu->rob_add_index++;
+            cpu->iqueue[cpu->iq_add_index] = cpu->decode_input;
+            cpu->iq_add_index++;
 
-            fetch_input = nop;
-            jflag = 1;          //set bflag = 1 in rob when commiting JUMP ins.
-            decode_input = nop;
+            cpu->fetch_input = nop;
+            cpu->jflag = 1;          //set bflag = 1 in rob when commiting JUMP ins.
+            cpu->decode_input = nop;
         }
         else
-            printf("\n Instruction at DECODE_RF_STAGE ---> \t %s R%d %d stalled", decode_input.opcode, decode_input.src1, decode_input.literal);
+            trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE ---> \t %s R%d %d stalled", cpu->decode_input.opcode, cpu->decode_input.src1, cpu->decode_input.literal);
     }
-    else if (!(strcmp(decode_input.opcode, "BZ")))
+    else if (!(strcmp(cpu->decode_input.opcode, "BZ")))
     {
-        if(iq_full_index == 0 && rob_full_index == 0){
-            printf("\n Instruction at DECODE_RF_STAGE --->: \t %s %d ", decode_input.opcode, decode_input.literal);
+        if(cpu->iq_full_index == 0 && cpu->rob_full_index == 0){
+            trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE --->: \t %s %d ", cpu->decode_input.opcode, cpu->decode_input.literal);
 
-            rob[rob_add_index] = decode_input;
-            rob_add_index++;
-            iqueue[iq_add_index] = decode_input;
-            iq_add_index++;
+            cpu->rob[cpu->rob_add_index] = cpu->decode_input;
+            cpu->rob_add_index++;
+            cpu->iqueue[cpu->iq_add_index] = cpu->decode_input;
+            cpu->iq_add_index++;
 
-            decode_input = nop;
+            cpu->decode_input = nop;
         }
         else
-            printf("\n Instruction at DECODE_RF_STAGE ---> \t %s %d stalled", decode_input.opcode, decode_input.literal);
+            trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE ---> \t %s %d stalled", cpu->decode_input.opcode, cpu->decode_input.literal);
     }
  }
  else
-  printf("\n Instruction at DECODE_RF_STAGE ---> \t idle");
-    if(abs(iq_add_index - iq_rem_index) >= 11)
-        iq_full_index = 1;
+  trace(TRACE_STAGE, "\n Instruction at DECODE_RF_STAGE ---> \t idle");
+    if(abs(cpu->iq_add_index - cpu->iq_rem_index) >= cpu->iq_size - 1)
+        cpu->iq_full_index = 1;
     else
-        iq_full_index = 0;
-    if(abs(rob_add_index - rob_com_index) >= 11)
-        rob_full_index = 1;
+        cpu->iq_full_index = 0;
+    if(abs(cpu->rob_add_index - cpu->rob_com_index) >= cpu->rob_size - 1)
+        cpu->rob_full_index = 1;
     else
-        rob_full_index = 0;
-    if(abs(lsq_add_index - lsq_rem_index) >= 5)
-        lsq_full_index = 1;
+        cpu->rob_full_index = 0;
+    if(abs(cpu->lsq_add_index - cpu->lsq_rem_index) >= cpu->lsq_size - 1)
+        cpu->lsq_full_index = 1;
     else
-        lsq_full_index = 0;
+        cpu->lsq_full_index = 0;
 
-    if(iq_add_index > 11){
-        for(int i = 0; i < 12; i++){
-            if(!(strcmp(iqueue[i].opcode, "nop")))
-               iq_add_index = i;
+    if(cpu->iq_add_index > cpu->iq_size - 1){
+        for(int i = 0; i < cpu->iq_size; i++){
+            if(!(strcmp(cpu->iqueue[i].opcode, "nop")))
+               cpu->iq_add_index = i;
         }
     }
-    if(lsq_add_index > 5){
-        for(int i = 0; i < 6; i++){
-            if(!(strcmp(lsq[i].opcode, "nop")))
-               lsq_add_index = i;
+    if(cpu->lsq_add_index > cpu->lsq_size - 1){
+        for(int i = 0; i < cpu->lsq_size; i++){
+            if(!(strcmp(cpu->lsq[i].opcode, "nop")))
+               cpu->lsq_add_index = i;
         }
     }
-    if(rob_add_index > 11){
-        for(int i = 0; i < 12; i++){
-            if(!(strcmp(rob[i].opcode, "nop")))
-               rob_add_index = i;
+    if(cpu->rob_add_index > cpu->rob_size - 1){
+        for(int i = 0; i < cpu->rob_size; i++){
+            if(!(strcmp(cpu->rob[i].opcode, "nop")))
+               cpu->rob_add_index = i;
         }
     }
 }
 
-void INT1_FU_STAGE(){
+void INT1_FU_STAGE(APEX_OOO_CPU *cpu){
   //printf("viranchi %s\n", int_fun1_input.opcode);
-    if((strcmp(int_fun1_input.opcode, "nop")))
+    if((strcmp(cpu->int_fun1_input.opcode, "nop")))
     {
-      if (!(strcmp(int_fun1_input.opcode, "MOVC")))
+      if (!(strcmp(cpu->int_fun1_input.opcode, "MOVC")))
         {
-            printf("\n Instruction at INT1_FU_STAGE ---> \t %s P%d %d", int_fun1_input.opcode, int_fun1_input.dest, int_fun1_input.literal);
-            int_fun2_input = int_fun1_input;
-            int_fun1_input = nop;
+            trace(TRACE_STAGE, "\n Instruction at INT1_FU_STAGE ---> \t %s P%d %d", cpu->int_fun1_input.opcode, cpu->int_fun1_input.dest, cpu->int_fun1_input.literal);
+            cpu->int_fun2_input = cpu->int_fun1_input;
+            cpu->int_fun1_input = nop;
         }
-      else if (!(strcmp(int_fun1_input.opcode, "ADD")))
+      else if (!(strcmp(cpu->int_fun1_input.opcode, "ADD")))
         {
-            printf("\n Instruction at INT1_FU_STAGE ---> \t %s P%d P%d P%d", int_fun1_input.opcode, int_fun1_input.dest, int_fun1_input.src1,int_fun1_input.src2);
-            int_fun2_input = int_fun1_input;
-            int_fun1_input = nop;
+            trace(TRACE_STAGE, "\n Instruction at INT1_FU_STAGE ---> \t %s P%d P%d P%d", cpu->int_fun1_input.opcode, cpu->int_fun1_input.dest, cpu->int_fun1_input.src1,cpu->int_fun1_input.src2);
+            cpu->int_fun2_input = cpu->int_fun1_input;
+            cpu->int_fun1_input = nop;
         }
-      else if (!(strcmp(int_fun1_input.opcode, "SUB")))
+      else if (!(strcmp(cpu->int_fun1_input.opcode, "SUB")))
         {
-            printf("\n Instruction at INT1_FU_STAGE ---> \t %s P%d P%d P%d", int_fun1_input.opcode, int_fun1_input.dest, int_fun1_input.src1,int_fun1_input.src2);
-            int_fun2_input = int_fun1_input;
-            int_fun1_input = nop;
+            trace(TRACE_STAGE, "\n Instruction at INT1_FU_STAGE ---> \t %s P%d P%d P%d", cpu->int_fun1_input.opcode, cpu->int_fun1_input.dest, cpu->int_fun1_input.src1,cpu->int_fun1_input.src2);
+            cpu->int_fun2_input = cpu->int_fun1_input;
+            cpu->int_fun1_input = nop;
         }
-      else if (!(strcmp(int_fun1_input.opcode, "AND")))
+      else if (!(strcmp(cpu->int_fun1_input.opcode, "AND")))
         {
-            printf("\n Instruction at INT1_FU_STAGE ---> \t %s P%d P%d P%d", int_fun1_input.opcode, int_fun1_input.dest, int_fun1_input.src1,int_fun1_input.src2);
-            int_fun2_input = int_fun1_input;
-            int_fun1_input = nop;
+            trace(TRACE_STAGE, "\n Instruction at INT1_FU_STAGE ---> \t %s P%d P%d P%d", cpu->int_fun1_input.opcode, cpu->int_fun1_input.dest, cpu->int_fun1_input.src1,cpu->int_fun1_input.src2);
+            cpu->int_fun2_input = cpu->int_fun1_input;
+            cpu->int_fun1_input = nop;
         }
-      else if (!(strcmp(int_fun1_input.opcode, "MUL")))
+      else if (!(strcmp(cpu->int_fun1_input.opcode, "MUL")))
         {
-            printf("\n Instruction at INT1_FU_STAGE ---> \t %s P%d P%d P%d", int_fun1_input.opcode, int_fun1_input.dest, int_fun1_input.src1,int_fun1_input.src2);
-            int_fun2_input = int_fun1_input;
-            int_fun1_input = nop;
+            trace(TRACE_STAGE, "\n Instruction at INT1_FU_STAGE ---> \t %s P%d P%d P%d", cpu->int_fun1_input.opcode, cpu->int_fun1_input.dest, cpu->int_fun1_input.src1,cpu->int_fun1_input.src2);
+            cpu->int_fun2_input = cpu->int_fun1_input;
+            cpu->int_fun1_input = nop;
         }
-      else if (!(strcmp(int_fun1_input.opcode, "LOAD")))
+      else if (!(strcmp(cpu->int_fun1_input.opcode, "LOAD")))
         {
-            printf("\n Instruction at INT1_FU_STAGE ---> \t %s P%d P%d %d", int_fun1_input.opcode, int_fun1_input.dest, int_fun1_input.src1,int_fun1_input.literal);
-            int_fun2_input = int_fun1_input;
-            int_fun1_input = nop;
+            trace(TRACE_STAGE, "\n Instruction at INT1_FU_STAGE ---> \t %s P%d P%d %d", cpu->int_fun1_input.opcode, cpu->int_fun1_input.dest, cpu->int_fun1_input.src1,cpu->int_fun1_input.literal);
+            cpu->int_fun2_input = cpu->int_fun1_input;
+            cpu->int_fun1_input = nop;
         }
-      else if (!(strcmp(int_fun1_input.opcode, "STORE")))
+      else if (!(strcmp(cpu->int_fun1_input.opcode, "STORE")))
         {
-            printf("\n Instruction at INT1_FU_STAGE ---> \t %s P%d P%d %d", int_fun1_input.opcode, int_fun1_input.src1,int_fun1_input.src2,int_fun1_input.literal);
-            int_fun2_input = int_fun1_input;
-            int_fun1_input = nop;
+            trace(TRACE_STAGE, "\n Instruction at INT1_FU_STAGE ---> \t %s P%d P%d %d", cpu->int_fun1_input.opcode, cpu->int_fun1_input.src1,cpu->int_fun1_input.src2,cpu->int_fun1_input.literal);
+            cpu->int_fun2_input = cpu->int_fun1_input;
+            cpu->int_fun1_input = nop;
         }
-      else if (!(strcmp(int_fun1_input.opcode, "ADDL")))
+      else if (!(strcmp(cpu->int_fun1_input.opcode, "ADDL")))
         {
-            printf("\n Instruction at INT1_FU_STAGE ---> \t %s P%d P%d P%d", int_fun1_input.opcode, int_fun1_input.dest, int_fun1_input.src1,int_fun1_input.literal);
-            int_fun2_input = int_fun1_input;
-            int_fun1_input = nop;
+            trace(TRACE_STAGE, "\n Instruction at INT1_FU_STAGE ---> \t %s P%d P%d P%d", cpu->int_fun1_input.opcode, cpu->int_fun1_input.dest, cpu->int_fun1_input.src1,cpu->int_fun1_input.literal);
+            cpu->int_fun2_input = cpu->int_fun1_input;
+            cpu->int_fun1_input = nop;
         }
-      else if (!(strcmp(int_fun1_input.opcode, "SUBL")))
+      else if (!(strcmp(cpu->int_fun1_input.opcode, "SUBL")))
         {
-            printf("\n Instruction at INT1_FU_STAGE ---> \t %s P%d P%d P%d", int_fun1_input.opcode, int_fun1_input.dest, int_fun1_input.src1,int_fun1_input.literal);
-            int_fun2_input = int_fun1_input;
-            int_fun1_input = nop;
+            trace(TRACE_STAGE, "\n Instruction at INT1_FU_STAGE ---> \t %s P%d P%d P%d", cpu->int_fun1_input.opcode, cpu->int_fun1_input.dest, cpu->int_fun1_input.src1,cpu->int_fun1_input.literal);
+            cpu->int_fun2_input = cpu->int_fun1_input;
+            cpu->int_fun1_input = nop;
         }
-      else if (!(strcmp(int_fun1_input.opcode, "OR")))
+      else if (!(strcmp(cpu->int_fun1_input.opcode, "OR")))
         {
-            printf("\n Instruction at INT1_FU_STAGE ---> \t %s P%d P%d P%d", int_fun1_input.opcode, int_fun1_input.dest, int_fun1_input.src1,int_fun1_input.src2);
-            int_fun2_input = int_fun1_input;
-            int_fun1_input = nop;
+            trace(TRACE_STAGE, "\n Instruction at INT1_FU_STAGE ---> \t %s P%d P%d P%d", cpu->int_fun1_input.opcode, cpu->int_fun1_input.dest, cpu->int_fun1_input.src1,cpu->int_fun1_input.src2);
+            cpu->int_fun2_input = cpu->int_fun1_input;
+            cpu->int_fun1_input = nop;
         }
-      else if (!(strcmp(int_fun1_input.opcode, "EX-OR")))
+      else if (!(strcmp(cpu->int_fun1_input.opcode, "EX-OR")))
         {
-            printf("\n Instruction at INT1_FU_STAGE ---> \t %s P%d P%d P%d", int_fun1_input.opcode, int_fun1_input.dest, int_fun1_input.src1,int_fun1_input.src2);
-            int_fun2_input = int_fun1_input;
-            int_fun1_input = nop;
+            trace(TRACE_STAGE, "\n Instruction at INT1_FU_STAGE ---> \t %s P%d P%d P%d", cpu->int_fun1_input.opcode, cpu->int_fun1_input.dest, cpu->int_fun1_input.src1,cpu->int_fun1_input.src2);
+            cpu->int_fun2_input = cpu->int_fun1_input;
+            cpu->int_fun1_input = nop;
         }
-      else if (!(strcmp(int_fun1_input.opcode, "JUMP")))
+      else if (!(strcmp(cpu->int_fun1_input.opcode, "JUMP")))
         {
-            printf("\n Execute stage : \t %s P%d %d", int_fun1_input.opcode, int_fun1_input.src1, int_fun1_input.literal);
-            int_fun2_input = int_fun1_input;
-            int_fun1_input = nop;
+            trace(TRACE_STAGE, "\n Execute stage : \t %s P%d %d", cpu->int_fun1_input.opcode, cpu->int_fun1_input.src1, cpu->int_fun1_input.literal);
+            cpu->int_fun2_input = cpu->int_fun1_input;
+            cpu->int_fun1_input = nop;
         }
   }
 
   else
-    printf("\n Instruction at INT1_FU_STAGE ---> \t idle");
+    trace(TRACE_STAGE, "\n Instruction at INT1_FU_STAGE ---> \t idle");
 }
 
-void INT2_FU_STAG(){
-  if((strcmp(int_fun2_input.opcode, "nop")))
+void INT2_FU_STAG(APEX_OOO_CPU *cpu){
+  if((strcmp(cpu->int_fun2_input.opcode, "nop")))
   {
-    if (!(strcmp(int_fun2_input.opcode, "MOVC")))
+    if (!(strcmp(cpu->int_fun2_input.opcode, "MOVC")))
     {
-        printf("\n Instruction at INT2_FU_STAGE ---> \t %s P%d %d", int_fun2_input.opcode, int_fun2_input.dest, int_fun2_input.literal);
-        int_fun2_input.result = int_fun2_input.literal;
-        physical_Reg_File[int_fun2_input.dest].status = VALID;
-        physical_Reg_File[int_fun2_input.dest].value = int_fun2_input.result;
+        trace(TRACE_STAGE, "\n Instruction at INT2_FU_STAGE ---> \t %s P%d %d", cpu->int_fun2_input.opcode, cpu->int_fun2_input.dest, cpu->int_fun2_input.literal);
+        cpu->int_fun2_input.result = cpu->int_fun2_input.literal;
+        cpu->physical_Reg_File[cpu->int_fun2_input.dest].status = VALID;
+        cpu->physical_Reg_File[cpu->int_fun2_input.dest].value = cpu->int_fun2_input.result;
 
-        for (int i = 0; i != 12; i++)
+        for (int i = 0; i != cpu->rob_size; i++)
         {
           //printf("\n");
           //printf("kumudini %d\n", i);
           //printf("check id : %d : %d\n", rob[i].id, int_fun2_input.id);
-          if(rob[i].id == int_fun2_input.id)
+          if(cpu->rob[i].id == cpu->int_fun2_input.id)
             {
-                rob[i].result = int_fun2_input.result;
-                rob[i].status = VALID;
+                cpu->rob[i].result = cpu->int_fun2_input.result;
+                cpu->rob[i].status = VALID;
             }
         }
 
-    int_fun2_input = nop;
+    cpu->int_fun2_input = nop;
   }
-    else if (!(strcmp(int_fun2_input.opcode, "ADD")))
+    else if (!(strcmp(cpu->int_fun2_input.opcode, "ADD")))
     {
-          printf("\n Instruction at INT2_FU_STAGE ---> \t %s P%d P%d P%d", int_fun2_input.opcode, int_fun2_input.dest, int_fun2_input.src1,int_fun2_input.src2);
-          int_fun2_input.result = physical_Reg_File[int_fun2_input.src1].value + physical_Reg_File[int_fun2_input.src2].value;
-          physical_Reg_File[int_fun2_input.dest].status = VALID;
-          physical_Reg_File[int_fun2_input.dest].value = int_fun2_input.result;
+          trace(TRACE_STAGE, "\n Instruction at INT2_FU_STAGE ---> \t %s P%d P%d P%d", cpu->int_fun2_input.opcode, cpu->int_fun2_input.dest, cpu->int_fun2_input.src1,cpu->int_fun2_input.src2);
+          cpu->int_fun2_input.result = cpu->physical_Reg_File[cpu->int_fun2_input.src1].value + cpu->physical_Reg_File[cpu->int_fun2_input.src2].value;
+          cpu->physical_Reg_File[cpu->int_fun2_input.dest].status = VALID;
+          cpu->physical_Reg_File[cpu->int_fun2_input.dest].value = cpu->int_fun2_input.result;
           //printf("fu2 add result is %ld\n", int_fun2_input.result);
           //Forward the result to rob entry using instruction id
-          for (int i = 0; i != 12; i++)
+          for (int i = 0; i != cpu->rob_size; i++)
           {
             //printf("\n");
             //printf("kumudini %d\n", i);
             //printf("check id : %d : %d\n", rob[i].id, int_fun2_input.id);
-            if(rob[i].id == int_fun2_input.id)
+            if(cpu->rob[i].id == cpu->int_fun2_input.id)
               {
-                  rob[i].result = int_fun2_input.result;
-                  rob[i].status = VALID;
+                  cpu->rob[i].result = cpu->int_fun2_input.result;
+                  cpu->rob[i].status = VALID;
               }
           }
 
-      int_fun2_input = nop;
+      cpu->int_fun2_input = nop;
     }
-    else if (!(strcmp(int_fun2_input.opcode, "SUB")))
+    else if (!(strcmp(cpu->int_fun2_input.opcode, "SUB")))
     {
-          printf("\n Instruction at INT2_FU_STAGE ---> \t %s P%d P%d P%d", int_fun2_input.opcode, int_fun2_input.dest, int_fun2_input.src1,int_fun2_input.src2);
-          int_fun2_input.result = physical_Reg_File[int_fun2_input.src1].value - physical_Reg_File[int_fun2_input.src2].value;
-          physical_Reg_File[int_fun2_input.dest].status = VALID;
-          physical_Reg_File[int_fun2_input.dest].value = int_fun2_input.result;
+          trace(TRACE_STAGE, "\n Instruction at INT2_FU_STAGE ---> \t %s P%d P%d P%d", cpu->int_fun2_input.opcode, cpu->int_fun2_input.dest, cpu->int_fun2_input.src1,cpu->int_fun2_input.src2);
+          cpu->int_fun2_input.result = cpu->physical_Reg_File[cpu->int_fun2_input.src1].value - cpu->physical_Reg_File[cpu->int_fun2_input.src2].value;
+          cpu->physical_Reg_File[cpu->int_fun2_input.dest].status = VALID;
+          cpu->physical_Reg_File[cpu->int_fun2_input.dest].value = cpu->int_fun2_input.result;
           //Forward the result to rob entry using instruction id
-          for (int i = 0; i != 12; i++)
+          for (int i = 0; i != cpu->rob_size; i++)
           {
             //printf("\n");
             //printf("kumudini %d\n", i);
             //printf("check id : %d : %d\n", rob[i].id, int_fun2_input.id);
-            if(rob[i].id == int_fun2_input.id)
+            if(cpu->rob[i].id == cpu->int_fun2_input.id)
               {
-                  rob[i].result = int_fun2_input.result;
-                  rob[i].status = VALID;
+                  cpu->rob[i].result = cpu->int_fun2_input.result;
+                  cpu->rob[i].status = VALID;
               }
           }
 
-      int_fun2_input = nop;
+      cpu->int_fun2_input = nop;
     }
-    else if (!(strcmp(int_fun2_input.opcode, "AND")))
+    else if (!(strcmp(cpu->int_fun2_input.opcode, "AND")))
     {
-          printf("\n Instruction at INT2_FU_STAGE ---> \t %s P%d P%d P%d", int_fun2_input.opcode, int_fun2_input.dest, int_fun2_input.src1,int_fun2_input.src2);
-          int_fun2_input.result = physical_Reg_File[int_fun2_input.src1].value & physical_Reg_File[int_fun2_input.src2].value;
-          physical_Reg_File[int_fun2_input.dest].status = VALID;
-          physical_Reg_File[int_fun2_input.dest].value = int_fun2_input.result;
+          trace(TRACE_STAGE, "\n Instruction at INT2_FU_STAGE ---> \t %s P%d P%d P%d", cpu->int_fun2_input.opcode, cpu->int_fun2_input.dest, cpu->int_fun2_input.src1,cpu->int_fun2_input.src2);
+          cpu->int_fun2_input.result = cpu->physical_Reg_File[cpu->int_fun2_input.src1].value & cpu->physical_Reg_File[cpu->int_fun2_input.src2].value;
+          cpu->physical_Reg_File[cpu->int_fun2_input.dest].status = VALID;
+          cpu->physical_Reg_File[cpu->int_fun2_input.dest].value = cpu->int_fun2_input.result;
           //Forward the result to rob entry using instruction id
-          for (int i = 0; i != 12; i++)
+          for (int i = 0; i != cpu->rob_size; i++)
           {
             //printf("\n");
             //printf("kumudini %d\n", i);
             //printf("check id : %d : %d\n", rob[i].id, int_fun2_input.id);
-            if(rob[i].id == int_fun2_input.id)
+            if(cpu->rob[i].id == cpu->int_fun2_input.id)
               {
-                  rob[i].result = int_fun2_input.result;
-                  rob[i].status = VALID;
+                  cpu->rob[i].result = cpu->int_fun2_input.result;
+                  cpu->rob[i].status = VALID;
               }
           }
 
-      int_fun2_input = nop;
+      cpu->int_fun2_input = nop;
     }
-    else if (!(strcmp(int_fun2_input.opcode, "LOAD")))
+    else if (!(strcmp(cpu->int_fun2_input.opcode, "LOAD")))
     {
-        printf("\n Instruction at INT2_FU_STAGE ---> \t %s P%d P%d %d", int_fun2_input.opcode, int_fun2_input.dest, int_fun2_input.src1, int_fun2_input.literal);
-        int_fun2_input.address = (physical_Reg_File[int_fun2_input.src1].value + int_fun2_input.literal)/4;
+        trace(TRACE_STAGE, "\n Instruction at INT2_FU_STAGE ---> \t %s P%d P%d %d", cpu->int_fun2_input.opcode, cpu->int_fun2_input.dest, cpu->int_fun2_input.src1, cpu->int_fun2_input.literal);
+        cpu->int_fun2_input.address = (cpu->physical_Reg_File[cpu->int_fun2_input.src1].value + cpu->int_fun2_input.literal)/4;
 
 
-        for (int i = 0; i < 6; i++){
-            if (lsq[i].id == int_fun2_input.id){
-                lsq[i].address = int_fun2_input.address;
-                lsq[i].status = VALID;
+        for (int i = 0; i < cpu->lsq_size; i++){
+            if (cpu->lsq[i].id == cpu->int_fun2_input.id){
+                cpu->lsq[i].address = cpu->int_fun2_input.address;
+                cpu->lsq[i].status = VALID;
             }
         }
-        int_fun2_input = nop;
+        cpu->int_fun2_input = nop;
     }
-    else if (!(strcmp(int_fun2_input.opcode, "STORE")))
+    else if (!(strcmp(cpu->int_fun2_input.opcode, "STORE")))
     {
-        printf("\n Instruction at INT2_FU_STAGE ---> \t %s P%d P%d %d", int_fun2_input.opcode, int_fun2_input.src1, int_fun2_input.src2, int_fun2_input.literal);
-        int_fun2_input.address = (physical_Reg_File[int_fun2_input.src2].value + int_fun2_input.literal)/4;
+        trace(TRACE_STAGE, "\n Instruction at INT2_FU_STAGE ---> \t %s P%d P%d %d", cpu->int_fun2_input.opcode, cpu->int_fun2_input.src1, cpu->int_fun2_input.src2, cpu->int_fun2_input.literal);
+        cpu->int_fun2_input.address = (cpu->physical_Reg_File[cpu->int_fun2_input.src2].value + cpu->int_fun2_input.literal)/4;
 
 
-        for (int i = 0; i < 6; i++){
-            if (lsq[i].id == int_fun2_input.id){
-                lsq[i].address = int_fun2_input.address;
-                lsq[i].status = VALID;
+        for (int i = 0; i < cpu->lsq_size; i++){
+            if (cpu->lsq[i].id == cpu->int_fun2_input.id){
+                cpu->lsq[i].address = cpu->int_fun2_input.address;
+                cpu->lsq[i].status = VALID;
                 //printf("LSQ status : %d\n",lsq[i].status);
             }
         }
-        int_fun2_input = nop;
+        cpu->int_fun2_input = nop;
     }
-    else if (!(strcmp(int_fun2_input.opcode, "ADDL")))
+    else if (!(strcmp(cpu->int_fun2_input.opcode, "ADDL")))
     {
-        printf("\n Instruction at INT2_FU_STAGE ---> \t %s P%d %d", int_fun2_input.opcode, int_fun2_input.src1,int_fun2_input.literal);
-        int_fun2_input.result = (physical_Reg_File[int_fun2_input.src1].value + int_fun2_input.literal);
+        trace(TRACE_STAGE, "\n Instruction at INT2_FU_STAGE ---> \t %s P%d %d", cpu->int_fun2_input.opcode, cpu->int_fun2_input.src1,cpu->int_fun2_input.literal);
+        cpu->int_fun2_input.result = (cpu->physical_Reg_File[cpu->int_fun2_input.src1].value + cpu->int_fun2_input.literal);
         //printf(" in fu2 \n");
 
-        physical_Reg_File[int_fun2_input.dest].status = VALID;
-        physical_Reg_File[int_fun2_input.dest].value = int_fun2_input.result;
+        cpu->physical_Reg_File[cpu->int_fun2_input.dest].status = VALID;
+        cpu->physical_Reg_File[cpu->int_fun2_input.dest].value = cpu->int_fun2_input.result;
 
-        for (int i = 0; i != 12; i++)
+        for (int i = 0; i != cpu->rob_size; i++)
         {
           //printf("\n");
           //printf("kumudini %d\n", i);
           //printf("check id : %d : %d\n", rob[i].id, int_fun2_input.id);
-          if(rob[i].id == int_fun2_input.id)
+          if(cpu->rob[i].id == cpu->int_fun2_input.id)
             {
-                rob[i].result = int_fun2_input.result;
-                rob[i].status = VALID;
+                cpu->rob[i].result = cpu->int_fun2_input.result;
+                cpu->rob[i].status = VALID;
             }
         }
-        int_fun2_input = nop;
+        cpu->int_fun2_input = nop;
     }
-    else if (!(strcmp(int_fun2_input.opcode, "SUBL")))
+    else if (!(strcmp(cpu->int_fun2_input.opcode, "SUBL")))
     {
-        printf("\n Instruction at INT2_FU_STAGE ---> \t %s P%d %d", int_fun2_input.opcode, int_fun2_input.src1,int_fun2_input.literal);
-        int_fun2_input.result = (physical_Reg_File[int_fun2_input.src1].value - int_fun2_input.literal);
+        trace(TRACE_STAGE, "\n Instruction at INT2_FU_STAGE ---> \t %s P%d %d", cpu->int_fun2_input.opcode, cpu->int_fun2_input.src1,cpu->int_fun2_input.literal);
+        cpu->int_fun2_input.result = (cpu->physical_Reg_File[cpu->int_fun2_input.src1].value - cpu->int_fun2_input.literal);
 
         //printf("result of subl is %ld\n", int_fun2_input.result);
 
-        physical_Reg_File[int_fun2_input.dest].status = VALID;
-        physical_Reg_File[int_fun2_input.dest].value = int_fun2_input.result;
+        cpu->physical_Reg_File[cpu->int_fun2_input.dest].status = VALID;
+        cpu->physical_Reg_File[cpu->int_fun2_input.dest].value = cpu->int_fun2_input.result;
 
-        for (int i = 0; i != 12; i++)
+        for (int i = 0; i != cpu->rob_size; i++)
         {
           //printf("\n");
           //printf("kumudini %d\n", i);
           //printf("check id : %d : %d\n", rob[i].id, int_fun2_input.id);
-          if(rob[i].id == int_fun2_input.id)
+          if(cpu->rob[i].id == cpu->int_fun2_input.id)
             {
-                rob[i].result = int_fun2_input.result;
-                rob[i].status = VALID;
+                cpu->rob[i].result = cpu->int_fun2_input.result;
+                cpu->rob[i].status = VALID;
             }
         }
-        int_fun2_input = nop;
+        cpu->int_fun2_input = nop;
     }
-    else if (!(strcmp(int_fun2_input.opcode, "OR")))
+    else if (!(strcmp(cpu->int_fun2_input.opcode, "OR")))
     {
-          printf("\n Instruction at INT2_FU_STAGE ---> \t %s P%d P%d P%d", int_fun2_input.opcode, int_fun2_input.dest, int_fun2_input.src1,int_fun2_input.src2);
-          int_fun2_input.result = physical_Reg_File[int_fun2_input.src1].value || physical_Reg_File[int_fun2_input.src2].value;
-          physical_Reg_File[int_fun2_input.dest].status = VALID;
-          physical_Reg_File[int_fun2_input.dest].value = int_fun2_input.result;
-          for (int i = 0; i != 12; i++)
+          trace(TRACE_STAGE, "\n Instruction at INT2_FU_STAGE ---> \t %s P%d P%d P%d", cpu->int_fun2_input.opcode, cpu->int_fun2_input.dest, cpu->int_fun2_input.src1,cpu->int_fun2_input.src2);
+          cpu->int_fun2_input.result = cpu->physical_Reg_File[cpu->int_fun2_input.src1].value || cpu->physical_Reg_File[cpu->int_fun2_input.src2].value;
+          cpu->physical_Reg_File[cpu->int_fun2_input.dest].status = VALID;
+          cpu->physical_Reg_File[cpu->int_fun2_input.dest].value = cpu->int_fun2_input.result;
+          for (int i = 0; i != cpu->rob_size; i++)
           {
             //printf("\n");
             //printf("kumudini %d\n", i);
             //printf("check id : %d : %d\n", rob[i].id, int_fun2_input.id);
-            if(rob[i].id == int_fun2_input.id)
+            if(cpu->rob[i].id == cpu->int_fun2_input.id)
               {
-                  rob[i].result = int_fun2_input.result;
-                  rob[i].status = VALID;
+                  cpu->rob[i].result = cpu->int_fun2_input.result;
+                  cpu->rob[i].status = VALID;
               }
           }
 
-      int_fun2_input = nop;
+      cpu->int_fun2_input = nop;
     }
-    else if (!(strcmp(int_fun2_input.opcode, "EX-OR")))
+    else if (!(strcmp(cpu->int_fun2_input.opcode, "EX-OR")))
     {
-          printf("\n Instruction at INT2_FU_STAGE ---> \t %s P%d P%d P%d", int_fun2_input.opcode, int_fun2_input.dest, int_fun2_input.src1,int_fun2_input.src2);
-          int_fun2_input.result = physical_Reg_File[int_fun2_input.src1].value ^ physical_Reg_File[int_fun2_input.src2].value;
-          physical_Reg_File[int_fun2_input.dest].status = VALID;
-          physical_Reg_File[int_fun2_input.dest].value = int_fun2_input.result;
+          trace(TRACE_STAGE, "\n Instruction at INT2_FU_STAGE ---> \t %s P%d P%d P%d", cpu->int_fun2_input.opcode, cpu->int_fun2_input.dest, cpu->int_fun2_input.src1,cpu->int_fun2_input.src2);
+          cpu->int_fun2_input.result = cpu->physical_Reg_File[cpu->int_fun2_input.src1].value ^ cpu->physical_Reg_File[cpu->int_fun2_input.src2].value;
+          cpu->physical_Reg_File[cpu->int_fun2_input.dest].status = VALID;
+          cpu->physical_Reg_File[cpu->int_fun2_input.dest].value = cpu->int_fun2_input.result;
 
-          for (int i = 0; i != 12; i++)
+          for (int i = 0; i != cpu->rob_size; i++)
           {
             //printf("\n");
             //printf("kumudini %d\n", i);
             //printf("check id : %d : %d\n", rob[i].id, int_fun2_input.id);
-            if(rob[i].id == int_fun2_input.id)
+            if(cpu->rob[i].id == cpu->int_fun2_input.id)
               {
-                  rob[i].result = int_fun2_input.result;
-                  rob[i].status = VALID;
+                  cpu->rob[i].result = cpu->int_fun2_input.result;
+                  cpu->rob[i].status = VALID;
               }
           }
 
-      int_fun2_input = nop;
+      cpu->int_fun2_input = nop;
     }
-    else if (!(strcmp(int_fun2_input.opcode, "JUMP")))
+    else if (!(strcmp(cpu->int_fun2_input.opcode, "JUMP")))
     {
-        printf("\n Instruction at INT2_FU_STAGE ---> \t %s P%d %d", int_fun2_input.opcode, int_fun2_input.src1, int_fun2_input.literal);
-        int_fun2_input.result = (physical_Reg_File[int_fun2_input.src1].value + int_fun2_input.literal - 4000)/4;
+        trace(TRACE_STAGE, "\n Instruction at INT2_FU_STAGE ---> \t %s P%d %d", cpu->int_fun2_input.opcode, cpu->int_fun2_input.src1, cpu->int_fun2_input.literal);
+        cpu->int_fun2_input.result = (cpu->physical_Reg_File[cpu->int_fun2_input.src1].value + cpu->int_fun2_input.literal - 4000)/4;
 
-        for (int i = 0; i != 12; i++){
-            if(rob[i].id == int_fun2_input.id){
-                rob[i].result = int_fun2_input.result;
-                rob[i].status = VALID;
+        for (int i = 0; i != cpu->rob_size; i++){
+            if(cpu->rob[i].id == cpu->int_fun2_input.id){
+                cpu->rob[i].result = cpu->int_fun2_input.result;
+                cpu->rob[i].status = VALID;
             }
         }
-        bflag = 1;
-        int_fun2_input = nop;
+        cpu->bflag = 1;
+        cpu->int_fun2_input = nop;
     }
 
   }
   else
-      printf("\n Instruction at INT2_FU_STAGE ---> \t idle");
+      trace(TRACE_STAGE, "\n Instruction at INT2_FU_STAGE ---> \t idle");
 }
 
-void bz_fu(){
+void bz_fu(APEX_OOO_CPU *cpu){
 
-if((strcmp(branch_fun_input.opcode, "nop"))){
+if((strcmp(cpu->branch_fun_input.opcode, "nop"))){
 
-    if (!(strcmp(branch_fun_input.opcode, "BZ"))){
-      printf("\n Branch_FU stage ---> \t\t\t %s %d", branch_fun_input.opcode, branch_fun_input.literal);
-      branch_fun_input.result = (branch_fun_input.index + (branch_fun_input.literal/4));
+    if (!(strcmp(cpu->branch_fun_input.opcode, "BZ"))){
+      trace(TRACE_STAGE, "\n Branch_FU stage ---> \t\t\t %s %d", cpu->branch_fun_input.opcode, cpu->branch_fun_input.literal);
+      cpu->branch_fun_input.result = (cpu->branch_fun_input.index + (cpu->branch_fun_input.literal/4));
       //printf("branch result %ld \n",branch_fun_input.result);
       //Forward the result to rob entry using instruction id
-      for (int i = 0; i != 12; i++){
-          if(rob[i].id == branch_fun_input.id){
-              rob[i].result = branch_fun_input.result;
-              rob[i].branch = branch_fun_input.branch;
-              rob[i].status = VALID;
+      for (int i = 0; i != cpu->rob_size; i++){
+          if(cpu->rob[i].id == cpu->branch_fun_input.id){
+              cpu->rob[i].result = cpu->branch_fun_input.result;
+              cpu->rob[i].branch = cpu->branch_fun_input.branch;
+              cpu->rob[i].status = VALID;
           }
       }
-      branch_fun_input = nop;
+      cpu->branch_fun_input = nop;
   }
   else
-      printf("\n Branch_FU stage ---> \t idle");
+      trace(TRACE_STAGE, "\n Branch_FU stage ---> \t idle");
   }
 }
 
-void memory(){
+void memory(APEX_OOO_CPU *cpu){
 
-    if((strcmp(memory_input.opcode, "nop")))
+    if((strcmp(cpu->memory_input.opcode, "nop")))
     {
-      if(!(strcmp(memory_input.opcode, "LOAD")))
+      if(!(strcmp(cpu->memory_input.opcode, "LOAD")))
         {
-          printf("\nInstruction at MEM_FU_STAGE ---> \t %s P%d P%d %d", memory_input.opcode, memory_input.dest, memory_input.src1, memory_input.literal);
-          memory_input.result = data_Memory[memory_input.address];
-          physical_Reg_File[memory_input.dest].value = memory_input.result;
-          physical_Reg_File[memory_input.dest].status = VALID;
-
-          for (int i = 0; i < 12; i++){
-              if(rob[i].id == memory_input.id){
-                  rob[i].result = memory_input.result;
-                  rob[i].status = VALID;
+          trace(TRACE_STAGE, "\nInstruction at MEM_FU_STAGE ---> \t %s P%d P%d %d", cpu->memory_input.opcode, cpu->memory_input.dest, cpu->memory_input.src1, cpu->memory_input.literal);
+          cpu->memory_input.result = cpu->data_Memory[cpu->memory_input.address];
+          cpu->physical_Reg_File[cpu->memory_input.dest].value = cpu->memory_input.result;
+          cpu->physical_Reg_File[cpu->memory_input.dest].status = VALID;
+
+          for (int i = 0; i < cpu->rob_size; i++){
+              if(cpu->rob[i].id == cpu->memory_input.id){
+                  cpu->rob[i].result = cpu->memory_input.result;
+                  cpu->rob[i].status = VALID;
               }
           }
-          memory_input = nop;
+          cpu->memory_input = nop;
       }
-        else if(!(strcmp(memory_input.opcode, "STORE")))
+        else if(!(strcmp(cpu->memory_input.opcode, "STORE")))
         {
-            printf("\n Instruction at MEM_FU_STAGE --->  \t %s P%d P%d %d", memory_input.opcode, memory_input.src1, memory_input.src2, memory_input.literal);
-            data_Memory[memory_input.address] = physical_Reg_File[memory_input.src1].value;
+            trace(TRACE_STAGE, "\n Instruction at MEM_FU_STAGE --->  \t %s P%d P%d %d", cpu->memory_input.opcode, cpu->memory_input.src1, cpu->memory_input.src2, cpu->memory_input.literal);
+            cpu->data_Memory[cpu->memory_input.address] = cpu->physical_Reg_File[cpu->memory_input.src1].value;
 
-            for (int i = 0; i < 12; i++)
+            for (int i = 0; i < cpu->rob_size; i++)
             {
-                if(rob[i].id == memory_input.id)
+                if(cpu->rob[i].id == cpu->memory_input.id)
                 {
-                    rob[i].status = VALID;
+                    cpu->rob[i].status = VALID;
                 }
             }
-            memory_input = nop;
+            cpu->memory_input = nop;
         }
     }
-    printf("\n Instruction at MEM_FU_STAGE ---> \t idle");
+    trace(TRACE_STAGE, "\n Instruction at MEM_FU_STAGE ---> \t idle");
 }
 
-void mul1(){
+void mul1(APEX_OOO_CPU *cpu){
 
-  if((strcmp(mul_fun1_input.opcode, "nop"))){
-    if (!(strcmp(mul_fun2_input.opcode, "nop"))){
-        printf("\n Instruction at MUL1_FU_STAGE ---> \t\t %s P%d P%d P%d", mul_fun1_input.opcode, mul_fun1_input.dest, mul_fun1_input.src1, mul_fun1_input.src2);
-        mul_fun2_input = mul_fun1_input;
-        mul_fun1_input = nop;
+  if((strcmp(cpu->mul_fun1_input.opcode, "nop"))){
+    if (!(strcmp(cpu->mul_fun2_input.opcode, "nop"))){
+        trace(TRACE_STAGE, "\n Instruction at MUL1_FU_STAGE ---> \t\t %s P%d P%d P%d", cpu->mul_fun1_input.opcode, cpu->mul_fun1_input.dest, cpu->mul_fun1_input.src1, cpu->mul_fun1_input.src2);
+        cpu->mul_fun2_input = cpu->mul_fun1_input;
+        cpu->mul_fun1_input = nop;
       }
     else
-      printf("\n Instruction at MUL1_FU_STAGE ---> \t\t %s P%d P%d P%d stalled", mul_fun1_input.opcode, mul_fun1_input.dest, mul_fun1_input.src1, mul_fun1_input.src2);
+      trace(TRACE_STAGE, "\n Instruction at MUL1_FU_STAGE ---> \t\t %s P%d P%d P%d stalled", cpu->mul_fun1_input.opcode, cpu->mul_fun1_input.dest, cpu->mul_fun1_input.src1, cpu->mul_fun1_input.src2);
   }
 }
 
-void mul2(){
-  if((strcmp(mul_fun2_input.opcode, "nop")))
+void mul2(APEX_OOO_CPU *cpu){
+  if((strcmp(cpu->mul_fun2_input.opcode, "nop")))
   {
-      if (!(strcmp(mul_fun3_input.opcode, "nop")))
+      if (!(strcmp(cpu->mul_fun3_input.opcode, "nop")))
       {
-        printf("\n Instruction at MUL2_FU_STAGE ---> \t %s P%d P%d P%d", mul_fun2_input.opcode, mul_fun2_input.dest, mul_fun2_input.src1, mul_fun2_input.src2);
-        mul_fun3_input = mul_fun2_input;
-        mul_fun2_input = nop;
+        trace(TRACE_STAGE, "\n Instruction at MUL2_FU_STAGE ---> \t %s P%d P%d P%d", cpu->mul_fun2_input.opcode, cpu->mul_fun2_input.dest, cpu->mul_fun2_input.src1, cpu->mul_fun2_input.src2);
+        cpu->mul_fun3_input = cpu->mul_fun2_input;
+        cpu->mul_fun2_input = nop;
       }
       else
-        printf("\n Instruction at MUL2_FU_STAGE ---> \t %s P%d P%d P%d stalled", mul_fun2_input.opcode, mul_fun2_input.dest, mul_fun2_input.src1, mul_fun2_input.src2);
+        trace(TRACE_STAGE, "\n Instruction at MUL2_FU_STAGE ---> \t %s P%d P%d P%d stalled", cpu->mul_fun2_input.opcode, cpu->mul_fun2_input.dest, cpu->mul_fun2_input.src1, cpu->mul_fun2_input.src2);
   }
 }
 
-void mul3(){
-  if((strcmp(mul_fun3_input.opcode, "nop")))
+void mul3(APEX_OOO_CPU *cpu){
+  if((strcmp(cpu->mul_fun3_input.opcode, "nop")))
   {
       //printf("I am in mul 3 \n");
-      printf("\n Instruction at MUL3_FU_STAGE ---> \t %s P%d P%d P%d", mul_fun3_input.opcode, mul_fun3_input.dest, mul_fun3_input.src1, mul_fun3_input.src2);
-      mul_fun3_input.result = physical_Reg_File[mul_fun3_input.src1].value * physical_Reg_File[mul_fun3_input.src2].value;
+      trace(TRACE_STAGE, "\n Instruction at MUL3_FU_STAGE ---> \t %s P%d P%d P%d", cpu->mul_fun3_input.opcode, cpu->mul_fun3_input.dest, cpu->mul_fun3_input.src1, cpu->mul_fun3_input.src2);
+      cpu->mul_fun3_input.result = cpu->physical_Reg_File[cpu->mul_fun3_input.src1].value * cpu->physical_Reg_File[cpu->mul_fun3_input.src2].value;
 
-      physical_Reg_File[mul_fun3_input.dest].status = VALID;
-      physical_Reg_File[mul_fun3_input.dest].value = mul_fun3_input.result;
-      lst_arithm_instruction = mul_fun3_input.id;
-      lst_arithm_resultset = mul_fun3_input.result;
+      cpu->physical_Reg_File[cpu->mul_fun3_input.dest].status = VALID;
+      cpu->physical_Reg_File[cpu->mul_fun3_input.dest].value = cpu->mul_fun3_input.result;
+      cpu->lst_arithm_instruction = cpu->mul_fun3_input.id;
+      cpu->lst_arithm_resultset = cpu->mul_fun3_input.result;
       //printf("architecture register  update %ld \n", lst_arithm_resultset);
       //Forward the result to rob entry using instruction id
-      for (int i = 0; i != 12; i++)
+      for (int i = 0; i != cpu->rob_size; i++)
       {
-          if(rob[i].id == mul_fun3_input.id)
+          if(cpu->rob[i].id == cpu->mul_fun3_input.id)
           {
-              rob[i].result = mul_fun3_input.result;
-              rob[i].status = VALID;
+              cpu->rob[i].result = cpu->mul_fun3_input.result;
+              cpu->rob[i].status = VALID;
               //printf(" status of ROB %d\n", rob[i].status);
           }
       }
-      mul_fun3_input = nop;
-      if (!(strcmp(mul_fun2_input.opcode, "nop")))
-          mflag = 0;
+      cpu->mul_fun3_input = nop;
+      if (!(strcmp(cpu->mul_fun2_input.opcode, "nop")))
+          cpu->mflag = 0;
   }
 }
 
-void intialize(){
+void intialize(APEX_OOO_CPU *cpu){
   for (int i = 0; i < 16; i++)
   {
-      arch_Reg_File[i].status = VALID;
-      arch_Reg_File[i].value = 0;
-      arch_Reg_File[i].ins_id = 0;
+      cpu->arch_Reg_File[i].status = VALID;
+      cpu->arch_Reg_File[i].value = 0;
+      cpu->arch_Reg_File[i].ins_id = 0;
   }
-  for (int i = 0; i < 24; i++)
+  for (int i = 0; i < cpu->prf_size; i++)
+  {
+      cpu->physical_Reg_File[i].value = 0;
+      cpu->physical_Reg_File[i].ins_id = -1;
+      cpu->physical_Reg_File[i].status = 0;
+      cpu->physical_Reg_File[i].busy = 0;
+      cpu->physical_Reg_File[i].old_instance = 0;
+  }
+  memset(cpu->prf_free, 0, sizeof(cpu->prf_free));
+  for (int i = 0; i < cpu->prf_size; i++)
+      cpu->prf_free[i / 64] |= (uint64_t)1 << (i % 64);
+  cpu->prf_free_count = cpu->prf_size;
+  for (int i = 0; i < 16; i++)
   {
-      physical_Reg_File[i].value = 0;
-      physical_Reg_File[i].ins_id = -1;
-      physical_Reg_File[i].status = 0;
-      physical_Reg_File[i].busy = 0;
-      physical_Reg_File[i].old_instance = 0;
+      cpu->rename_table[i] = -1;
+      cpu->committed_rename_table[i] = -1;
   }
-  for (int i = 0; i < 12; i++)
+  for (int i = 0; i < cpu->iq_size; i++)
   {
-      iqueue[i] = nop;
+      cpu->iqueue[i] = nop;
   }
-  for (int i = 0; i < 12; i++)
+  for (int i = 0; i < cpu->rob_size; i++)
   {
-      rob[i] = nop;
+      cpu->rob[i] = nop;
   }
-  for (int i = 0; i < 6; i++)
+  for (int i = 0; i < cpu->lsq_size; i++)
   {
-      lsq[i] = nop;
+      cpu->lsq[i] = nop;
   }
 }
 
-void display(){
+void display(APEX_OOO_CPU *cpu){
   printf("\n---------Architecture Register File-----------\n");
   for(int i =0; i<=15; i++)
   {
-      printf("R%d = %ld \n", i, arch_Reg_File[i].value);
+      printf("R%d = %ld \n", i, cpu->arch_Reg_File[i].value);
   }
   printf("\n---------Physical Register File-----------\n");
-  for(int i =0; i<=23; i++)
+  for(int i =0; i < cpu->prf_size; i++)
   {
-      printf("P%d = %ld \n", i, physical_Reg_File[i].value);
+      printf("P%d = %ld \n", i, cpu->physical_Reg_File[i].value);
   }
   printf("\n---------Data Memory-------------\n");
   for(int i =0; i < 25; i++)
   {
-      printf("data_mem[%d] = %ld \n", i*4, data_Memory[i]);
+      printf("data_mem[%d] = %ld \n", i*4, cpu->data_Memory[i]);
   }
 
 }
 
-int prf_available(){
-  for (int i = 0; i < 24;)
-  {
-      if (physical_Reg_File[i].busy == 0)
-          return 1;
-      else
-          i++;
-  }
-  return 0;
+//Returns 1 if a physical register is free to rename into
+int prf_available(APEX_OOO_CPU *cpu){
+    return cpu->prf_free_count > 0;
 }
 
-int find_new_prf(){
-  for (int i = 0; i < 24;)
-  {
-      if (physical_Reg_File[i].busy == 0)
-      {
-          return i;
-      }
-      else {
-          i++;
-      }
-  }
-  return -1;
+//Takes the lowest numbered free physical register off the free list,
+//returns -1 if every one is busy
+int find_new_prf(APEX_OOO_CPU *cpu){
+    for (int w = 0; w < (cpu->prf_size + 63) / 64; w++){
+        if (cpu->prf_free[w]){
+            int i = w * 64 + __builtin_ctzll(cpu->prf_free[w]);
+            cpu->prf_free[w] &= cpu->prf_free[w] - 1;
+            cpu->prf_free_count--;
+            return i;
+        }
+    }
+    return -1;
 }
 
-int find_existing_prf(int p, int q){
-    for (int i = 0; i < 24; )
-    {
-      if ((physical_Reg_File[i].arf_id == p) && (physical_Reg_File[i].busy == 1) && (physical_Reg_File[i].old_instance == 0)){
-          physical_Reg_File[i].ins_id = q;
-          return i;
-      }
-      else
-          i++;
+//Puts physical register p back on the free list, the ROB calls this as
+//the last reader of a superseded mapping commits
+void free_prf(APEX_OOO_CPU *cpu, int p){
+    cpu->physical_Reg_File[p].busy = 0;
+    cpu->physical_Reg_File[p].old_instance = 0;
+    cpu->prf_free[p / 64] |= (uint64_t)1 << (p % 64);
+    cpu->prf_free_count++;
+}
+
+//Renames destination register r of instruction id into a free physical
+//register. The one r mapped to so far is superseded, the ROB frees it as
+//its last reader commits.
+int rename_dest(APEX_OOO_CPU *cpu, int r, int id){
+    int p = find_new_prf(cpu);
+    if (r >= 0 && r < 16){
+        if (cpu->rename_table[r] >= 0)
+            cpu->physical_Reg_File[cpu->rename_table[r]].old_instance = 1;
+        cpu->rename_table[r] = p;
     }
-    return -1;
+    cpu->physical_Reg_File[p].status = INVALID;
+    cpu->physical_Reg_File[p].ins_id = id;
+    cpu->physical_Reg_File[p].busy = 1;
+    cpu->physical_Reg_File[p].arf_id = r;
+    return p;
 }
 
-void old_instance_prf(int p){
-  for (int i = 0; i < 24; )
-  {
-      if ((physical_Reg_File[i].arf_id == p) && (physical_Reg_File[i].busy == 1))
-      {
-          physical_Reg_File[i].old_instance = 1;
-          break;
-      }
-      else
-          i++;
-  }
+//Renames source register r of instruction id with one rename table read,
+//-1 if r has not been written yet. Instruction id becomes the last reader
+//of the physical register, kept in its ins_id for the ROB.
+int rename_source(APEX_OOO_CPU *cpu, int r, int id){
+    if (r < 0 || r >= 16 || cpu->rename_table[r] < 0)
+        return -1;
+    cpu->physical_Reg_File[cpu->rename_table[r]].ins_id = id;
+    return cpu->rename_table[r];
+}
+
+//Rolls the rename table back to the committed mapping once the younger
+//writers are squashed and their registers freed. A squashed writer may
+//have superseded a committed mapping, which is live again. If its last
+//reader has committed since, the register was freed, so it is taken back
+//with the committed value from the architectural register file.
+void rename_restore(APEX_OOO_CPU *cpu){
+    memcpy(cpu->rename_table, cpu->committed_rename_table, sizeof(cpu->rename_table));
+    for (int r = 0; r < 16; r++){
+        int p = cpu->rename_table[r];
+        if (p < 0)
+            continue;
+        if (cpu->prf_free[p / 64] & ((uint64_t)1 << (p % 64))){
+            cpu->prf_free[p / 64] &= ~((uint64_t)1 << (p % 64));
+            cpu->prf_free_count--;
+            cpu->physical_Reg_File[p].value = cpu->arch_Reg_File[r].value;
+            cpu->physical_Reg_File[p].status = VALID;
+            cpu->physical_Reg_File[p].busy = 1;
+            cpu->physical_Reg_File[p].arf_id = r;
+        }
+        cpu->physical_Reg_File[p].old_instance = 0;
+    }
 }
 
 
-void iq(){
+void iq(APEX_OOO_CPU *cpu){
 
-    if((strcmp(iqueue[iq_rem_index].opcode, "nop"))){
-        if(!(strcmp(int_fun1_input.opcode, "nop"))){
-            if(!(strcmp(iqueue[iq_rem_index].opcode, "MOVC"))){
-                printf("\n Details of IQ (Issue Queue) State –>  \t %s P%d %d", iqueue[iq_rem_index].opcode, iqueue[iq_rem_index].dest, iqueue[iq_rem_index].literal);
-                int_fun1_input = iqueue[iq_rem_index];
+    if((strcmp(cpu->iqueue[cpu->iq_rem_index].opcode, "nop"))){
+        if(!(strcmp(cpu->int_fun1_input.opcode, "nop"))){
+            if(!(strcmp(cpu->iqueue[cpu->iq_rem_index].opcode, "MOVC"))){
+                trace(TRACE_STAGE, "\n Details of IQ (Issue Queue) State –>  \t %s P%d %d", cpu->iqueue[cpu->iq_rem_index].opcode, cpu->iqueue[cpu->iq_rem_index].dest, cpu->iqueue[cpu->iq_rem_index].literal);
+                cpu->int_fun1_input = cpu->iqueue[cpu->iq_rem_index];
                 //printf("\nshantanu %s", int_fun1_input.opcode);
-                iqueue[iq_rem_index] = nop;
-                iq_rem_index++;
+                cpu->iqueue[cpu->iq_rem_index] = nop;
+                cpu->iq_rem_index++;
             }
-            else if(!(strcmp(iqueue[iq_rem_index].opcode, "ADD"))){
-                printf("\n Details of IQ (Issue Queue) State –>  \t %s P%d P%d P%d", iqueue[iq_rem_index].opcode, iqueue[iq_rem_index].dest, iqueue[iq_rem_index].src1, iqueue[iq_rem_index].src2);
-                if (physical_Reg_File[iqueue[iq_rem_index].src1].status == VALID && physical_Reg_File[iqueue[iq_rem_index].src2].status == VALID){
-                    lst_arithm_index = iqueue[iq_rem_index].id;
-                    int_fun1_input = iqueue[iq_rem_index];
-                    iqueue[iq_rem_index] = nop;
-                    iq_rem_index++;
+            else if(!(strcmp(cpu->iqueue[cpu->iq_rem_index].opcode, "ADD"))){
+                trace(TRACE_STAGE, "\n Details of IQ (Issue Queue) State –>  \t %s P%d P%d P%d", cpu->iqueue[cpu->iq_rem_index].opcode, cpu->iqueue[cpu->iq_rem_index].dest, cpu->iqueue[cpu->iq_rem_index].src1, cpu->iqueue[cpu->iq_rem_index].src2);
+                if (cpu->physical_Reg_File[cpu->iqueue[cpu->iq_rem_index].src1].status == VALID && cpu->physical_Reg_File[cpu->iqueue[cpu->iq_rem_index].src2].status == VALID){
+                    cpu->lst_arithm_index = cpu->iqueue[cpu->iq_rem_index].id;
+                    cpu->int_fun1_input = cpu->iqueue[cpu->iq_rem_index];
+                    cpu->iqueue[cpu->iq_rem_index] = nop;
+                    cpu->iq_rem_index++;
                 }
             }
-            else if(!(strcmp(iqueue[iq_rem_index].opcode, "SUB"))){
-
-                printf("\n Details of IQ (Issue Queue) State –> \t %s P%d P%d P%d", iqueue[iq_rem_index].opcode, iqueue[iq_rem_index].dest, iqueue[iq_rem_index].src1, iqueue[iq_rem_index].src2);
-                if (physical_Reg_File[iqueue[iq_rem_index].src1].status == VALID && physical_Reg_File[iqueue[iq_rem_index].src2].status == VALID){
-                    lst_arithm_index = iqueue[iq_rem_index].id;
-                    int_fun1_input = iqueue[iq_rem_index];
-                    iqueue[iq_rem_index] = nop;
-                    iq_rem_index++;
+            else if(!(strcmp(cpu->iqueue[cpu->iq_rem_index].opcode, "SUB"))){
+
+                trace(TRACE_STAGE, "\n Details of IQ (Issue Queue) State –> \t %s P%d P%d P%d", cpu->iqueue[cpu->iq_rem_index].opcode, cpu->iqueue[cpu->iq_rem_index].dest, cpu->iqueue[cpu->iq_rem_index].src1, cpu->iqueue[cpu->iq_rem_index].src2);
+                if (cpu->physical_Reg_File[cpu->iqueue[cpu->iq_rem_index].src1].status == VALID && cpu->physical_Reg_File[cpu->iqueue[cpu->iq_rem_index].src2].status == VALID){
+                    cpu->lst_arithm_index = cpu->iqueue[cpu->iq_rem_index].id;
+                    cpu->int_fun1_input = cpu->iqueue[cpu->iq_rem_index];
+                    cpu->iqueue[cpu->iq_rem_index] = nop;
+                    cpu->iq_rem_index++;
                 }
             }
-            else if(!(strcmp(iqueue[iq_rem_index].opcode, "AND"))){
-
-                printf("\n Details of IQ (Issue Queue) State –>  \t %s P%d P%d P%d", iqueue[iq_rem_index].opcode, iqueue[iq_rem_index].dest, iqueue[iq_rem_index].src1, iqueue[iq_rem_index].src2);
-                if (physical_Reg_File[iqueue[iq_rem_index].src1].status == VALID && physical_Reg_File[iqueue[iq_rem_index].src2].status == VALID){
-                    lst_arithm_index = iqueue[iq_rem_index].id;
-                    int_fun1_input = iqueue[iq_rem_index];
-                    iqueue[iq_rem_index] = nop;
-                    iq_rem_index++;
+            else if(!(strcmp(cpu->iqueue[cpu->iq_rem_index].opcode, "AND"))){
+
+                trace(TRACE_STAGE, "\n Details of IQ (Issue Queue) State –>  \t %s P%d P%d P%d", cpu->iqueue[cpu->iq_rem_index].opcode, cpu->iqueue[cpu->iq_rem_index].dest, cpu->iqueue[cpu->iq_rem_index].src1, cpu->iqueue[cpu->iq_rem_index].src2);
+                if (cpu->physical_Reg_File[cpu->iqueue[cpu->iq_rem_index].src1].status == VALID && cpu->physical_Reg_File[cpu->iqueue[cpu->iq_rem_index].src2].status == VALID){
+                    cpu->lst_arithm_index = cpu->iqueue[cpu->iq_rem_index].id;
+                    cpu->int_fun1_input = cpu->iqueue[cpu->iq_rem_index];
+                    cpu->iqueue[cpu->iq_rem_index] = nop;
+                    cpu->iq_rem_index++;
                 }
             }
-            else if(!(strcmp(iqueue[iq_rem_index].opcode, "MUL"))){
-
-                printf("\n Details of IQ (Issue Queue) State –>  \t %s P%d P%d P%d", iqueue[iq_rem_index].opcode, iqueue[iq_rem_index].dest, iqueue[iq_rem_index].src1, iqueue[iq_rem_index].src2);
-                if (physical_Reg_File[iqueue[iq_rem_index].src1].status == VALID && physical_Reg_File[iqueue[iq_rem_index].src2].status == VALID){
-                    lst_arithm_index = iqueue[iq_rem_index].id;
-                    mul_fun1_input = iqueue[iq_rem_index];
-                    iqueue[iq_rem_index] = nop;
-                    iq_rem_index++;
-                    mflag = 1;
+            else if(!(strcmp(cpu->iqueue[cpu->iq_rem_index].opcode, "MUL"))){
+
+                trace(TRACE_STAGE, "\n Details of IQ (Issue Queue) State –>  \t %s P%d P%d P%d", cpu->iqueue[cpu->iq_rem_index].opcode, cpu->iqueue[cpu->iq_rem_index].dest, cpu->iqueue[cpu->iq_rem_index].src1, cpu->iqueue[cpu->iq_rem_index].src2);
+                if (cpu->physical_Reg_File[cpu->iqueue[cpu->iq_rem_index].src1].status == VALID && cpu->physical_Reg_File[cpu->iqueue[cpu->iq_rem_index].src2].status == VALID){
+                    cpu->lst_arithm_index = cpu->iqueue[cpu->iq_rem_index].id;
+                    cpu->mul_fun1_input = cpu->iqueue[cpu->iq_rem_index];
+                    cpu->iqueue[cpu->iq_rem_index] = nop;
+                    cpu->iq_rem_index++;
+                    cpu->mflag = 1;
                   }
               }
-            else if(!(strcmp(iqueue[iq_rem_index].opcode, "LOAD"))){
+            else if(!(strcmp(cpu->iqueue[cpu->iq_rem_index].opcode, "LOAD"))){
                 //printf("I am in IQ for Load \n");
-                if (physical_Reg_File[iqueue[iq_rem_index].src1].status == VALID){
-                    printf("\n IQ      : \t\t %s P%d P%d %d", iqueue[iq_rem_index].opcode, iqueue[iq_rem_index].dest, iqueue[iq_rem_index].src1, iqueue[iq_rem_index].literal);
-                    int_fun1_input = iqueue[iq_rem_index];
-                    iqueue[iq_rem_index] = nop;
-                    iq_rem_index++;
+                if (cpu->physical_Reg_File[cpu->iqueue[cpu->iq_rem_index].src1].status == VALID){
+                    trace(TRACE_STAGE, "\n IQ      : \t\t %s P%d P%d %d", cpu->iqueue[cpu->iq_rem_index].opcode, cpu->iqueue[cpu->iq_rem_index].dest, cpu->iqueue[cpu->iq_rem_index].src1, cpu->iqueue[cpu->iq_rem_index].literal);
+                    cpu->int_fun1_input = cpu->iqueue[cpu->iq_rem_index];
+                    cpu->iqueue[cpu->iq_rem_index] = nop;
+                    cpu->iq_rem_index++;
                 }
             }
-            else if(!(strcmp(iqueue[iq_rem_index].opcode, "STORE"))){
+            else if(!(strcmp(cpu->iqueue[cpu->iq_rem_index].opcode, "STORE"))){
                 //printf("I am in IQ of Store %d \n",physical_Reg_File[iqueue[iq_rem_index].src2].status);
-                if (physical_Reg_File[iqueue[iq_rem_index].src2].status == VALID){
-                    printf("\n Details of IQ (Issue Queue) State –> \t\t %s P%d P%d %d", iqueue[iq_rem_index].opcode, iqueue[iq_rem_index].src1, iqueue[iq_rem_index].src2, iqueue[iq_rem_index].literal);
-                    int_fun1_input = iqueue[iq_rem_index];
-                    iqueue[iq_rem_index] = nop;
-                    iq_rem_index++;
+                if (cpu->physical_Reg_File[cpu->iqueue[cpu->iq_rem_index].src2].status == VALID){
+                    trace(TRACE_STAGE, "\n Details of IQ (Issue Queue) State –> \t\t %s P%d P%d %d", cpu->iqueue[cpu->iq_rem_index].opcode, cpu->iqueue[cpu->iq_rem_index].src1, cpu->iqueue[cpu->iq_rem_index].src2, cpu->iqueue[cpu->iq_rem_index].literal);
+                    cpu->int_fun1_input = cpu->iqueue[cpu->iq_rem_index];
+                    cpu->iqueue[cpu->iq_rem_index] = nop;
+                    cpu->iq_rem_index++;
                 }
             }
-            else if(!(strcmp(iqueue[iq_rem_index].opcode, "ADDL"))){
-                printf("\n Details of IQ (Issue Queue) State –>  \t %s P%d P%d %d", iqueue[iq_rem_index].opcode, iqueue[iq_rem_index].dest, iqueue[iq_rem_index].src1, iqueue[iq_rem_index].literal);
-                if (physical_Reg_File[iqueue[iq_rem_index].src1].status == VALID ){
-                    lst_arithm_index = iqueue[iq_rem_index].id; //compare lst_arithm_index with last_aritmetic_ins(updated in ex), for BRANCH.
-                    int_fun1_input = iqueue[iq_rem_index];
-                    iqueue[iq_rem_index] = nop;
-                    iq_rem_index++;
+            else if(!(strcmp(cpu->iqueue[cpu->iq_rem_index].opcode, "ADDL"))){
+                trace(TRACE_STAGE, "\n Details of IQ (Issue Queue) State –>  \t %s P%d P%d %d", cpu->iqueue[cpu->iq_rem_index].opcode, cpu->iqueue[cpu->iq_rem_index].dest, cpu->iqueue[cpu->iq_rem_index].src1, cpu->iqueue[cpu->iq_rem_index].literal);
+                if (cpu->physical_Reg_File[cpu->iqueue[cpu->iq_rem_index].src1].status == VALID ){
+                    cpu->lst_arithm_index = cpu->iqueue[cpu->iq_rem_index].id; //compare lst_arithm_index with last_aritmetic_ins(updated in ex), for BRANCH.
+                    cpu->int_fun1_input = cpu->iqueue[cpu->iq_rem_index];
+                    cpu->iqueue[cpu->iq_rem_index] = nop;
+                    cpu->iq_rem_index++;
                 }
             }
-            else if(!(strcmp(iqueue[iq_rem_index].opcode, "SUBL"))){
-                printf("\n Details of IQ (Issue Queue) State –>  \t %s P%d P%d %d", iqueue[iq_rem_index].opcode, iqueue[iq_rem_index].dest, iqueue[iq_rem_index].src1, iqueue[iq_rem_index].literal);
-                if (physical_Reg_File[iqueue[iq_rem_index].src1].status == VALID ){
-                    lst_arithm_index = iqueue[iq_rem_index].id;
-                    int_fun1_input = iqueue[iq_rem_index];
-                    iqueue[iq_rem_index] = nop;
-                    iq_rem_index++;
+            else if(!(strcmp(cpu->iqueue[cpu->iq_rem_index].opcode, "SUBL"))){
+                trace(TRACE_STAGE, "\n Details of IQ (Issue Queue) State –>  \t %s P%d P%d %d", cpu->iqueue[cpu->iq_rem_index].opcode, cpu->iqueue[cpu->iq_rem_index].dest, cpu->iqueue[cpu->iq_rem_index].src1, cpu->iqueue[cpu->iq_rem_index].literal);
+                if (cpu->physical_Reg_File[cpu->iqueue[cpu->iq_rem_index].src1].status == VALID ){
+                    cpu->lst_arithm_index = cpu->iqueue[cpu->iq_rem_index].id;
+                    cpu->int_fun1_input = cpu->iqueue[cpu->iq_rem_index];
+                    cpu->iqueue[cpu->iq_rem_index] = nop;
+                    cpu->iq_rem_index++;
                 }
             }
-            else if(!(strcmp(iqueue[iq_rem_index].opcode, "OR"))){
-
-                printf("\n Details of IQ (Issue Queue) State –>  \t %s P%d P%d P%d", iqueue[iq_rem_index].opcode, iqueue[iq_rem_index].dest, iqueue[iq_rem_index].src1, iqueue[iq_rem_index].src2);
-                if (physical_Reg_File[iqueue[iq_rem_index].src1].status == VALID && physical_Reg_File[iqueue[iq_rem_index].src2].status == VALID){
-                    lst_arithm_index = iqueue[iq_rem_index].id;
-                    int_fun1_input = iqueue[iq_rem_index];
-                    iqueue[iq_rem_index] = nop;
-                    iq_rem_index++;
+            else if(!(strcmp(cpu->iqueue[cpu->iq_rem_index].opcode, "OR"))){
+
+                trace(TRACE_STAGE, "\n Details of IQ (Issue Queue) State –>  \t %s P%d P%d P%d", cpu->iqueue[cpu->iq_rem_index].opcode, cpu->iqueue[cpu->iq_rem_index].dest, cpu->iqueue[cpu->iq_rem_index].src1, cpu->iqueue[cpu->iq_rem_index].src2);
+                if (cpu->physical_Reg_File[cpu->iqueue[cpu->iq_rem_index].src1].status == VALID && cpu->physical_Reg_File[cpu->iqueue[cpu->iq_rem_index].src2].status == VALID){
+                    cpu->lst_arithm_index = cpu->iqueue[cpu->iq_rem_index].id;
+                    cpu->int_fun1_input = cpu->iqueue[cpu->iq_rem_index];
+                    cpu->iqueue[cpu->iq_rem_index] = nop;
+                    cpu->iq_rem_index++;
                 }
             }
-            else if(!(strcmp(iqueue[iq_rem_index].opcode, "EX-OR"))){
-
-                printf("\n Details of IQ (Issue Queue) State –>  \t %s P%d P%d P%d", iqueue[iq_rem_index].opcode, iqueue[iq_rem_index].dest, iqueue[iq_rem_index].src1, iqueue[iq_rem_index].src2);
-                if (physical_Reg_File[iqueue[iq_rem_index].src1].status == VALID && physical_Reg_File[iqueue[iq_rem_index].src2].status == VALID){
-                    lst_arithm_index = iqueue[iq_rem_index].id;
-                    int_fun1_input = iqueue[iq_rem_index];
-                    iqueue[iq_rem_index] = nop;
-                    iq_rem_index++;
+            else if(!(strcmp(cpu->iqueue[cpu->iq_rem_index].opcode, "EX-OR"))){
+
+                trace(TRACE_STAGE, "\n Details of IQ (Issue Queue) State –>  \t %s P%d P%d P%d", cpu->iqueue[cpu->iq_rem_index].opcode, cpu->iqueue[cpu->iq_rem_index].dest, cpu->iqueue[cpu->iq_rem_index].src1, cpu->iqueue[cpu->iq_rem_index].src2);
+                if (cpu->physical_Reg_File[cpu->iqueue[cpu->iq_rem_index].src1].status == VALID && cpu->physical_Reg_File[cpu->iqueue[cpu->iq_rem_index].src2].status == VALID){
+                    cpu->lst_arithm_index = cpu->iqueue[cpu->iq_rem_index].id;
+                    cpu->int_fun1_input = cpu->iqueue[cpu->iq_rem_index];
+                    cpu->iqueue[cpu->iq_rem_index] = nop;
+                    cpu->iq_rem_index++;
                 }
             }
-            else if(!(strcmp(iqueue[iq_rem_index].opcode, "JUMP"))){
-
-                printf("\n Details of IQ (Issue Queue) State –>  \t %s P%d %d", iqueue[iq_rem_index].opcode, iqueue[iq_rem_index].src1, iqueue[iq_rem_index].literal);
-                if (physical_Reg_File[iqueue[iq_rem_index].src1].status == VALID){
-                    int_fun1_input = iqueue[iq_rem_index];
-                    iqueue[iq_rem_index] = nop;
-                    iq_rem_index++;
-                    bflag = 1;
+            else if(!(strcmp(cpu->iqueue[cpu->iq_rem_index].opcode, "JUMP"))){
+
+                trace(TRACE_STAGE, "\n Details of IQ (Issue Queue) State –>  \t %s P%d %d", cpu->iqueue[cpu->iq_rem_index].opcode, cpu->iqueue[cpu->iq_rem_index].src1, cpu->iqueue[cpu->iq_rem_index].literal);
+                if (cpu->physical_Reg_File[cpu->iqueue[cpu->iq_rem_index].src1].status == VALID){
+                    cpu->int_fun1_input = cpu->iqueue[cpu->iq_rem_index];
+                    cpu->iqueue[cpu->iq_rem_index] = nop;
+                    cpu->iq_rem_index++;
+                    cpu->bflag = 1;
                 }
             }
-            else if(!(strcmp(iqueue[iq_rem_index].opcode, "BZ"))){
+            else if(!(strcmp(cpu->iqueue[cpu->iq_rem_index].opcode, "BZ"))){
                 //printf("I am in IQ for BZ \n");
-                printf("\n Details of IQ (Issue Queue) State –>  \t %s %d", iqueue[iq_rem_index].opcode, iqueue[iq_rem_index].literal);
-                if (physical_Reg_File[iqueue[iq_rem_index].src1].status == VALID && physical_Reg_File[iqueue[iq_rem_index].src2].status == VALID){
-                    lst_arithm_index = iqueue[iq_rem_index].id;
-                    branch_fun_input = iqueue[iq_rem_index];
-                    iqueue[iq_rem_index] = nop;
-                    iq_rem_index++;
+                trace(TRACE_STAGE, "\n Details of IQ (Issue Queue) State –>  \t %s %d", cpu->iqueue[cpu->iq_rem_index].opcode, cpu->iqueue[cpu->iq_rem_index].literal);
+                if (cpu->physical_Reg_File[cpu->iqueue[cpu->iq_rem_index].src1].status == VALID && cpu->physical_Reg_File[cpu->iqueue[cpu->iq_rem_index].src2].status == VALID){
+                    cpu->lst_arithm_index = cpu->iqueue[cpu->iq_rem_index].id;
+                    cpu->branch_fun_input = cpu->iqueue[cpu->iq_rem_index];
+                    cpu->iqueue[cpu->iq_rem_index] = nop;
+                    cpu->iq_rem_index++;
                 }
             }
 
           }
       }
 
-    if(iq_rem_index > 11){
+    if(cpu->iq_rem_index > cpu->iq_size - 1){
       //printf("I am in IQ when it is full\n");
-        for(int i = 0; i < 12; i++){
+        for(int i = 0; i < cpu->iq_size; i++){
           //printf("\n i m inside loop %s", rob[i].opcode);
-            if((strcmp(rob[i].opcode, "nop"))){
-              iq_rem_index = i;
+            if((strcmp(cpu->rob[i].opcode, "nop"))){
+              cpu->iq_rem_index = i;
               break;
             }
 
         }
     }
 
-    if (iq_add_index == iq_rem_index){
+    if (cpu->iq_add_index == cpu->iq_rem_index){
       //printf("limit of issue \n");
-        if((strcmp(iqueue[iq_rem_index].opcode, "nop"))){
-          iq_full_index = 1;
+        if((strcmp(cpu->iqueue[cpu->iq_rem_index].opcode, "nop"))){
+          cpu->iq_full_index = 1;
         }
     }
 }
 
 
-void LSQ(){
+void LSQ(APEX_OOO_CPU *cpu){
 
-if((strcmp(lsq[lsq_rem_index].opcode, "nop")))
+if((strcmp(cpu->lsq[cpu->lsq_rem_index].opcode, "nop")))
  {
-    if(!(strcmp(memory_input.opcode, "nop")))
+    if(!(strcmp(cpu->memory_input.opcode, "nop")))
     {
-      if(!(strcmp(lsq[lsq_rem_index].opcode, "LOAD")))
+      if(!(strcmp(cpu->lsq[cpu->lsq_rem_index].opcode, "LOAD")))
       {
-          if(lsq[lsq_rem_index].status == VALID)
+          if(cpu->lsq[cpu->lsq_rem_index].status == VALID)
           {
-              printf("\n Details of LSQ (Load-Store Queue) State --> \t %s P%d P%d %d", lsq[lsq_rem_index].opcode, lsq[lsq_rem_index].dest, lsq[lsq_rem_index].src1, lsq[lsq_rem_index].literal);
-              memory_input = lsq[lsq_rem_index];
-              lsq[lsq_rem_index] = nop;
-              lsq_rem_index++;
+              trace(TRACE_STAGE, "\n Details of LSQ (Load-Store Queue) State --> \t %s P%d P%d %d", cpu->lsq[cpu->lsq_rem_index].opcode, cpu->lsq[cpu->lsq_rem_index].dest, cpu->lsq[cpu->lsq_rem_index].src1, cpu->lsq[cpu->lsq_rem_index].literal);
+              cpu->memory_input = cpu->lsq[cpu->lsq_rem_index];
+              cpu->lsq[cpu->lsq_rem_index] = nop;
+              cpu->lsq_rem_index++;
           }
           else
-              printf("\n Details of LSQ (Load-Store Queue) State --> \t %s P%d P%d %d stalled", lsq[lsq_rem_index].opcode, lsq[lsq_rem_index].dest, lsq[lsq_rem_index].src1, lsq[lsq_rem_index].literal);
+              trace(TRACE_STAGE, "\n Details of LSQ (Load-Store Queue) State --> \t %s P%d P%d %d stalled", cpu->lsq[cpu->lsq_rem_index].opcode, cpu->lsq[cpu->lsq_rem_index].dest, cpu->lsq[cpu->lsq_rem_index].src1, cpu->lsq[cpu->lsq_rem_index].literal);
       }
-      else if(!(strcmp(lsq[lsq_rem_index].opcode, "STORE")))
+      else if(!(strcmp(cpu->lsq[cpu->lsq_rem_index].opcode, "STORE")))
       {
             //printf("Status bits : %d %d \n", lsq[lsq_rem_index].status, physical_Reg_File[lsq[lsq_rem_index].src1].status);
-            if(physical_Reg_File[lsq[lsq_rem_index].src1].status == VALID && lsq[lsq_rem_index].status == VALID)
+            if(cpu->physical_Reg_File[cpu->lsq[cpu->lsq_rem_index].src1].status == VALID && cpu->lsq[cpu->lsq_rem_index].status == VALID)
             {
-                printf("\n Details of LSQ (Load-Store Queue) State --> \t %s P%d P%d %d", lsq[lsq_rem_index].opcode, lsq[lsq_rem_index].src1, lsq[lsq_rem_index].src2, lsq[lsq_rem_index].literal);
-                memory_input = lsq[lsq_rem_index];
-                lsq[lsq_rem_index] = nop;
-                lsq_rem_index++;
+                trace(TRACE_STAGE, "\n Details of LSQ (Load-Store Queue) State --> \t %s P%d P%d %d", cpu->lsq[cpu->lsq_rem_index].opcode, cpu->lsq[cpu->lsq_rem_index].src1, cpu->lsq[cpu->lsq_rem_index].src2, cpu->lsq[cpu->lsq_rem_index].literal);
+                cpu->memory_input = cpu->lsq[cpu->lsq_rem_index];
+                cpu->lsq[cpu->lsq_rem_index] = nop;
+                cpu->lsq_rem_index++;
             }
             else
-                printf("\n Details of LSQ (Load-Store Queue) State --> \t %s P%d P%d %d stalled", lsq[lsq_rem_index].opcode, lsq[lsq_rem_index].src1, lsq[lsq_rem_index].src2, lsq[lsq_rem_index].literal);
+                trace(TRACE_STAGE, "\n Details of LSQ (Load-Store Queue) State --> \t %s P%d P%d %d stalled", cpu->lsq[cpu->lsq_rem_index].opcode, cpu->lsq[cpu->lsq_rem_index].src1, cpu->lsq[cpu->lsq_rem_index].src2, cpu->lsq[cpu->lsq_rem_index].literal);
         }
     }
  }
-  if (lsq_rem_index > 5)
+  if (cpu->lsq_rem_index > cpu->lsq_size - 1)
   {
-      lsq_rem_index = 0;
+      cpu->lsq_rem_index = 0;
   }
-  if (lsq_add_index == lsq_rem_index)
+  if (cpu->lsq_add_index == cpu->lsq_rem_index)
   {
-      if((strcmp(lsq[lsq_add_index].opcode, "nop")))
-          lsq_full_index = 1;
+      if((strcmp(cpu->lsq[cpu->lsq_add_index].opcode, "nop")))
+          cpu->lsq_full_index = 1;
   }
 }
 
 
-void ROB(){
-  int i = rob_com_index;
+void ROB(APEX_OOO_CPU *cpu){
+  int i = cpu->rob_com_index;
   //printf("\n");
   //printf("kumudini ROB %d : %s: %d\n", i, rob[i].opcode, rob[i].status);
-  if((strcmp(rob[i].opcode, "nop")))
+  if((strcmp(cpu->rob[i].opcode, "nop")))
   {
     //printf("index %d \n", i);
-      if(!(strcmp(rob[i].opcode, "MOVC"))){
-          printf("\n Details of ROB  State --> \t\t  %s R%d %d", rob[i].opcode, rob[i].dest, rob[i].literal);
-          if (rob[i].status == VALID)
+      if(!(strcmp(cpu->rob[i].opcode, "MOVC"))){
+          trace(TRACE_COMMIT, "\n Details of ROB  State --> \t\t  %s R%d %d", cpu->rob[i].opcode, cpu->rob[i].dest, cpu->rob[i].literal);
+          if (cpu->rob[i].status == VALID)
           {
               //printf("I m in ROB move for %d\n", i);
-              arch_Reg_File[rob[i].dest].value = rob[i].result;
-              rob_com_index++;
-              rob[i] = nop;
+              cpu->arch_Reg_File[cpu->rob[i].dest].value = cpu->rob[i].result;
+              cpu->committed_rename_table[cpu->rob[i].dest] = cpu->rob[i].phys_dest;
+              cpu->rob_com_index++;
+              cpu->committed++;
+              cpu->rob[i] = nop;
           }
       }
-      else if(!(strcmp(rob[i].opcode, "ADD"))){
-          printf("\n Details of ROB  State --> \t\t %s R%d P%d P%d", rob[i].opcode, rob[i].dest, rob[i].src1, rob[i].src2);
-          if (rob[i].status == VALID){
-              arch_Reg_File[rob[i].dest].value = rob[i].result;
-              if (physical_Reg_File[rob[i].src1].ins_id == rob[i].id && physical_Reg_File[rob[i].src1].old_instance == 1){
-                  physical_Reg_File[rob[i].src1].busy = 0;
-                  physical_Reg_File[rob[i].src1].old_instance = 0;
+      else if(!(strcmp(cpu->rob[i].opcode, "ADD"))){
+          trace(TRACE_COMMIT, "\n Details of ROB  State --> \t\t %s R%d P%d P%d", cpu->rob[i].opcode, cpu->rob[i].dest, cpu->rob[i].src1, cpu->rob[i].src2);
+          if (cpu->rob[i].status == VALID){
+              cpu->arch_Reg_File[cpu->rob[i].dest].value = cpu->rob[i].result;
+              cpu->committed_rename_table[cpu->rob[i].dest] = cpu->rob[i].phys_dest;
+              if (cpu->physical_Reg_File[cpu->rob[i].src1].ins_id == cpu->rob[i].id && cpu->physical_Reg_File[cpu->rob[i].src1].old_instance == 1){
+                  free_prf(cpu, cpu->rob[i].src1);
               }
-              if (physical_Reg_File[rob[i].src2].ins_id == rob[i].id && physical_Reg_File[rob[i].src2].old_instance == 1){
-                  physical_Reg_File[rob[i].src2].busy = 0;
-                  physical_Reg_File[rob[i].src2].old_instance = 0;
+              if (cpu->physical_Reg_File[cpu->rob[i].src2].ins_id == cpu->rob[i].id && cpu->physical_Reg_File[cpu->rob[i].src2].old_instance == 1){
+                  free_prf(cpu, cpu->rob[i].src2);
               }
-              rob_com_index++;
-              rob[i] = nop;
+              cpu->rob_com_index++;
+              cpu->committed++;
+              cpu->rob[i] = nop;
           }
       }
-      else if(!(strcmp(rob[i].opcode, "SUB"))){
-          printf("\n Details of ROB  State --> \t\t %s R%d P%d P%d", rob[i].opcode, rob[i].dest, rob[i].src1, rob[i].src2);
-          if (rob[i].status == VALID){
-              arch_Reg_File[rob[i].dest].value = rob[i].result;
-              if (physical_Reg_File[rob[i].src1].ins_id == rob[i].id && physical_Reg_File[rob[i].src1].old_instance == 1){
-                  physical_Reg_File[rob[i].src1].busy = 0;
-                  physical_Reg_File[rob[i].src1].old_instance = 0;
+      else if(!(strcmp(cpu->rob[i].opcode, "SUB"))){
+          trace(TRACE_COMMIT, "\n Details of ROB  State --> \t\t %s R%d P%d P%d", cpu->rob[i].opcode, cpu->rob[i].dest, cpu->rob[i].src1, cpu->rob[i].src2);
+          if (cpu->rob[i].status == VALID){
+              cpu->arch_Reg_File[cpu->rob[i].dest].value = cpu->rob[i].result;
+              cpu->committed_rename_table[cpu->rob[i].dest] = cpu->rob[i].phys_dest;
+              if (cpu->physical_Reg_File[cpu->rob[i].src1].ins_id == cpu->rob[i].id && cpu->physical_Reg_File[cpu->rob[i].src1].old_instance == 1){
+                  free_prf(cpu, cpu->rob[i].src1);
               }
-              if (physical_Reg_File[rob[i].src2].ins_id == rob[i].id && physical_Reg_File[rob[i].src2].old_instance == 1){
-                  physical_Reg_File[rob[i].src2].busy = 0;
-                  physical_Reg_File[rob[i].src2].old_instance = 0;
+              if (cpu->physical_Reg_File[cpu->rob[i].src2].ins_id == cpu->rob[i].id && cpu->physical_Reg_File[cpu->rob[i].src2].old_instance == 1){
+                  free_prf(cpu, cpu->rob[i].src2);
               }
-              rob_com_index++;
-              rob[i] = nop;
+              cpu->rob_com_index++;
+              cpu->committed++;
+              cpu->rob[i] = nop;
           }
       }
-      else if(!(strcmp(rob[i].opcode, "AND"))){
-          printf("\n Details of ROB  State --> \t\t %s R%d P%d P%d", rob[i].opcode, rob[i].dest, rob[i].src1, rob[i].src2);
-          if (rob[i].status == VALID){
-              arch_Reg_File[rob[i].dest].value = rob[i].result;
-              if (physical_Reg_File[rob[i].src1].ins_id == rob[i].id && physical_Reg_File[rob[i].src1].old_instance == 1){
-                  physical_Reg_File[rob[i].src1].busy = 0;
-                  physical_Reg_File[rob[i].src1].old_instance = 0;
+      else if(!(strcmp(cpu->rob[i].opcode, "AND"))){
+          trace(TRACE_COMMIT, "\n Details of ROB  State --> \t\t %s R%d P%d P%d", cpu->rob[i].opcode, cpu->rob[i].dest, cpu->rob[i].src1, cpu->rob[i].src2);
+          if (cpu->rob[i].status == VALID){
+              cpu->arch_Reg_File[cpu->rob[i].dest].value = cpu->rob[i].result;
+              cpu->committed_rename_table[cpu->rob[i].dest] = cpu->rob[i].phys_dest;
+              if (cpu->physical_Reg_File[cpu->rob[i].src1].ins_id == cpu->rob[i].id && cpu->physical_Reg_File[cpu->rob[i].src1].old_instance == 1){
+                  free_prf(cpu, cpu->rob[i].src1);
               }
-              if (physical_Reg_File[rob[i].src2].ins_id == rob[i].id && physical_Reg_File[rob[i].src2].old_instance == 1){
-                  physical_Reg_File[rob[i].src2].busy = 0;
-                  physical_Reg_File[rob[i].src2].old_instance = 0;
+              if (cpu->physical_Reg_File[cpu->rob[i].src2].ins_id == cpu->rob[i].id && cpu->physical_Reg_File[cpu->rob[i].src2].old_instance == 1){
+                  free_prf(cpu, cpu->rob[i].src2);
               }
-              rob_com_index++;
-              rob[i] = nop;
+              cpu->rob_com_index++;
+              cpu->committed++;
+              cpu->rob[i] = nop;
           }
       }
-      else if(!(strcmp(rob[i].opcode, "MUL"))){
-          printf("\n Details of ROB  State --> \t\t %s R%d P%d P%d", rob[i].opcode, rob[i].dest, rob[i].src1, rob[i].src2);
-          if (rob[i].status == VALID){
-              arch_Reg_File[rob[i].dest].value = rob[i].result;
+      else if(!(strcmp(cpu->rob[i].opcode, "MUL"))){
+          trace(TRACE_COMMIT, "\n Details of ROB  State --> \t\t %s R%d P%d P%d", cpu->rob[i].opcode, cpu->rob[i].dest, cpu->rob[i].src1, cpu->rob[i].src2);
+          if (cpu->rob[i].status == VALID){
+              cpu->arch_Reg_File[cpu->rob[i].dest].value = cpu->rob[i].result;
+              cpu->committed_rename_table[cpu->rob[i].dest] = cpu->rob[i].phys_dest;
               //printf("IN ROB FOR archi regist %ld \n", arch_Reg_File[rob[i].dest].value);
-              if (physical_Reg_File[rob[i].src1].ins_id == rob[i].id && physical_Reg_File[rob[i].src1].old_instance == 1){
-                  physical_Reg_File[rob[i].src1].busy = 0;
-                  physical_Reg_File[rob[i].src1].old_instance = 0;
+              if (cpu->physical_Reg_File[cpu->rob[i].src1].ins_id == cpu->rob[i].id && cpu->physical_Reg_File[cpu->rob[i].src1].old_instance == 1){
+                  free_prf(cpu, cpu->rob[i].src1);
               }
-              if (physical_Reg_File[rob[i].src2].ins_id == rob[i].id && physical_Reg_File[rob[i].src2].old_instance == 1){
-                  physical_Reg_File[rob[i].src2].busy = 0;
-                  physical_Reg_File[rob[i].src2].old_instance = 0;
+              if (cpu->physical_Reg_File[cpu->rob[i].src2].ins_id == cpu->rob[i].id && cpu->physical_Reg_File[cpu->rob[i].src2].old_instance == 1){
+                  free_prf(cpu, cpu->rob[i].src2);
               }
-              rob_com_index++;
-              rob[i] = nop;
+              cpu->rob_com_index++;
+              cpu->committed++;
+              cpu->rob[i] = nop;
           }
       }
-      else if(!(strcmp(rob[i].opcode, "LOAD"))){
-          if (rob[i].status == VALID){
-              printf("\n Details of ROB  State --> \t\t %s R%d P%d %d", rob[i].opcode, rob[i].dest, rob[i].src1, rob[i].literal);
-              arch_Reg_File[rob[i].dest].value = rob[i].result;
-              if (physical_Reg_File[rob[i].src1].ins_id == rob[i].id && physical_Reg_File[rob[i].src1].old_instance == 1){
-                  physical_Reg_File[rob[i].src1].busy = 0;
-                  physical_Reg_File[rob[i].src1].old_instance = 0;
+      else if(!(strcmp(cpu->rob[i].opcode, "LOAD"))){
+          if (cpu->rob[i].status == VALID){
+              trace(TRACE_COMMIT, "\n Details of ROB  State --> \t\t %s R%d P%d %d", cpu->rob[i].opcode, cpu->rob[i].dest, cpu->rob[i].src1, cpu->rob[i].literal);
+              cpu->arch_Reg_File[cpu->rob[i].dest].value = cpu->rob[i].result;
+              cpu->committed_rename_table[cpu->rob[i].dest] = cpu->rob[i].phys_dest;
+              if (cpu->physical_Reg_File[cpu->rob[i].src1].ins_id == cpu->rob[i].id && cpu->physical_Reg_File[cpu->rob[i].src1].old_instance == 1){
+                  free_prf(cpu, cpu->rob[i].src1);
               }
-              rob_com_index++;
-              rob[i] = nop;
+              cpu->rob_com_index++;
+              cpu->committed++;
+              cpu->rob[i] = nop;
           }
       }
-      else if(!(strcmp(rob[i].opcode, "STORE"))){
-          printf("\n Details of ROB  State --> \t\t %s R%d P%d %d", rob[i].opcode, rob[i].src1, rob[i].src2, rob[i].literal);
-          if (rob[i].status == VALID){
-              if (physical_Reg_File[rob[i].src1].ins_id == rob[i].id && physical_Reg_File[rob[i].src1].old_instance == 1){
-                  physical_Reg_File[rob[i].src1].busy = 0;
-                  physical_Reg_File[rob[i].src1].old_instance = 0;
+      else if(!(strcmp(cpu->rob[i].opcode, "STORE"))){
+          trace(TRACE_COMMIT, "\n Details of ROB  State --> \t\t %s R%d P%d %d", cpu->rob[i].opcode, cpu->rob[i].src1, cpu->rob[i].src2, cpu->rob[i].literal);
+          if (cpu->rob[i].status == VALID){
+              if (cpu->physical_Reg_File[cpu->rob[i].src1].ins_id == cpu->rob[i].id && cpu->physical_Reg_File[cpu->rob[i].src1].old_instance == 1){
+                  free_prf(cpu, cpu->rob[i].src1);
               }
-              if (physical_Reg_File[rob[i].src2].ins_id == rob[i].id && physical_Reg_File[rob[i].src2].old_instance == 1){
-                  physical_Reg_File[rob[i].src2].busy = 0;
-                  physical_Reg_File[rob[i].src2].old_instance = 0;
+              if (cpu->physical_Reg_File[cpu->rob[i].src2].ins_id == cpu->rob[i].id && cpu->physical_Reg_File[cpu->rob[i].src2].old_instance == 1){
+                  free_prf(cpu, cpu->rob[i].src2);
               }
-              rob_com_index++;
-              rob[i] = nop;
+              cpu->rob_com_index++;
+              cpu->committed++;
+              cpu->rob[i] = nop;
           }
       }
-      else if(!(strcmp(rob[i].opcode, "ADDL"))){
-          printf("\n Details of ROB  State --> \t\t %s R%d P%d %d", rob[i].opcode, rob[i].dest, rob[i].src1, rob[i].literal);
-          if (rob[i].status == VALID){
-              arch_Reg_File[rob[i].dest].value = rob[i].result;
-              if (physical_Reg_File[rob[i].src1].ins_id == rob[i].id && physical_Reg_File[rob[i].src1].old_instance == 1){
-                  physical_Reg_File[rob[i].src1].busy = 0;
-                  physical_Reg_File[rob[i].src1].old_instance = 0;
+      else if(!(strcmp(cpu->rob[i].opcode, "ADDL"))){
+          trace(TRACE_COMMIT, "\n Details of ROB  State --> \t\t %s R%d P%d %d", cpu->rob[i].opcode, cpu->rob[i].dest, cpu->rob[i].src1, cpu->rob[i].literal);
+          if (cpu->rob[i].status == VALID){
+              cpu->arch_Reg_File[cpu->rob[i].dest].value = cpu->rob[i].result;
+              cpu->committed_rename_table[cpu->rob[i].dest] = cpu->rob[i].phys_dest;
+              if (cpu->physical_Reg_File[cpu->rob[i].src1].ins_id == cpu->rob[i].id && cpu->physical_Reg_File[cpu->rob[i].src1].old_instance == 1){
+                  free_prf(cpu, cpu->rob[i].src1);
               }
-              rob_com_index++;
-              rob[i] = nop;
+              cpu->rob_com_index++;
+              cpu->committed++;
+              cpu->rob[i] = nop;
           }
       }
-      else if(!(strcmp(rob[i].opcode, "SUBL"))){
-          printf("\n Details of ROB  State --> \t\t %s R%d P%d %d", rob[i].opcode, rob[i].dest, rob[i].src1, rob[i].literal);
-          if (rob[i].status == VALID){
-              arch_Reg_File[rob[i].dest].value = rob[i].result;
-              if (physical_Reg_File[rob[i].src1].ins_id == rob[i].id && physical_Reg_File[rob[i].src1].old_instance == 1){
-                  physical_Reg_File[rob[i].src1].busy = 0;
-                  physical_Reg_File[rob[i].src1].old_instance = 0;
+      else if(!(strcmp(cpu->rob[i].opcode, "SUBL"))){
+          trace(TRACE_COMMIT, "\n Details of ROB  State --> \t\t %s R%d P%d %d", cpu->rob[i].opcode, cpu->rob[i].dest, cpu->rob[i].src1, cpu->rob[i].literal);
+          if (cpu->rob[i].status == VALID){
+              cpu->arch_Reg_File[cpu->rob[i].dest].value = cpu->rob[i].result;
+              cpu->committed_rename_table[cpu->rob[i].dest] = cpu->rob[i].phys_dest;
+              if (cpu->physical_Reg_File[cpu->rob[i].src1].ins_id == cpu->rob[i].id && cpu->physical_Reg_File[cpu->rob[i].src1].old_instance == 1){
+                  free_prf(cpu, cpu->rob[i].src1);
               }
-              rob_com_index++;
-              rob[i] = nop;
+              cpu->rob_com_index++;
+              cpu->committed++;
+              cpu->rob[i] = nop;
           }
       }
-      else if(!(strcmp(rob[i].opcode, "OR"))){
-          printf("\n Details of ROB  State --> \t\t %s R%d P%d P%d", rob[i].opcode, rob[i].dest, rob[i].src1, rob[i].src2);
-          if (rob[i].status == VALID){
-              arch_Reg_File[rob[i].dest].value = rob[i].result;
-              if (physical_Reg_File[rob[i].src1].ins_id == rob[i].id && physical_Reg_File[rob[i].src1].old_instance == 1){
-                  physical_Reg_File[rob[i].src1].busy = 0;
-                  physical_Reg_File[rob[i].src1].old_instance = 0;
+      else if(!(strcmp(cpu->rob[i].opcode, "OR"))){
+          trace(TRACE_COMMIT, "\n Details of ROB  State --> \t\t %s R%d P%d P%d", cpu->rob[i].opcode, cpu->rob[i].dest, cpu->rob[i].src1, cpu->rob[i].src2);
+          if (cpu->rob[i].status == VALID){
+              cpu->arch_Reg_File[cpu->rob[i].dest].value = cpu->rob[i].result;
+              cpu->committed_rename_table[cpu->rob[i].dest] = cpu->rob[i].phys_dest;
+              if (cpu->physical_Reg_File[cpu->rob[i].src1].ins_id == cpu->rob[i].id && cpu->physical_Reg_File[cpu->rob[i].src1].old_instance == 1){
+                  free_prf(cpu, cpu->rob[i].src1);
               }
-              if (physical_Reg_File[rob[i].src2].ins_id == rob[i].id && physical_Reg_File[rob[i].src2].old_instance == 1){
-                  physical_Reg_File[rob[i].src2].busy = 0;
-                  physical_Reg_File[rob[i].src2].old_instance = 0;
+              if (cpu->physical_Reg_File[cpu->rob[i].src2].ins_id == cpu->rob[i].id && cpu->physical_Reg_File[cpu->rob[i].src2].old_instance == 1){
+                  free_prf(cpu, cpu->rob[i].src2);
               }
-              rob_com_index++;
-              rob[i] = nop;
+              cpu->rob_com_index++;
+              cpu->committed++;
+              cpu->rob[i] = nop;
           }
       }
-      else if(!(strcmp(rob[i].opcode, "EX-OR"))){
-          printf("\n Details of ROB  State --> \t\t %s R%d P%d P%d", rob[i].opcode, rob[i].dest, rob[i].src1, rob[i].src2);
-          if (rob[i].status == VALID){
-              arch_Reg_File[rob[i].dest].value = rob[i].result;
-              if (physical_Reg_File[rob[i].src1].ins_id == rob[i].id && physical_Reg_File[rob[i].src1].old_instance == 1){
-                  physical_Reg_File[rob[i].src1].busy = 0;
-                  physical_Reg_File[rob[i].src1].old_instance = 0;
+      else if(!(strcmp(cpu->rob[i].opcode, "EX-OR"))){
+          trace(TRACE_COMMIT, "\n Details of ROB  State --> \t\t %s R%d P%d P%d", cpu->rob[i].opcode, cpu->rob[i].dest, cpu->rob[i].src1, cpu->rob[i].src2);
+          if (cpu->rob[i].status == VALID){
+              cpu->arch_Reg_File[cpu->rob[i].dest].value = cpu->rob[i].result;
+              cpu->committed_rename_table[cpu->rob[i].dest] = cpu->rob[i].phys_dest;
+              if (cpu->physical_Reg_File[cpu->rob[i].src1].ins_id == cpu->rob[i].id && cpu->physical_Reg_File[cpu->rob[i].src1].old_instance == 1){
+                  free_prf(cpu, cpu->rob[i].src1);
               }
-              if (physical_Reg_File[rob[i].src2].ins_id == rob[i].id && physical_Reg_File[rob[i].src2].old_instance == 1){
-                  physical_Reg_File[rob[i].src2].busy = 0;
-                  physical_Reg_File[rob[i].src2].old_instance = 0;
+              if (cpu->physical_Reg_File[cpu->rob[i].src2].ins_id == cpu->rob[i].id && cpu->physical_Reg_File[cpu->rob[i].src2].old_instance == 1){
+                  free_prf(cpu, cpu->rob[i].src2);
               }
-              rob_com_index++;
-              rob[i] = nop;
+              cpu->rob_com_index++;
+              cpu->committed++;
+              cpu->rob[i] = nop;
           }
       }
-      else if(!(strcmp(rob[i].opcode, "HALT"))){
-          printf("\n Details of ROB  State --> \t\t %s ", rob[i].opcode);
-          if (rob[i].status == VALID){
-              rob_com_index++;
-              rob[i] = nop;
-              hflag = 100;
+      else if(!(strcmp(cpu->rob[i].opcode, "HALT"))){
+          trace(TRACE_COMMIT, "\n Details of ROB  State --> \t\t %s ", cpu->rob[i].opcode);
+          if (cpu->rob[i].status == VALID){
+              cpu->rob_com_index++;
+              cpu->committed++;
+              cpu->rob[i] = nop;
+              cpu->hflag = 100;
           }
       }
-      else if(!(strcmp(rob[i].opcode, "JUMP"))){
-          printf("\n Details of ROB  State --> \t\t %s P%d %d ", rob[i].opcode, rob[i].src1, rob[i].literal);
-          if (rob[i].status == VALID){
-              rob_com_index++;
-              bflag = 1;
-              pc = rob[i].result;
-              jflag = 0;
-              rob[i] = nop;
+      else if(!(strcmp(cpu->rob[i].opcode, "JUMP"))){
+          trace(TRACE_COMMIT, "\n Details of ROB  State --> \t\t %s P%d %d ", cpu->rob[i].opcode, cpu->rob[i].src1, cpu->rob[i].literal);
+          if (cpu->rob[i].status == VALID){
+              cpu->rob_com_index++;
+              cpu->committed++;
+              cpu->bflag = 1;
+              cpu->pc = cpu->rob[i].result;
+              cpu->jflag = 0;
+              cpu->rob[i] = nop;
           }
       }
-      else if(!(strcmp(rob[i].opcode, "BZ"))){
+      else if(!(strcmp(cpu->rob[i].opcode, "BZ"))){
         //printf("I am ROB for BZ \n");
-          bzflag = 0;
-          if (rob[i].status == VALID){
-              if(rob[i].branch == 1){
-                  printf("\n Details of ROB  State --> \t\t %s %d ", rob[i].opcode, rob[i].literal);
-                  bflag = 1;
+          cpu->bzflag = 0;
+          if (cpu->rob[i].status == VALID){
+              if(cpu->rob[i].branch == 1){
+                  trace(TRACE_COMMIT, "\n Details of ROB  State --> \t\t %s %d ", cpu->rob[i].opcode, cpu->rob[i].literal);
+                  cpu->bflag = 1;
                   //hflag = 0;
-                  pc = rob[i].result;
-                  for (int j = 0; j < 12; j++){
-                      if (rob[j].id > rob[i].id)
-                          rob[j] = nop;
+                  cpu->pc = cpu->rob[i].result;
+                  for (int j = 0; j < cpu->rob_size; j++){
+                      if (cpu->rob[j].id > cpu->rob[i].id){
+                          if (cpu->rob[j].phys_dest >= 0)
+                              free_prf(cpu, cpu->rob[j].phys_dest);
+                          cpu->rob[j] = nop;
+                      }
                   }
-                  rob_com_index++;
-                  rob_add_index = rob_com_index;
-                  rob[i] = nop;
+                  rename_restore(cpu);
+                  cpu->rob_com_index++;
+                  cpu->committed++;
+                  cpu->rob_add_index = cpu->rob_com_index;
+                  cpu->rob[i] = nop;
               }
               else {
-                  printf("\n Details of ROB  State --> \t\t %s %d ", rob[i].opcode, rob[i].literal);
-                  rob[i] = nop;
-                  rob_com_index++;
+                  trace(TRACE_COMMIT, "\n Details of ROB  State --> \t\t %s %d ", cpu->rob[i].opcode, cpu->rob[i].literal);
+                  cpu->rob[i] = nop;
+                  cpu->rob_com_index++;
+                  cpu->committed++;
               }
           }
       }
   }
   //printf("\n testing %d", rob_com_index );
-  if(rob_com_index > 12)
+  if(cpu->rob_com_index > cpu->rob_size)
   {
-      for(int i = 0; i < 12; i++)
+      for(int i = 0; i < cpu->rob_size; i++)
       {
-          if((strcmp(rob[i].opcode, "nop")))
-            rob_com_index = i;
+          if((strcmp(cpu->rob[i].opcode, "nop")))
+            cpu->rob_com_index = i;
       }
   }
-  if (rob_add_index == rob_com_index)
+  if (cpu->rob_add_index == cpu->rob_com_index)
   {
-      if((strcmp(rob[rob_add_index].opcode, "nop")))
-          rob_full_index = 1;
+      if((strcmp(cpu->rob[cpu->rob_add_index].opcode, "nop")))
+          cpu->rob_full_index = 1;
       else
-          rob_full_index = 0;
+          cpu->rob_full_index = 0;
   }
 
 }
+
+//64-bit FNV-1a style hash of the source text, folded in 8 bytes at a time
+uint64_t hash_text(const char *text, size_t len){
+    uint64_t hash = 0xcbf29ce484222325ULL ^ len;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8){
+        uint64_t word;
+        memcpy(&word, text + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3ULL;
+        hash ^= hash >> 29;
+    }
+    for (; i < len; i++)
+        hash = (hash ^ (unsigned char)text[i]) * 0x100000001b3ULL;
+    return hash;
+}
+
+int hash_file(char file_name[], uint64_t *hash){
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0){
+        close(fd);
+        return 0;
+    }
+    const char *text = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED)
+        return 0;
+    *hash = hash_text(text, st.st_size);
+    munmap((void *)text, st.st_size);
+    return 1;
+}
+
+//Whether a record from outside the parser is safe to run: a known opcode
+//and registers within the architectural register file, the dest also
+//0xFF for none. The parser leaves the fields an opcode does not use 0.
+int valid_record(const packed_instruction *record){
+    return record->opcode < NUM_OPCODES &&
+           (record->rd < 16 || record->rd == 0xFF) &&
+           record->rs1 < 16 && record->rs2 < 16;
+}
+
+//"prog.asm" caches to "prog.ooo.apexo", any other name gets the suffix
+//added. The in-order simulator caches the same source to "prog.apexo".
+void object_path(char file_name[], char path[], size_t size){
+    size_t len = strlen(file_name);
+    if (len >= 4 && !(strcmp(file_name + len - 4, ".asm")))
+        len -= 4;
+    snprintf(path, size, "%.*s" APEXO_SUFFIX, (int)len, file_name);
+}
+
+//Maps the cached object of file_name and appends its records to the
+//code store, exactly as parsing the text would. Returns 0 if the object
+//is missing, stale or produced by another front end.
+int load_object(APEX_OOO_CPU *cpu, char file_name[], uint64_t source_hash){
+    char path[512];
+    object_path(file_name, path, sizeof(path));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(object_header)){
+        close(fd);
+        return 0;
+    }
+    char *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return 0;
+
+    const object_header *header = (const object_header *)base;
+    const packed_instruction *records = (const packed_instruction *)(base + sizeof(object_header));
+    int valid = !(memcmp(header->magic, APEXO_MAGIC, 4)) &&
+                header->version == APEXO_VERSION &&
+                header->frontend == APEXO_FRONTEND_OOO &&
+                header->record_size == sizeof(packed_instruction) &&
+                header->count > 0 &&
+                sizeof(object_header) + (size_t)header->count * sizeof(packed_instruction) == (size_t)st.st_size &&
+                header->source_hash == source_hash;
+    for (uint32_t i = 0; valid && i < header->count; i++)
+        valid = valid_record(&records[i]);
+
+    if (valid){
+        for (uint32_t i = 0; i < header->count; i++){
+            code_record *record = code_store_grow(cpu);
+            record->ins = records[i];
+            if (records[i].opcode != OPCODE_INVALID){
+                record->id = cpu->id;
+                cpu->id++;
+            }
+            cpu->instr_line_Number++;
+        }
+        trace(TRACE_FULL, "\n Loaded %u instructions from %s", header->count, path);
+    }
+    munmap(base, st.st_size);
+    return valid;
+}
+
+//Saves code store records [first, first+count) as the object of file_name,
+//written under a temporary name and renamed into place
+void save_object(APEX_OOO_CPU *cpu, char file_name[], uint64_t source_hash, int first, int count){
+    char path[512], tmp_path[600];
+    object_path(file_name, path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.%p.tmp", path, (long)getpid(), (void *)cpu);
+
+    if (count <= 0)
+        return;
+    packed_instruction *records = malloc(count * sizeof(packed_instruction));
+    if (!records)
+        return;
+    for (int i = 0; i < count; i++){
+        int address = first + i;
+        records[i] = cpu->program.chunks[address / code_chunk_records][address % code_chunk_records].ins;
+    }
+
+    object_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, APEXO_MAGIC, 4);
+    header.version = APEXO_VERSION;
+    header.frontend = APEXO_FRONTEND_OOO;
+    header.record_size = sizeof(packed_instruction);
+    header.count = count;
+    header.source_hash = source_hash;
+
+    FILE *fp = fopen(tmp_path, "wb");
+    if (fp){
+        int ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+                 fwrite(records, sizeof(packed_instruction), count, fp) == (size_t)count;
+        ok = (fclose(fp) == 0) && ok;
+        if (!ok || rename(tmp_path, path) != 0)
+            unlink(tmp_path);
+    }
+    free(records);
+}
+
+//Saves every state region and the code store to file_name, written under a
+//temporary name and renamed into place. Returns 1 on success.
+int save_checkpoint(APEX_OOO_CPU *cpu, char file_name[]){
+    char tmp_path[600];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.%p.tmp", file_name, (long)getpid(), (void *)cpu);
+
+    checkpoint_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, 4);
+    header.version = CHECKPOINT_VERSION;
+    header.frontend = CHECKPOINT_FRONTEND_OOO;
+    for (size_t r = 0; r < NUM_STATE_REGIONS; r++)
+        header.state_size += state_regions[r].size;
+    header.record_size = sizeof(code_record);
+    header.count = cpu->program.size;
+    header.state_offset = sizeof(checkpoint_header);
+    header.code_offset = header.state_offset + header.state_size;
+
+    FILE *fp = fopen(tmp_path, "wb");
+    if (!fp)
+        return 0;
+    int ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    for (size_t r = 0; ok && r < NUM_STATE_REGIONS; r++)
+        ok = fwrite((char *)cpu + state_regions[r].offset, state_regions[r].size, 1, fp) == 1;
+    for (int address = 0; ok && address < cpu->program.size; address++)
+        ok = fwrite(&cpu->program.chunks[address / code_chunk_records][address % code_chunk_records],
+                    sizeof(code_record), 1, fp) == 1;
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp_path, file_name) != 0){
+        unlink(tmp_path);
+        return 0;
+    }
+    trace(TRACE_FULL, "\n Saved checkpoint %s at cycle %d", file_name, cpu->cycle);
+    return 1;
+}
+
+//Replaces the simulator state and the loaded program with a checkpoint
+//saved by save_checkpoint. The current state is left alone if file_name is
+//not a checkpoint this build can restore. Returns 1 on success.
+int restore_checkpoint(APEX_OOO_CPU *cpu, char file_name[]){
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(checkpoint_header)){
+        close(fd);
+        return 0;
+    }
+    char *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return 0;
+
+    uint32_t state_size = 0;
+    for (size_t r = 0; r < NUM_STATE_REGIONS; r++)
+        state_size += state_regions[r].size;
+
+    const checkpoint_header *header = (const checkpoint_header *)base;
+    const code_record *records = (const code_record *)(base + header->code_offset);
+    int valid = !(memcmp(header->magic, CHECKPOINT_MAGIC, 4)) &&
+                header->version == CHECKPOINT_VERSION &&
+                header->frontend == CHECKPOINT_FRONTEND_OOO &&
+                header->state_size == state_size &&
+                header->record_size == sizeof(code_record) &&
+                header->state_offset == sizeof(checkpoint_header) &&
+                header->code_offset == (uint64_t)header->state_offset + state_size &&
+                header->code_offset + (uint64_t)header->count * sizeof(code_record) == (uint64_t)st.st_size;
+    for (uint32_t i = 0; valid && i < header->count; i++)
+        valid = valid_record(&records[i].ins);
+
+    //Unpack into a scratch machine first, the sizes index every queue
+    APEX_OOO_CPU *saved = valid ? malloc(sizeof(APEX_OOO_CPU)) : NULL;
+    if (saved){
+        const char *state = base + header->state_offset;
+        for (size_t r = 0; r < NUM_STATE_REGIONS; r++){
+            memcpy((char *)saved + state_regions[r].offset, state, state_regions[r].size);
+            state += state_regions[r].size;
+        }
+    }
+    valid = saved && sizes_valid(saved->rob_size, saved->iq_size, saved->lsq_size, saved->prf_size) &&
+            saved->prf_free_count >= 0 && saved->prf_free_count <= saved->prf_size;
+    //Renamed registers index the physical register file
+    for (int r = 0; valid && r < 16; r++)
+        valid = saved->rename_table[r] >= -1 && saved->rename_table[r] < saved->prf_size &&
+                saved->committed_rename_table[r] >= -1 && saved->committed_rename_table[r] < saved->prf_size;
+
+    if (valid){
+        for (size_t r = 0; r < NUM_STATE_REGIONS; r++)
+            memcpy((char *)cpu + state_regions[r].offset, (char *)saved + state_regions[r].offset,
+                   state_regions[r].size);
+        //Chunks already allocated are reused
+        cpu->program.size = 0;
+        for (uint32_t i = 0; i < header->count; i++)
+            *code_store_grow(cpu) = records[i];
+        trace(TRACE_FULL, "\n Restored checkpoint %s at cycle %d", file_name, cpu->cycle);
+    }
+    free(saved);
+    munmap(base, st.st_size);
+    return valid;
+}
+
+//Returns a cleared record at the end of the code store, one more chunk is
+//allocated whenever the last one fills up
+code_record *code_store_grow(APEX_OOO_CPU *cpu){
+    if (cpu->program.size == cpu->program.num_chunks * code_chunk_records){
+        if (cpu->program.num_chunks == cpu->program.max_chunks){
+            int max_chunks = cpu->program.max_chunks ? cpu->program.max_chunks * 2 : 16;
+            code_record **chunks = realloc(cpu->program.chunks, max_chunks * sizeof(code_record *));
+            if (!chunks){
+                printf("\n Out of memory loading instruction %d\n", cpu->program.size);
+                exit(1);
+            }
+            cpu->program.chunks = chunks;
+            cpu->program.max_chunks = max_chunks;
+        }
+        cpu->program.chunks[cpu->program.num_chunks] = malloc(code_chunk_records * sizeof(code_record));
+        if (!cpu->program.chunks[cpu->program.num_chunks]){
+            printf("\n Out of memory loading instruction %d\n", cpu->program.size);
+            exit(1);
+        }
+        cpu->program.num_chunks++;
+    }
+
+    code_record *record = &cpu->program.chunks[cpu->program.size / code_chunk_records][cpu->program.size % code_chunk_records];
+    memset(record, 0, sizeof(code_record));
+    cpu->program.size++;
+    return record;
+}
+
+//Packs ins into a new record at the end of the code store
+void code_store_append(APEX_OOO_CPU *cpu, Instructions *ins){
+    code_record *record = code_store_grow(cpu);
+    record->ins.opcode = OPCODE_INVALID;
+    for (int op = OPCODE_MOVC; op < NUM_OPCODES; op++){
+        if (!(strcmp(ins->opcode, opcode_names[op]))){
+            record->ins.opcode = op;
+            break;
+        }
+    }
+    record->ins.rd = ins->dest;
+    record->ins.rs1 = ins->src1;
+    record->ins.rs2 = ins->src2;
+    record->ins.imm = ins->literal;
+    record->id = ins->id;
+}
+
+//Expands the record at address back into an instruction, an address past
+//the end of the program reads as an empty instruction
+Instructions code_store_fetch(APEX_OOO_CPU *cpu, int address){
+    Instructions ins;
+    memset(&ins, 0, sizeof(ins));
+    ins.phys_dest = -1;
+    if (address < 0 || address >= cpu->program.size)
+        return ins;
+
+    const code_record *record = &cpu->program.chunks[address / code_chunk_records][address % code_chunk_records];
+    strcpy(ins.opcode, opcode_names[record->ins.opcode]);
+    ins.dest = (record->ins.rd == 0xFF) ? -1 : record->ins.rd;
+    ins.src1 = record->ins.rs1;
+    ins.src2 = record->ins.rs2;
+    ins.literal = record->ins.imm;
+    ins.id = record->id;
+    return ins;
+}